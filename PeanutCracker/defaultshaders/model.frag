@@ -2,6 +2,7 @@
 out vec4 FragColor;
 
 #define MAX_LIGHTS 8
+#define MAX_REF_PROBES 32
 
 const float PI 				   = 3.14159f;
 const float MAX_REFLECTION_LOD = 4.0f;
@@ -64,12 +65,18 @@ uniform samplerCube     PointShadowMap[MAX_LIGHTS];
 uniform sampler2DShadow SpotShadowMap[MAX_LIGHTS];
 
 // IBL
-uniform samplerCube irradianceMap;
 uniform samplerCube prefilterMap;
 uniform sampler2D   brdfLUT;
 
-// Reflection Probes
-uniform samplerCube refEnvMap[MAX_LIGHTS];
+// Irradiance volume, L1 SH per channel as (L0, L1y, L1z, L1x)
+uniform sampler3D irradianceVolumeR;
+uniform sampler3D irradianceVolumeG;
+uniform sampler3D irradianceVolumeB;
+
+// Reflection Probes, one octahedral prefilter chain per layer
+uniform sampler2DArray refProbeAtlas;
+uniform ivec2 refProbeIndices;      // Picked per draw on the CPU, -1 = unused
+uniform vec2  refProbeWeights;
 
 layout (std140) uniform CameraMatricesUBOData {
     mat4 projection;
@@ -88,16 +95,24 @@ layout (std140) uniform LightingUBOData {
 } lightingBlock;
 
 layout (std140) uniform ReflectionProbeUBOData {
-    vec4 position[MAX_LIGHTS];
-    mat4 worldMats[MAX_LIGHTS];
-    mat4 invWorldMats[MAX_LIGHTS];
-    vec4 proxyDims[MAX_LIGHTS];
+    vec4 position[MAX_REF_PROBES];      // w = atlas layer, negative until the first bake
+    mat4 worldMats[MAX_REF_PROBES];
+    mat4 invWorldMats[MAX_REF_PROBES];
+    vec4 proxyDims[MAX_REF_PROBES];
     int  numRefProbes;
     int  padding0;
     int  padding1;
     int  padding2;
 } refProbeBlock;
 
+// Diffuse irradiance / PI as L2 spherical harmonics, band constants already folded in
+layout (std140) uniform EnvironmentUBOData {
+    vec4 irradianceSH[9];
+    vec4 volumeMin;         // w = 1 when the irradiance volume is baked and enabled
+    vec4 volumeMax;
+    vec4 volumeResolution;
+};
+
 
 vec3  getNormal();
 float distributionGGX(vec3 normal, vec3 halfVec, float roughness);
@@ -105,8 +120,11 @@ float geometryShlickGGX(float nDotv, float roughness);
 float geometrySmithGGX(vec3 normal, vec3 viewDir, vec3 lightDir, float roughness);
 vec3  fresnelSchlick(float hDotV, vec3 F0);
 vec3  fresnelSchlickRoughness(float hDotV, vec3 F0, float roughness);
-vec3  parallaxCorrect(vec3 R, float roughness);
-bool  isInAABB(vec3 pos, vec3 dimensions);
+vec3  sampleRefProbes(vec3 R, float roughness);
+vec3  parallaxCorrect(int probe, vec3 R, float roughness);
+vec3  evalIrradianceSH(vec3 normal);
+vec3  evalIrradiance(vec3 fragPos, vec3 normal);
+vec2  octEncode(vec3 dir);
 
 float calcDirShadow(bool isLocalLight, vec4 fragPosLightSpace, sampler2DShadow shadowMap, vec3 normal, vec3 lightDir, float depthBias);
 float calcOmniShadow(vec3 lightPos, samplerCube shadowMap, float farPlane, vec3 normal, float depthBias);
@@ -150,12 +168,12 @@ void main() {
 	kD *= 1.0f - metallic;
 
 	//--Diffuse IBL
-	vec3 irradiance = texture(irradianceMap, norm).rgb;
+	vec3 irradiance = evalIrradiance(fs_in.FragPos, norm);
 	vec3 diffuseIBL = irradiance * albedo;
 
 	//--Specular IBL
 	//vec3 prefilteredCol = textureLod(prefilterMap, R, roughness * MAX_REFLECTION_LOD).rgb;
-	vec3 prefilteredCol = parallaxCorrect(R, roughness);
+	vec3 prefilteredCol = sampleRefProbes(R, roughness);
 	vec2 brdf           = texture(brdfLUT, vec2(max(dot(norm, viewDir), 0.0f), roughness)).rg;
 	vec3 specularIBL    = prefilteredCol * (F * brdf.x + brdf.y);
 	
@@ -315,43 +333,95 @@ vec3  fresnelSchlickRoughness(float hDotV, vec3 F0, float roughness) {
 	return F0 + (max(vec3(1.0f - roughness), F0) - F0) * pow(clamp(1.0f - hDotV, 0.0f, 1.0f), 5.0f);
 }
 
-vec3 parallaxCorrect(vec3 R, float roughness) {
-	for (int i = 0; i < refProbeBlock.numRefProbes; ++i) {
-		vec3 localPos = vec3(refProbeBlock.invWorldMats[i] * vec4(fs_in.FragPos, 1.0f));
-		
-		if (isInAABB(localPos, refProbeBlock.proxyDims[i].xyz)) {
-			// Slab intersection check from inside the AABB
-			vec3 localR = vec3(refProbeBlock.invWorldMats[i] * vec4(R, 0.0f));
-			
-			vec3 t1 = (-refProbeBlock.proxyDims[i].xyz / 2 - localPos) / localR;
-			vec3 t2 = ( refProbeBlock.proxyDims[i].xyz / 2 - localPos) / localR;
-			
-			vec3 tMin = min(t1, t2);
-			vec3 tMax = max(t1, t2);
-			float t = min(min(tMax.x, tMax.y), tMax.z);
-		
-			vec3 localHit = localPos + t * localR;
-			vec3 worldHit = vec3(refProbeBlock.worldMats[i] * vec4(localHit, 1.0f));
-		
-			vec3 rPrime = worldHit - refProbeBlock.position[i].xyz;
-		
-			switch(i) {
-			case 0: return textureLod(refEnvMap[0], rPrime, roughness * MAX_REFLECTION_LOD).rgb; break;
-			case 1: return textureLod(refEnvMap[1], rPrime, roughness * MAX_REFLECTION_LOD).rgb; break;
-			case 2: return textureLod(refEnvMap[2], rPrime, roughness * MAX_REFLECTION_LOD).rgb; break;
-			case 3: return textureLod(refEnvMap[3], rPrime, roughness * MAX_REFLECTION_LOD).rgb; break;
-			case 4: return textureLod(refEnvMap[4], rPrime, roughness * MAX_REFLECTION_LOD).rgb; break;
-			case 5: return textureLod(refEnvMap[5], rPrime, roughness * MAX_REFLECTION_LOD).rgb; break;
-			case 6: return textureLod(refEnvMap[6], rPrime, roughness * MAX_REFLECTION_LOD).rgb; break;
-			case 7: return textureLod(refEnvMap[7], rPrime, roughness * MAX_REFLECTION_LOD).rgb; break;
-			}
-		}
+// Blends the CPU-selected probes, whatever weight they leave comes from the skybox
+vec3 sampleRefProbes(vec3 R, float roughness) {
+	vec3  result      = vec3(0.0f);
+	float totalWeight = 0.0f;
+
+	for (int k = 0; k < 2; ++k) {
+		int i = refProbeIndices[k];
+		if (i < 0) continue;
+
+		result      += refProbeWeights[k] * parallaxCorrect(i, R, roughness);
+		totalWeight += refProbeWeights[k];
+	}
+
+	if (totalWeight < 1.0f) {
+		result += (1.0f - totalWeight) * textureLod(prefilterMap, R, roughness * MAX_REFLECTION_LOD).rgb;
 	}
-	return textureLod(prefilterMap, R, roughness * MAX_REFLECTION_LOD).rgb;
+	return result;
 }
 
-bool isInAABB(vec3 pos, vec3 dimensions) {
-    return all(greaterThanEqual(pos, -dimensions / 2)) && all(lessThanEqual(pos, dimensions / 2));
+vec3 parallaxCorrect(int i, vec3 R, float roughness) {
+	// Fragments in the fade band can sit just outside the volume, the slab test needs them inside
+	vec3 halfDims = refProbeBlock.proxyDims[i].xyz / 2;
+	vec3 localPos = clamp(vec3(refProbeBlock.invWorldMats[i] * vec4(fs_in.FragPos, 1.0f)), -halfDims, halfDims);
+
+	// Slab intersection check from inside the AABB
+	vec3 localR = vec3(refProbeBlock.invWorldMats[i] * vec4(R, 0.0f));
+
+	vec3 t1 = (-halfDims - localPos) / localR;
+	vec3 t2 = ( halfDims - localPos) / localR;
+
+	vec3 tMax = max(t1, t2);
+	float t = min(min(tMax.x, tMax.y), tMax.z);
+
+	vec3 localHit = localPos + t * localR;
+	vec3 worldHit = vec3(refProbeBlock.worldMats[i] * vec4(localHit, 1.0f));
+
+	vec3 rPrime = worldHit - refProbeBlock.position[i].xyz;
+
+	return textureLod(refProbeAtlas, vec3(octEncode(rPrime), refProbeBlock.position[i].w), roughness * MAX_REFLECTION_LOD).rgb;
+}
+
+vec3 evalIrradianceSH(vec3 n) {
+	vec3 result = irradianceSH[0].rgb
+		+ irradianceSH[1].rgb * n.y
+		+ irradianceSH[2].rgb * n.z
+		+ irradianceSH[3].rgb * n.x
+		+ irradianceSH[4].rgb * (n.x * n.y)
+		+ irradianceSH[5].rgb * (n.y * n.z)
+		+ irradianceSH[6].rgb * (3.0f * n.z * n.z - 1.0f)
+		+ irradianceSH[7].rgb * (n.x * n.z)
+		+ irradianceSH[8].rgb * (n.x * n.x - n.y * n.y);
+	return max(result, vec3(0.0f));
+}
+
+// Trilinearly blended volume probes inside the bounds, fading to the skybox over one cell outside
+vec3 evalIrradiance(vec3 fragPos, vec3 n) {
+	vec3 skyIrradiance = evalIrradianceSH(n);
+	if (volumeMin.w < 0.5f) return skyIrradiance;
+
+	vec3 extent   = max(volumeMax.xyz - volumeMin.xyz, vec3(0.0001f));
+	vec3 res      = volumeResolution.xyz;
+	vec3 local    = (fragPos - volumeMin.xyz) / extent;
+	vec3 clamped  = clamp(local, 0.0f, 1.0f);
+
+	// Probes sit on texel centres
+	vec3 uvw = (clamped * (res - 1.0f) + 0.5f) / res;
+
+	vec4 basis = vec4(1.0f, n.y, n.z, n.x);
+	vec3 volumeIrradiance = vec3(
+		dot(texture(irradianceVolumeR, uvw), basis),
+		dot(texture(irradianceVolumeG, uvw), basis),
+		dot(texture(irradianceVolumeB, uvw), basis));
+	volumeIrradiance = max(volumeIrradiance, vec3(0.0f));
+
+	vec3  cellSize = extent / max(res - 1.0f, vec3(1.0f));
+	vec3  outside  = abs(local - clamped) * extent / cellSize;
+	float fade     = clamp(max(max(outside.x, outside.y), outside.z), 0.0f, 1.0f);
+
+	return mix(volumeIrradiance, skyIrradiance, fade);
+}
+
+// Direction -> [0, 1] octahedral UV, the upper hemisphere fills the inner diamond
+vec2 octEncode(vec3 dir) {
+	vec3 n = dir / (abs(dir.x) + abs(dir.y) + abs(dir.z));
+	vec2 p = n.xy;
+	if (n.z < 0.0f) {
+		p = (1.0f - abs(n.yx)) * vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+	}
+	return p * 0.5f + 0.5f;
 }
 
 float calcDirShadow(bool isLocalLight, vec4 fragPosLightSpace, sampler2DShadow shadowMap, vec3 normal, vec3 lightDir, float depthBias) {
@@ -1,9 +1,10 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+layout (location = 1) in vec2 aNormal;		// Octahedral
 layout (location = 2) in vec2 aTexCoords;
-layout (location = 3) in vec3 aTangent;
-layout (location = 4) in vec3 aBitangent;
+layout (location = 3) in vec3 aTangent;		// Octahedral xy, bitangent sign in z
+layout (location = 7) in mat4 aInstanceModel;	// Mesh to model space, per instance
+layout (location = 11) in mat3 aInstanceNormal;
 
 #define MAX_LIGHTS 8
 
@@ -73,16 +74,27 @@ layout (std140) uniform ShadowMatricesUBOData {
 uniform mat4 model;
 uniform mat4 normalMatrix;
 
+// Inverse of encodeOctahedral() in mesh.cpp
+vec3 decodeOctahedral(vec2 e) {
+	vec3  v = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+	float t = max(-v.z, 0.0f);
+	v.xy   += vec2(v.x >= 0.0f ? -t : t, v.y >= 0.0f ? -t : t);
+	return normalize(v);
+}
+
 
 void main() {
-    vs_out.FragPos  = vec3(model * vec4(aPos, 1.0f));
+	mat4 instanceModel  = model * aInstanceModel;
+	mat3 instanceNormal = mat3(normalMatrix) * aInstanceNormal;
+
+    vs_out.FragPos  = vec3(instanceModel * vec4(aPos, 1.0f));
 	vs_out.TexCoord = aTexCoords;
 
 	// Tangent space matrix
-	vec3 T = normalize(mat3(normalMatrix) * aTangent);
-	vec3 N = normalize(mat3(normalMatrix) * aNormal);
+	vec3 T = normalize(instanceNormal * decodeOctahedral(aTangent.xy));
+	vec3 N = normalize(instanceNormal * decodeOctahedral(aNormal));
 	T      = normalize(T - dot(T, N) * N);
-	vec3 B = cross(N, T);
+	vec3 B = cross(N, T) * (aTangent.z < 0.0f ? -1.0f : 1.0f);
 	vs_out.TBN = mat3(T, B, N);
 
 	for (int i = 0; i < lightingBlock.numDirectionalLights; ++i) {
@@ -95,5 +107,5 @@ void main() {
 		vs_out.SpotLightSpacePos[i] = shadowMatricesBlock.spotLightSpaceMatrices[i] * vec4(offsetPos, 1.0f);
 	}
 	
-	gl_Position = projection * view * model * vec4(aPos, 1.0f);
+	gl_Position = projection * view * vec4(vs_out.FragPos, 1.0f);
 }
\ No newline at end of file
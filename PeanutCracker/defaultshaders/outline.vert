@@ -1,6 +1,8 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+layout (location = 1) in vec2 aNormal;		// Octahedral
+layout (location = 7) in mat4 aInstanceModel;
+layout (location = 11) in mat3 aInstanceNormal;
 
 layout (std140) uniform CameraMatricesUBOData {
     mat4 projection;
@@ -12,9 +14,17 @@ uniform mat4 model;
 uniform mat4 normalMatrix;
 uniform float outlineThickness = 0.8f;
 
+// Inverse of encodeOctahedral() in mesh.cpp
+vec3 decodeOctahedral(vec2 e) {
+    vec3  v = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+    float t = max(-v.z, 0.0f);
+    v.xy   += vec2(v.x >= 0.0f ? -t : t, v.y >= 0.0f ? -t : t);
+    return normalize(v);
+}
+
 void main() {
-    vec4 worldPos  = model * vec4(aPos, 1.0f);
-	vec3 worldNorm = normalize(mat3(normalMatrix) * aNormal);
+    vec4 worldPos  = model * aInstanceModel * vec4(aPos, 1.0f);
+	vec3 worldNorm = normalize(mat3(normalMatrix) * aInstanceNormal * decodeOctahedral(aNormal));
 
 	float dist = distance(cameraPos.xyz, worldPos.xyz);
 
@@ -1,5 +1,6 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
+layout (location = 7) in mat4 aInstanceModel;
 
 layout (std140) uniform CameraMatricesUBOData {
     mat4 projection;
@@ -10,5 +11,5 @@ layout (std140) uniform CameraMatricesUBOData {
 uniform mat4 modelMat;
 
 void main() {
-	gl_Position = projection * view * modelMat * vec4(aPos, 1.0f);
+	gl_Position = projection * view * modelMat * aInstanceModel * vec4(aPos, 1.0f);
 }
\ No newline at end of file
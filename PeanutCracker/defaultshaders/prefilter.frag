@@ -5,6 +5,7 @@ in vec3 localPos;
 
 uniform samplerCube environmentMap;
 uniform float roughness;
+uniform float envResolution;  // Per face size of environmentMap
 
 const float PI = 3.141592f;
 
@@ -33,8 +34,7 @@ void main() {
 			float HdotV = max(dot(v, halfVec), 0.0f);
 			float pdf = D * NdotH / (4.0f * HdotV) + 0.0001f;
 			
-			float resolution = 512.0f; // Resolution of source cubemap (per face)
-			float saTexel = 4.0f * PI / (6.0f * resolution * resolution);
+			float saTexel = 4.0f * PI / (6.0f * envResolution * envResolution);
 			float saSample = 1.0f / (float(SAMPLE_COUNT) * pdf + 0.0001f);
 			float mipLevel = roughness == 0.0f ? 0.0f : 0.5f * log2(saSample / saTexel);
 			
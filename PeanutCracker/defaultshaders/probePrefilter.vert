@@ -0,0 +1,9 @@
+#version 330 core
+out vec2 TexCoords;
+
+// Fullscreen triangle from gl_VertexID, no vertex buffer bound
+void main() {
+	vec2 pos    = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+	TexCoords   = pos;
+	gl_Position = vec4(pos * 2.0f - 1.0f, 0.0f, 1.0f);
+}
@@ -1,5 +1,6 @@
 #include "headers/assetManager.h"
 #include "headers/model.h"
+#include "headers/modelLoader.h"
 #include "headers/object.h"
 #include "headers/shader.h"
 
@@ -9,9 +10,16 @@
 #include <functional>
 #include <unordered_map>
 #include <chrono>
+#include <vector>
 
 
-AssetManager::AssetManager() = default;
+AssetManager::AssetManager(UploadContext& i_uploadContext)
+	: m_uploadContext(i_uploadContext)
+	, m_textureStreamer(i_uploadContext)
+{
+}
+
+AssetManager::~AssetManager() = default;
 
 std::shared_ptr<Shader> AssetManager::loadShaderObject(const std::filesystem::path& vertPath, const std::filesystem::path& fragPath) {
     std::string compositeKey = vertPath.string() + "|" + fragPath.string();
@@ -99,17 +107,58 @@ void AssetManager::reloadShaders() {
 }
 
 // TODO: CHANGE TO FILESYSTEM::PATH
-std::shared_ptr<Model> AssetManager::loadModel(const std::string& path) {
+std::shared_ptr<Model> AssetManager::loadModel(const std::string& path, MeshRetention retention) {
 	auto modelPath = modelCache.find(path);
 	if (modelPath != modelCache.end()) {
+		Model& model = *modelPath->second;
+		if (retention > model.retention) {
+			if (model.isReady()) {
+				std::cerr << "[AssetManager] " << path << " was loaded without CPU positions\n";
+			}
+			else {
+				model.retention = retention;
+			}
+		}
 		return modelPath->second;
 	}
 
-	auto newModel = std::make_shared<Model>(this, path);
+	auto newModel = std::make_shared<Model>(path);
+	newModel->retention = retention;
 	modelCache[path] = newModel;
+	m_modelLoaders.push_back(std::make_unique<ModelLoader>(path, newModel, m_meshCache, m_lodSettings));
 	return newModel;
 }
 
+void AssetManager::update(double uploadBudgetMs) {
+	// Without an upload thread the buffer and texture jobs run here. Mip levels keep streaming after
+	// their model's loader has finished, so this runs every frame whether loads are pending or not
+	m_uploadContext.update(uploadBudgetMs);
+	m_textureStreamer.update();
+}
+
+std::vector<Model*> AssetManager::processModelLoads(double budgetMs) {
+	using Clock = std::chrono::steady_clock;
+
+	std::vector<Model*> readyModels;
+	const Clock::time_point start = Clock::now();
+
+	// Loaders still importing return straight away, the budget goes to the ones with work to upload
+	for (auto it = m_modelLoaders.begin(); it != m_modelLoaders.end();) {
+		const double remainingMs = budgetMs - std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		if (remainingMs <= 0.0) break;
+
+		if ((*it)->update(*this, m_uploadContext, remainingMs)) {
+			readyModels.push_back((*it)->getModel());
+			it = m_modelLoaders.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+
+	return readyModels;
+}
+
 std::shared_ptr<Texture> AssetManager::loadTexture(const std::filesystem::path& path, bool sRGB, bool hdr) {
     std::string key = path.string();
 
@@ -122,46 +171,40 @@ std::shared_ptr<Texture> AssetManager::loadTexture(const std::filesystem::path&
     return newTexture;
 }
 
-std::shared_ptr<Material> AssetManager::loadMaterial(aiMaterial* mat, const std::filesystem::path& dir, int matIndex) {
+std::shared_ptr<Texture> AssetManager::findTexture(const std::filesystem::path& path) const {
+    auto texture = textureCache.find(path.string());
+    return texture != textureCache.end() ? texture->second : nullptr;
+}
+
+std::shared_ptr<Texture> AssetManager::adoptTexture(const std::filesystem::path& path, std::shared_ptr<Texture> texture) {
+    auto [it, isNew] = textureCache.try_emplace(path.string(), std::move(texture));
+    return it->second;
+}
+
+std::shared_ptr<Material> AssetManager::loadMaterial(const MaterialDesc& desc, const std::filesystem::path& dir, int matIndex) {
     std::string key = dir.string() + "_index_" + std::to_string(matIndex);
 
     if (materialCache.find(key) != materialCache.end()) {
         return materialCache[key];
     }
 
-    aiString aiName;
-    mat->Get(AI_MATKEY_NAME, aiName);
-
     auto material = std::make_shared<Material>();
-    material->name = aiName.C_Str();
-
-    // Helper func
-    auto getTex = [&](aiTextureType type, bool sRGB) -> std::shared_ptr<Texture> {
-        if (mat->GetTextureCount(type) > 0) {
-            aiString path;
-            mat->GetTexture(type, 0, &path);
-            return loadTexture(dir / path.C_Str(), sRGB, false);
-        }
-        
-        return nullptr;
+    material->name = desc.name;
+
+    // Helper func, the loader has uploaded every texture that decoded
+    auto getTex = [&](const std::filesystem::path& path) -> std::shared_ptr<Texture> {
+        if (path.empty()) return nullptr;
+        return findTexture(path);
     };
 
     //--Albedo
-    material->albedoMap = getTex(aiTextureType_DIFFUSE, true);
+    material->albedoMap = getTex(desc.albedoPath);
     if (!material->albedoMap) {
-        material->albedoMap = getTex(aiTextureType_BASE_COLOR, true);
-    }
-
-    if (!material->albedoMap) {
-        aiColor4D defaultAlbedo = { 1.0f, 0.0f, 1.0f, 1.0f };
-        mat->Get(AI_MATKEY_COLOR_DIFFUSE, defaultAlbedo);
-        material->albedoMap = getOrCreateSolidTexture(
-            glm::vec4(defaultAlbedo.r, defaultAlbedo.g, defaultAlbedo.b, defaultAlbedo.a),
-            true);
+        material->albedoMap = getOrCreateSolidTexture(desc.baseColor, true);
     }
 
     //--Normals
-    material->normalMap = getTex(aiTextureType_NORMALS, false);
+    material->normalMap = getTex(desc.normalPath);
     if (!material->normalMap) {
         material->normalMap = getOrCreateSolidTexture(
             glm::vec4(0.5f, 0.5f, 1.0f, 1.0f),
@@ -169,9 +212,9 @@ std::shared_ptr<Material> AssetManager::loadMaterial(aiMaterial* mat, const std:
     }
 
     //--ORM check
-    auto metalTex   = getTex(aiTextureType_METALNESS, false);
-    auto roughTex   = getTex(aiTextureType_DIFFUSE_ROUGHNESS, false);
-    auto unknownTex = getTex(aiTextureType_UNKNOWN, false);
+    auto metalTex   = getTex(desc.metallicPath);
+    auto roughTex   = getTex(desc.roughnessPath);
+    auto unknownTex = getTex(desc.ormPath);
 
     if (unknownTex) {
         // ORM
@@ -186,13 +229,8 @@ std::shared_ptr<Material> AssetManager::loadMaterial(aiMaterial* mat, const std:
         material->aoMap        = getOrCreateSolidTexture(glm::vec4(1, 0, 0, 1), false);
     }
     else {
-        float metalFactor = 0.0f;
-        float roughFactor = 0.5f;
-        mat->Get(AI_MATKEY_METALLIC_FACTOR, metalFactor);
-        mat->Get(AI_MATKEY_ROUGHNESS_FACTOR, roughFactor);
-
-        material->metallicMap  = getOrCreateSolidTexture(glm::vec4(0, 0, metalFactor, 1), false);
-        material->roughnessMap = getOrCreateSolidTexture(glm::vec4(0, roughFactor, 0, 1), false);
+        material->metallicMap  = getOrCreateSolidTexture(glm::vec4(0, 0, desc.metallic, 1), false);
+        material->roughnessMap = getOrCreateSolidTexture(glm::vec4(0, desc.roughness, 0, 1), false);
         material->aoMap        = getOrCreateSolidTexture(glm::vec4(1, 0, 0, 1), false);
     }
 
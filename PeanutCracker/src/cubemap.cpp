@@ -5,6 +5,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
 #include <array>
 
 
@@ -19,186 +20,45 @@ const std::array<glm::mat4, 6> Cubemap::m_captureViews = {
     glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
 };
 
-Cubemap::Cubemap(
-    const std::filesystem::path& i_hdrPath,
-    const Shader& i_convolutionShader,
-    const Shader& i_conversionShader,
-    const Shader& i_prefilterShader)
-    : m_envCubemap(512, TexType::TEX_CUBE, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR)
-    , m_irradianceMap(32, TexType::TEX_CUBE, GL_LINEAR, GL_LINEAR)
-    , m_prefilterMap(128, TexType::TEX_CUBE, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR)
+Cubemap::Cubemap(int i_envSize, int i_prefilterSize)
+    : m_envSize(i_envSize)
+    , m_prefilterSize(i_prefilterSize)
+    , m_capture(acquireCaptureResources())
 {
-    setupCubeMesh();
-
-    glGenFramebuffers(1, &m_captureFBO);
-    glGenRenderbuffers(1, &m_captureRBO);
-
-    Texture hdrTexture(i_hdrPath, false, true);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, m_captureFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, m_captureRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_captureRBO);
-
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        std::cerr << "ERROR: Equirect cubemap framebuffer not complete!" << '\n';
-    }
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-
-    convertEquirectToCubemap(hdrTexture.getID(), i_conversionShader);
-    m_envCubemap.generateMipmaps();
-
-    generateIrradianceMap(i_convolutionShader);
-
-    m_prefilterMap.generateMipmaps();
-    generatePrefilterMap(i_prefilterShader);
 }
 
-Cubemap::Cubemap(
-    const Shader& i_convolutionShader,
-    const Shader& i_conversionShader,
-    const Shader& i_prefilterShader)
-    : m_envCubemap(512, TexType::TEX_CUBE, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR)
-    , m_irradianceMap(32, TexType::TEX_CUBE, GL_LINEAR, GL_LINEAR)
-    , m_prefilterMap(128, TexType::TEX_CUBE, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR)
-{
-    setupCubeMesh();
-
-    glGenFramebuffers(1, &m_captureFBO);
-    glGenRenderbuffers(1, &m_captureRBO);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, m_captureFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, m_captureRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_captureRBO);
+void Cubemap::allocate() {
+    if (isAllocated()) return;
 
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        std::cerr << "ERROR: Equirect cubemap framebuffer not complete!" << '\n';
-    }
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    m_envCubemap   = Texture(m_envSize, TexType::TEX_CUBE, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+    m_prefilterMap = Texture(m_prefilterSize, TexType::TEX_CUBE, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
     glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
 }
 
-Cubemap::~Cubemap() {
-    if (m_captureFBO != 0) glDeleteFramebuffers(1, &m_captureFBO);
-    if (m_captureRBO != 0) glDeleteRenderbuffers(1, &m_captureRBO);
-}
-
 
 void Cubemap::draw(const Shader& shader) const {
     glDepthFunc(GL_LEQUAL);
 
     shader.use();
-    m_cubeVAO.bind();
+    m_capture->cubeVAO.bind();
     m_envCubemap.bind(0);
     glDrawArrays(GL_TRIANGLES, 0, 36);
-    m_cubeVAO.unbind();
+    m_capture->cubeVAO.unbind();
 
     glDepthFunc(GL_LESS);
 }
 
-// HDR equirect -> cubemap
-void Cubemap::convertEquirectToCubemap(GLuint hdrTexID, const Shader& conversionShader) {
-    std::cout << "[SKYBOX] Converting equirectangular to cubemap\n";
-
-    conversionShader.use();
-    conversionShader.setInt("equirectMap", 0);
-    conversionShader.setMat4("projectionMat", m_captureProjection);
-
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, hdrTexID);
-
-    glViewport(0, 0, 512, 512);
-    glBindFramebuffer(GL_FRAMEBUFFER, m_captureFBO);
-
-    for (unsigned int i = 0; i < 6; ++i) {
-        conversionShader.setMat4("viewMat", m_captureViews[i]);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, m_envCubemap.getID(), 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        m_cubeVAO.bind();
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        m_cubeVAO.unbind();
-    }
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-}
-
-void Cubemap::generateIrradianceMap(const Shader& convolutionShader) {
-    std::cout << "[SKYBOX] Generating irradiance map\n";
-
-    glBindFramebuffer(GL_FRAMEBUFFER, m_captureFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, m_captureRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 32, 32);
-
-    convolutionShader.use();
-    convolutionShader.setInt("environmentMap", 0);
-    convolutionShader.setMat4("projection", m_captureProjection);
-
-    m_envCubemap.bind(100);
-
-    glViewport(0, 0, 32, 32);
-    glDisable(GL_CULL_FACE);
-    glDisable(GL_DEPTH_TEST);
-
-    // Solve diffuse integral by convolution
-    for (unsigned int i = 0; i < 6; ++i) {
-        convolutionShader.setMat4("view", m_captureViews[i]);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, m_irradianceMap.getID(), 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        m_cubeVAO.bind();
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        m_cubeVAO.unbind();
-    }
-    glEnable(GL_CULL_FACE);
-    glEnable(GL_DEPTH_TEST);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-}
-
 void Cubemap::generatePrefilterMap(const Shader& prefilterShader) const {
-    std::cout << "[SKYBOX] Generating prefilter map\n";
-
-    prefilterShader.use();
-    prefilterShader.setInt("environmentMap", 0);
-    prefilterShader.setMat4("projection", m_captureProjection);
-
-    m_envCubemap.bind(0);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, m_captureFBO);
-
-    const unsigned int maxMipLevels = 5;
-    for (unsigned int mip = 0; mip < maxMipLevels; ++mip) {
-        unsigned int mipWidth = static_cast<unsigned int>(128 * std::pow(0.5, mip));
-        unsigned int mipHeight = static_cast<unsigned int>(128 * std::pow(0.5, mip));
-
-        glBindRenderbuffer(GL_RENDERBUFFER, m_captureRBO);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mipWidth, mipHeight);
-        glViewport(0, 0, mipWidth, mipHeight);
-
-        float roughness = static_cast<float>(mip) / static_cast<float>(maxMipLevels - 1);
-        prefilterShader.setFloat("roughness", roughness);
-
-        for (unsigned int i = 0; i < 6; ++i) {
-            prefilterShader.setMat4("view", m_captureViews[i]);
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, m_prefilterMap.getID(), mip);
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-            m_cubeVAO.bind();
-            glDrawArrays(GL_TRIANGLES, 0, 36);
-            m_cubeVAO.unbind();
+    for (int mip = 0; mip < PREFILTER_MIPS; ++mip) {
+        for (int face = 0; face < 6; ++face) {
+            prefilterFace(prefilterShader, mip, face);
         }
     }
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 
-void Cubemap::setupCubeMesh() {
+// --CAPTURE RESOURCES
+Cubemap::CaptureResources::CaptureResources() {
     static const std::array<float, 108> vertices = {
         -1.0f, 1.0f, -1.0f,
         -1.0f, -1.0f, -1.0f,
@@ -243,8 +103,154 @@ void Cubemap::setupCubeMesh() {
         1.0f, -1.0f, 1.0f
     };
 
-    m_cubeVAO.bind();
-    m_cubeVBO.setData(vertices.data(), vertices.size() * sizeof(float), GL_STATIC_DRAW);
-    m_cubeVAO.linkAttrib(m_cubeVBO, VertLayout::POS, 3 * sizeof(float), (void*)0);
-    m_cubeVAO.unbind();
-}
\ No newline at end of file
+    cubeVAO.bind();
+    cubeVBO.setData(vertices.data(), vertices.size() * sizeof(float), GL_STATIC_DRAW);
+    cubeVAO.linkAttrib(cubeVBO, VertLayout::POS, 3 * sizeof(float), (void*)0);
+    cubeVAO.unbind();
+
+    glGenFramebuffers(1, &fbo);
+}
+
+Cubemap::CaptureResources::~CaptureResources() {
+    if (fbo != 0) glDeleteFramebuffers(1, &fbo);
+}
+
+std::shared_ptr<Cubemap::CaptureResources> Cubemap::acquireCaptureResources() {
+    static std::weak_ptr<CaptureResources> shared;
+
+    std::shared_ptr<CaptureResources> resources = shared.lock();
+    if (!resources) {
+        resources = std::make_shared<CaptureResources>();
+        shared    = resources;
+    }
+    return resources;
+}
+
+
+// --INCREMENTAL BAKE
+// The FBO is shared, passes re-attach their target and set the viewport
+void Cubemap::bindCaptureTarget(int size) const {
+    glBindFramebuffer(GL_FRAMEBUFFER, m_capture->fbo);
+    glViewport(0, 0, size, size);
+}
+
+// HDR equirect -> one cubemap face
+void Cubemap::convertEquirectFace(GLuint hdrTexID, const Shader& conversionShader, int face) const {
+    conversionShader.use();
+    conversionShader.setInt("equirectMap", 0);
+    conversionShader.setMat4("projectionMat", m_captureProjection);
+    conversionShader.setMat4("viewMat", m_captureViews[face]);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, hdrTexID);
+
+    bindCaptureTarget(m_envSize);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, m_envCubemap.getID(), 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    m_capture->cubeVAO.bind();
+    glDrawArrays(GL_TRIANGLES, 0, 36);
+    m_capture->cubeVAO.unbind();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// Filters the environment mips and allocates the prefilter levels
+void Cubemap::generateMipChains() const {
+    m_envCubemap.generateMipmaps();
+    m_prefilterMap.generateMipmaps();
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+}
+
+void Cubemap::prefilterFace(const Shader& prefilterShader, int mip, int face) const {
+    const int   mipSize   = std::max(m_prefilterSize >> mip, 1);
+    const float roughness = static_cast<float>(mip) / static_cast<float>(PREFILTER_MIPS - 1);
+
+    prefilterShader.use();
+    prefilterShader.setInt("environmentMap", 0);
+    prefilterShader.setMat4("projection", m_captureProjection);
+    prefilterShader.setMat4("view", m_captureViews[face]);
+    prefilterShader.setFloat("roughness", roughness);
+    prefilterShader.setFloat("envResolution", static_cast<float>(m_envSize));
+
+    m_envCubemap.bind(0);
+
+    bindCaptureTarget(mipSize);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, m_prefilterMap.getID(), mip);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    m_capture->cubeVAO.bind();
+    glDrawArrays(GL_TRIANGLES, 0, 36);
+    m_capture->cubeVAO.unbind();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+
+// --CACHE
+// The 9 SH coefficients are stored as a 3x3 RGB half image
+bool Cubemap::isValidCacheEntry(const std::vector<IBLImage>& images, int envSize, int prefilterSize) {
+    if (images.size() != 3) return false;
+
+    const std::array<int, 2> sizes     = { envSize, prefilterSize };
+    const std::array<int, 2> mipCounts = { IBLSettings::getMipCount(envSize), PREFILTER_MIPS };
+
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        const IBLImage& image = images[i];
+        if (image.faceCount != 6 || image.channels != 3 ||
+            image.baseSize != static_cast<uint32_t>(sizes[i]) ||
+            image.levels.size() != static_cast<size_t>(mipCounts[i])) {
+            return false;
+        }
+    }
+
+    const IBLImage& shImage = images[2];
+    return shImage.faceCount == 1 && shImage.channels == 3 && shImage.baseSize == 3 && shImage.levels.size() == 1;
+}
+
+// Uploads all 6 faces of one level of the env (image 0) or prefilter (image 1) map
+void Cubemap::uploadCachedLevel(const std::vector<IBLImage>& images, size_t image, uint32_t level) const {
+    const Texture&  target    = image == 0 ? m_envCubemap : m_prefilterMap;
+    const IBLImage& source    = images[image];
+    const int       size      = static_cast<int>(source.getLevelSize(level));
+    const size_t    faceHalfs = source.getFaceHalfCount(level);
+
+    for (int face = 0; face < 6; ++face) {
+        target.uploadLevel(level, face, size, size, GL_RGB16F, source.levels[level].data() + face * faceHalfs);
+    }
+
+    if (level + 1 == source.levels.size()) {
+        target.setMaxLevel(static_cast<int>(level));
+    }
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+}
+
+std::vector<IBLImage> Cubemap::readbackImages() const {
+    const std::array<const Texture*, 2> sources   = { &m_envCubemap, &m_prefilterMap };
+    const std::array<int, 2>            sizes     = { m_envSize, m_prefilterSize };
+    const std::array<int, 2>            mipCounts = { IBLSettings::getMipCount(m_envSize), PREFILTER_MIPS };
+
+    std::vector<IBLImage> images;
+    for (size_t i = 0; i < sources.size(); ++i) {
+        IBLImage image;
+        image.faceCount = 6;
+        image.channels  = 3;
+        image.baseSize  = sizes[i];
+        image.levels.resize(mipCounts[i]);
+
+        for (uint32_t level = 0; level < image.levels.size(); ++level) {
+            const size_t faceHalfs = image.getFaceHalfCount(level);
+            image.levels[level].resize(faceHalfs * 6);
+
+            for (int face = 0; face < 6; ++face) {
+                sources[i]->readLevel(level, face, GL_RGB16F, image.levels[level].data() + face * faceHalfs);
+            }
+        }
+        images.push_back(std::move(image));
+    }
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+    images.push_back(IBLBaker::toIBLImage(m_irradianceSH));
+    return images;
+}
+
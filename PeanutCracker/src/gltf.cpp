@@ -0,0 +1,348 @@
+#include "headers/gltf.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+
+namespace {
+    constexpr uint32_t GLB_MAGIC      = 0x46546C67;    // "glTF"
+    constexpr uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+    constexpr uint32_t GLB_CHUNK_BIN  = 0x004E4942;
+
+    // Extensions that change how data must be read, anything else required means Assimp
+    const char* const SUPPORTED_REQUIRED_EXTENSIONS[] = {
+        "KHR_mesh_quantization"
+    };
+
+    uint32_t readU32(const unsigned char* p) {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    size_t getComponentSize(int componentType) {
+        switch (componentType) {
+        case GltfDocument::BYTE:
+        case GltfDocument::UNSIGNED_BYTE:  return 1;
+        case GltfDocument::SHORT:
+        case GltfDocument::UNSIGNED_SHORT: return 2;
+        case GltfDocument::UNSIGNED_INT:
+        case GltfDocument::FLOAT:          return 4;
+        default:                           return 0;
+        }
+    }
+
+    int getComponentCount(const std::string& type) {
+        if (type == "SCALAR") return 1;
+        if (type == "VEC2")   return 2;
+        if (type == "VEC3")   return 3;
+        if (type == "VEC4")   return 4;
+        if (type == "MAT2")   return 4;
+        if (type == "MAT3")   return 9;
+        if (type == "MAT4")   return 16;
+        return 0;
+    }
+
+    // Relative URIs may escape spaces and non-ASCII characters
+    std::filesystem::path uriToPath(const std::filesystem::path& directory, const std::string& uri) {
+        std::string decoded;
+        decoded.reserve(uri.size());
+        for (size_t i = 0; i < uri.size(); ++i) {
+            if (uri[i] == '%' && i + 2 < uri.size() && std::isxdigit(static_cast<unsigned char>(uri[i + 1])) && std::isxdigit(static_cast<unsigned char>(uri[i + 2]))) {
+                decoded += static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16));
+                i += 2;
+            }
+            else {
+                decoded += uri[i];
+            }
+        }
+        return directory / std::filesystem::u8path(decoded);
+    }
+
+    bool decodeBase64(const std::string& text, size_t begin, std::vector<unsigned char>& out) {
+        auto value = [](char c) -> int {
+            if (c >= 'A' && c <= 'Z') return c - 'A';
+            if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+            if (c >= '0' && c <= '9') return c - '0' + 52;
+            if (c == '+') return 62;
+            if (c == '/') return 63;
+            return -1;
+        };
+
+        out.clear();
+        out.reserve((text.size() - begin) / 4 * 3);
+
+        uint32_t bits  = 0;
+        int      count = 0;
+        for (size_t i = begin; i < text.size() && text[i] != '='; ++i) {
+            const int v = value(text[i]);
+            if (v < 0) return false;
+
+            bits = (bits << 6) | static_cast<uint32_t>(v);
+            if (++count == 4) {
+                out.push_back(static_cast<unsigned char>(bits >> 16));
+                out.push_back(static_cast<unsigned char>(bits >> 8));
+                out.push_back(static_cast<unsigned char>(bits));
+                bits  = 0;
+                count = 0;
+            }
+        }
+
+        if (count == 2) {
+            out.push_back(static_cast<unsigned char>(bits >> 4));
+        }
+        else if (count == 3) {
+            out.push_back(static_cast<unsigned char>(bits >> 10));
+            out.push_back(static_cast<unsigned char>(bits >> 2));
+        }
+        return count != 1;
+    }
+}
+
+
+// --ACCESSOR
+size_t GltfDocument::Accessor::getElementSize() const {
+    return getComponentSize(componentType) * static_cast<size_t>(componentCount);
+}
+
+void GltfDocument::Accessor::read(size_t i, float* out) const {
+    const unsigned char* element = data + i * stride;
+
+    switch (componentType) {
+    case FLOAT:
+        std::memcpy(out, element, sizeof(float) * componentCount);
+        break;
+    case UNSIGNED_BYTE:
+        for (int c = 0; c < componentCount; ++c) {
+            out[c] = isNormalized ? element[c] / 255.0f : static_cast<float>(element[c]);
+        }
+        break;
+    case BYTE:
+        for (int c = 0; c < componentCount; ++c) {
+            const float v = static_cast<float>(static_cast<int8_t>(element[c]));
+            out[c] = isNormalized ? std::max(v / 127.0f, -1.0f) : v;
+        }
+        break;
+    case UNSIGNED_SHORT:
+        for (int c = 0; c < componentCount; ++c) {
+            uint16_t v;
+            std::memcpy(&v, element + c * 2, sizeof(v));
+            out[c] = isNormalized ? v / 65535.0f : static_cast<float>(v);
+        }
+        break;
+    case SHORT:
+        for (int c = 0; c < componentCount; ++c) {
+            int16_t v;
+            std::memcpy(&v, element + c * 2, sizeof(v));
+            out[c] = isNormalized ? std::max(v / 32767.0f, -1.0f) : static_cast<float>(v);
+        }
+        break;
+    case UNSIGNED_INT:
+        for (int c = 0; c < componentCount; ++c) {
+            out[c] = static_cast<float>(readU32(element + c * 4));
+        }
+        break;
+    }
+}
+
+uint32_t GltfDocument::Accessor::readIndex(size_t i) const {
+    const unsigned char* element = data + i * stride;
+
+    switch (componentType) {
+    case UNSIGNED_BYTE:
+        return element[0];
+    case UNSIGNED_SHORT: {
+        uint16_t v;
+        std::memcpy(&v, element, sizeof(v));
+        return v;
+    }
+    default:
+        return readU32(element);
+    }
+}
+
+
+// --DOCUMENT
+bool GltfDocument::open(const std::filesystem::path& path) {
+    m_directory = path.parent_path();
+    if (!m_file.open(path)) {
+        std::cerr << "[GLTF] Can't open " << path << '\n';
+        return false;
+    }
+
+    const unsigned char* bytes = m_file.getData();
+    const size_t         size  = m_file.getSize();
+
+    const char* jsonText   = reinterpret_cast<const char*>(bytes);
+    size_t      jsonLength = size;
+    Buffer      binChunk;
+
+    // GLB: 12 byte header, then a JSON chunk and an optional BIN chunk, each with an 8 byte header
+    if (size >= 12 && readU32(bytes) == GLB_MAGIC) {
+        if (readU32(bytes + 4) != 2) {
+            std::cerr << "[GLTF] Only GLB version 2 is supported: " << path << '\n';
+            return false;
+        }
+
+        const size_t length = std::min<size_t>(readU32(bytes + 8), size);
+        size_t offset = 12;
+        jsonText = nullptr;
+        while (offset + 8 <= length) {
+            const size_t   chunkLength = readU32(bytes + offset);
+            const uint32_t chunkType   = readU32(bytes + offset + 4);
+            offset += 8;
+            if (chunkLength > length - offset) {
+                std::cerr << "[GLTF] Truncated chunk in " << path << '\n';
+                return false;
+            }
+
+            if (chunkType == GLB_CHUNK_JSON && !jsonText) {
+                jsonText   = reinterpret_cast<const char*>(bytes + offset);
+                jsonLength = chunkLength;
+            }
+            else if (chunkType == GLB_CHUNK_BIN && !binChunk.data) {
+                binChunk.data = bytes + offset;
+                binChunk.size = chunkLength;
+            }
+            offset += (chunkLength + 3) & ~size_t(3);
+        }
+
+        if (!jsonText) {
+            std::cerr << "[GLTF] No JSON chunk in " << path << '\n';
+            return false;
+        }
+    }
+
+    std::string error;
+    if (!JsonValue::parse(jsonText, jsonLength, m_json, &error)) {
+        std::cerr << "[GLTF] " << path << ": " << error << '\n';
+        return false;
+    }
+
+    if (m_json["asset"]["version"].getString().rfind("2", 0) != 0) {
+        std::cerr << "[GLTF] Only glTF 2.0 is supported: " << path << '\n';
+        return false;
+    }
+
+    const JsonValue& required = m_json["extensionsRequired"];
+    for (size_t i = 0; i < required.size(); ++i) {
+        const std::string& name = required[i].getString();
+        if (std::none_of(std::begin(SUPPORTED_REQUIRED_EXTENSIONS), std::end(SUPPORTED_REQUIRED_EXTENSIONS),
+                         [&](const char* supported) { return name == supported; })) {
+            std::cout << "[GLTF] " << path.filename() << " requires " << name << '\n';
+            return false;
+        }
+    }
+
+    return openBuffers(binChunk);
+}
+
+bool GltfDocument::openBuffers(const Buffer& binChunk) {
+    const JsonValue& buffers = m_json["buffers"];
+    m_buffers.resize(buffers.size());
+
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        const JsonValue&   desc       = buffers[i];
+        const std::string& uri        = desc["uri"].getString();
+        const size_t       byteLength = static_cast<size_t>(desc["byteLength"].getNumber());
+
+        Buffer buffer;
+        if (uri.empty()) {
+            // Only the first buffer of a GLB may point at the BIN chunk
+            if (i != 0 || !binChunk.data) {
+                std::cerr << "[GLTF] Buffer " << i << " has no data\n";
+                return false;
+            }
+            buffer = binChunk;
+        }
+        else if (uri.rfind("data:", 0) == 0) {
+            const size_t comma = uri.find(',');
+            if (comma == std::string::npos || uri.rfind(";base64", comma) == std::string::npos) {
+                std::cerr << "[GLTF] Buffer " << i << " isn't a base64 data URI\n";
+                return false;
+            }
+
+            m_decodedBuffers.emplace_back();
+            if (!decodeBase64(uri, comma + 1, m_decodedBuffers.back())) {
+                std::cerr << "[GLTF] Buffer " << i << " has malformed base64\n";
+                return false;
+            }
+            buffer.data = m_decodedBuffers.back().data();
+            buffer.size = m_decodedBuffers.back().size();
+        }
+        else {
+            const std::filesystem::path bufferPath = uriToPath(m_directory, uri);
+
+            auto file = std::make_unique<MappedFile>();
+            if (!file->open(bufferPath)) {
+                std::cerr << "[GLTF] Can't open buffer " << bufferPath << '\n';
+                return false;
+            }
+            buffer.data = file->getData();
+            buffer.size = file->getSize();
+            m_bufferFiles.push_back(std::move(file));
+            m_bufferPaths.push_back(bufferPath);
+        }
+
+        if (buffer.size < byteLength) {
+            std::cerr << "[GLTF] Buffer " << i << " is shorter than its byteLength\n";
+            return false;
+        }
+        buffer.size  = byteLength;
+        m_buffers[i] = buffer;
+    }
+    return true;
+}
+
+bool GltfDocument::getAccessor(int index, Accessor& out) const {
+    const JsonValue& accessor = m_json["accessors"][index];
+    if (!accessor.isObject() || accessor.has("sparse")) return false;
+
+    const JsonValue& view = m_json["bufferViews"][accessor["bufferView"].getInt(-1)];
+    if (!view.isObject()) return false;
+
+    const int bufferIndex = view["buffer"].getInt(-1);
+    if (bufferIndex < 0 || static_cast<size_t>(bufferIndex) >= m_buffers.size()) return false;
+    const Buffer& buffer = m_buffers[bufferIndex];
+
+    out.componentType  = accessor["componentType"].getInt();
+    out.componentCount = getComponentCount(accessor["type"].getString());
+    out.isNormalized   = accessor["normalized"].getBool();
+    out.count          = static_cast<size_t>(std::max(accessor["count"].getNumber(), 0.0));
+
+    const size_t elementSize = out.getElementSize();
+    if (elementSize == 0) return false;
+    out.stride = static_cast<size_t>(view["byteStride"].getNumber(static_cast<double>(elementSize)));
+    if (out.stride < elementSize) return false;
+
+    const size_t viewOffset = static_cast<size_t>(view["byteOffset"].getNumber());
+    const size_t viewLength = static_cast<size_t>(view["byteLength"].getNumber());
+    const size_t offset     = static_cast<size_t>(accessor["byteOffset"].getNumber());
+    if (viewOffset > buffer.size || viewLength > buffer.size - viewOffset) return false;
+
+    // The last element has to end inside the view
+    if (out.count > 0) {
+        if (out.count - 1 > (viewLength - std::min(offset, viewLength)) / out.stride) return false;
+        if (offset + (out.count - 1) * out.stride + elementSize > viewLength) return false;
+    }
+
+    out.data = buffer.data + viewOffset + offset;
+    return true;
+}
+
+std::filesystem::path GltfDocument::getTexturePath(int textureIndex) const {
+    const JsonValue& texture = m_json["textures"][textureIndex];
+    const JsonValue& image   = m_json["images"][texture["source"].getInt(-1)];
+
+    const std::string& uri = image["uri"].getString();
+    if (uri.empty() || uri.rfind("data:", 0) == 0) {
+        if (image.isObject()) {
+            std::cout << "[GLTF] Embedded image " << texture["source"].getInt() << " skipped\n";
+        }
+        return {};
+    }
+    return uriToPath(m_directory, uri);
+}
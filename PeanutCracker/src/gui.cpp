@@ -238,21 +238,21 @@ ImVec2 GUI::update(float deltaTime, GLFWwindow* window, Camera& camera, Scene& s
 
                         // Transform
                         ImGui::SeparatorText("Transform");
-                        DrawProperty("Dir", [&]() { if (ImGui::DragFloat3("##d", &l.direction.x, 0.01f)) { l.direction = glm::normalize(l.direction); } });
+                        DrawProperty("Dir", [&]() { if (ImGui::DragFloat3("##d", &l.direction.x, 0.01f)) { l.direction = glm::normalize(l.direction); l.version++; } });
 
                         // Properties
                         ImGui::SeparatorText("Properties");
-                        DrawProperty("Col", [&]() { ImGui::ColorEdit3("##c", &l.light.color.x); });
-                        DrawProperty("Pow", [&]() { ImGui::SliderFloat("##pow", &l.light.power, 0.0f, 1000.0f); });
+                        DrawProperty("Col", [&]() { if (ImGui::ColorEdit3("##c", &l.light.color.x)) { l.version++; } });
+                        DrawProperty("Pow", [&]() { if (ImGui::SliderFloat("##pow", &l.light.power, 0.0f, 1000.0f)) { l.version++; } });
 
                         // Range
                         ImGui::SeparatorText("Range");
-                        DrawProperty("Range", [&]() { if (ImGui::SliderFloat("##range", &l.range, 0.1f, 1000.0f)) { l.shadowCasterComponent.setFarPlane(l.range); } });
+                        DrawProperty("Range", [&]() { if (ImGui::SliderFloat("##range", &l.range, 0.1f, 1000.0f)) { l.shadowCasterComponent.setFarPlane(l.range); l.version++; } });
 
                         // Shadow Bias
                         ImGui::SeparatorText("Shadow Bias");
-                        DrawProperty("Normal", [&]() { ImGui::DragFloat("##nbias", &l.light.normalBias, 0.00001f, 0.00001f, 0.1f, "%.5f");  });
-                        DrawProperty("Depth",  [&]() { ImGui::DragFloat("##dbias", &l.light.depthBias, 0.00001f, 0.00001f, 0.1f, "%.5f");  });
+                        DrawProperty("Normal", [&]() { if (ImGui::DragFloat("##nbias", &l.light.normalBias, 0.00001f, 0.00001f, 0.1f, "%.5f")) { l.version++; } });
+                        DrawProperty("Depth",  [&]() { if (ImGui::DragFloat("##dbias", &l.light.depthBias, 0.00001f, 0.00001f, 0.1f, "%.5f")) { l.version++; } });
 
                         ImGui::Spacing();
                     }
@@ -300,24 +300,24 @@ ImVec2 GUI::update(float deltaTime, GLFWwindow* window, Camera& camera, Scene& s
 
                         // Transform
                         ImGui::SeparatorText("Transform");
-                        DrawProperty("Pos", [&]() { ImGui::DragFloat3("##p", &l.position.x, 0.01f); });
+                        DrawProperty("Pos", [&]() { if (ImGui::DragFloat3("##p", &l.position.x, 0.01f)) { l.version++; } });
 
                         // Properties
                         ImGui::SeparatorText("Properties");
-                        DrawProperty("Col", [&]() { ImGui::ColorEdit3("##a", &l.light.color.x); });
-                        DrawProperty("Pow", [&]() { ImGui::SliderFloat("##pow", &l.light.power, 0.0f, 1000.0f); });
+                        DrawProperty("Col", [&]() { if (ImGui::ColorEdit3("##a", &l.light.color.x)) { l.version++; } });
+                        DrawProperty("Pow", [&]() { if (ImGui::SliderFloat("##pow", &l.light.power, 0.0f, 1000.0f)) { l.version++; } });
 
                         // Radius
                         ImGui::Spacing();
                         ImGui::Separator();
                         ImGui::Spacing();
                         ImGui::SeparatorText("Radius");
-                        DrawProperty("Rad", [&]() { if (ImGui::SliderFloat("##rad", &l.radius, 0.1f, 1000.0f)) { l.shadowCasterComponent.setFarPlane(l.radius); } });
+                        DrawProperty("Rad", [&]() { if (ImGui::SliderFloat("##rad", &l.radius, 0.1f, 1000.0f)) { l.shadowCasterComponent.setFarPlane(l.radius); l.version++; } });
 
                         // Shadow Bias
                         ImGui::SeparatorText("Shadow Bias");
-                        DrawProperty("Normal", [&]() { ImGui::DragFloat("##nbias", &l.light.normalBias, 0.00001f, 0.00001f, 0.1f, "%.5f");  });
-                        DrawProperty("Depth",  [&]() { ImGui::DragFloat("##dbias", &l.light.depthBias, 0.00001f, 0.00001f, 0.1f, "%.5f");  });
+                        DrawProperty("Normal", [&]() { if (ImGui::DragFloat("##nbias", &l.light.normalBias, 0.00001f, 0.00001f, 0.1f, "%.5f")) { l.version++; } });
+                        DrawProperty("Depth",  [&]() { if (ImGui::DragFloat("##dbias", &l.light.depthBias, 0.00001f, 0.00001f, 0.1f, "%.5f")) { l.version++; } });
 
                         // Frustum
                         //float nearP = l.shadowCasterComponent.getNearPlane();
@@ -374,33 +374,33 @@ ImVec2 GUI::update(float deltaTime, GLFWwindow* window, Camera& camera, Scene& s
 
                         // Transform
                         ImGui::Separator();
-                        DrawProperty("Pos", [&]() { ImGui::DragFloat3("##p", &l.position.x, 0.01f); });
-                        DrawProperty("Dir", [&]() { if (ImGui::DragFloat3("##d", &l.direction.x, 0.01f)) { l.direction = glm::normalize(l.direction); } });
+                        DrawProperty("Pos", [&]() { if (ImGui::DragFloat3("##p", &l.position.x, 0.01f)) { l.version++; } });
+                        DrawProperty("Dir", [&]() { if (ImGui::DragFloat3("##d", &l.direction.x, 0.01f)) { l.direction = glm::normalize(l.direction); l.version++; } });
 
                         // Angles
                         ImGui::SeparatorText("Light Cone Angles");
                         ImGui::Separator();
                         float iDeg = glm::degrees(acos(l.inCosCutoff));
                         float oDeg = glm::degrees(acos(l.outCosCutoff));
-                        DrawProperty("Inner", [&]() { if (ImGui::SliderFloat("##i", &iDeg, 0.0f, oDeg)) { l.inCosCutoff = cosf(glm::radians(iDeg)); } });
-                        DrawProperty("Outer", [&]() { if (ImGui::SliderFloat("##o", &oDeg, iDeg, 90.0f)) { l.outCosCutoff = cosf(glm::radians(oDeg)); l.shadowCasterComponent.setFOVDeg(oDeg); } });
+                        DrawProperty("Inner", [&]() { if (ImGui::SliderFloat("##i", &iDeg, 0.0f, oDeg)) { l.inCosCutoff = cosf(glm::radians(iDeg)); l.version++; } });
+                        DrawProperty("Outer", [&]() { if (ImGui::SliderFloat("##o", &oDeg, iDeg, 90.0f)) { l.outCosCutoff = cosf(glm::radians(oDeg)); l.shadowCasterComponent.setFOVDeg(oDeg); l.version++; } });
 
                         // Colors
                         ImGui::SeparatorText("Colors");
-                        DrawProperty("Col", [&]() { ImGui::ColorEdit3("##a", &l.light.color.x); });
-                        DrawProperty("Pow", [&]() { ImGui::SliderFloat("##pow", &l.light.power, 0.0f, 1000.0f); });
+                        DrawProperty("Col", [&]() { if (ImGui::ColorEdit3("##a", &l.light.color.x)) { l.version++; } });
+                        DrawProperty("Pow", [&]() { if (ImGui::SliderFloat("##pow", &l.light.power, 0.0f, 1000.0f)) { l.version++; } });
 
                         // Range
                         ImGui::Spacing();
                         ImGui::Separator();
                         ImGui::Spacing();
                         ImGui::SeparatorText("Range");
-                        DrawProperty("Range", [&]() { if (ImGui::SliderFloat("##range", &l.range, 0.01f, 1000.0f)) { l.shadowCasterComponent.setFarPlane(l.range); } });
+                        DrawProperty("Range", [&]() { if (ImGui::SliderFloat("##range", &l.range, 0.01f, 1000.0f)) { l.shadowCasterComponent.setFarPlane(l.range); l.version++; } });
 
                         // Shadow Bias
                         ImGui::SeparatorText("Shadow Bias");
-                        DrawProperty("Normal", [&]() { ImGui::DragFloat("##nbias", &l.light.normalBias, 0.00001f, 0.00001f, 0.1f, "%.5f");  });
-                        DrawProperty("Depth",  [&]() { ImGui::DragFloat("##dbias", &l.light.depthBias, 0.00001f, 0.00001f, 0.1f, "%.5f");  });
+                        DrawProperty("Normal", [&]() { if (ImGui::DragFloat("##nbias", &l.light.normalBias, 0.00001f, 0.00001f, 0.1f, "%.5f")) { l.version++; } });
+                        DrawProperty("Depth",  [&]() { if (ImGui::DragFloat("##dbias", &l.light.depthBias, 0.00001f, 0.00001f, 0.1f, "%.5f")) { l.version++; } });
 
                         // Frustum
                         //ImGui::SeparatorText("Frustum Planes");
@@ -433,23 +433,23 @@ ImVec2 GUI::update(float deltaTime, GLFWwindow* window, Camera& camera, Scene& s
             }
             ImGui::EndChild();
 
-            bool isMax = (scene.getRefProbes().size() >= MAX_LIGHTS);
+            bool isMax = (scene.getRefProbes().size() >= MAX_REF_PROBES);
             bool isEmpty = (scene.getRefProbes().empty());
 
             if (isMax) { ImGui::BeginDisabled(); }
             if (ImGui::Button("(+)", ImVec2(130, 0))) {
-                scene.createAndAddReflectionProbe(std::make_unique<RefProbe>(scene.getConvolutionShader(), scene.getConversionShader(), scene.getPrefilterShader()));
+                scene.createAndAddReflectionProbe(std::make_unique<RefProbe>());
                 selectedProbe = (int)scene.getRefProbes().size() - 1;
             }
             if (isMax) { ImGui::EndDisabled(); }
 
             if (isEmpty) { ImGui::BeginDisabled(); }
-            //if (ImGui::Button("(-)", ImVec2(130, 0))) {
-            //    if (selectedProbe >= 0 && selectedProbe < (int)scene.getRefProbes().size()) {
-            //        scene.deleteRefProbe(selectedProbe);
-            //        selectedProbe--;
-            //    }
-            //}
+            if (ImGui::Button("(-)", ImVec2(130, 0))) {
+                if (selectedProbe >= 0 && selectedProbe < (int)scene.getRefProbes().size()) {
+                    scene.deleteRefProbe(selectedProbe);
+                    selectedProbe--;
+                }
+            }
             if (isEmpty) { ImGui::EndDisabled(); }
             ImGui::EndGroup();
 
@@ -464,20 +464,28 @@ ImVec2 GUI::update(float deltaTime, GLFWwindow* window, Camera& camera, Scene& s
 
                 // Transform
                 ImGui::SeparatorText("Transform");
-                DrawProperty("Pos", [&]() { ImGui::DragFloat3("##pp", glm::value_ptr(p.transform.position), 0.05f); });
+                DrawProperty("Pos", [&]() { if (ImGui::DragFloat3("##pp", glm::value_ptr(p.transform.position), 0.05f)) { p.version++; } });
                 DrawProperty("Rot", [&]() {
                     glm::vec3 rot = glm::degrees(glm::eulerAngles(p.transform.quatRotation));
                         if (ImGui::DragFloat3("##pr", glm::value_ptr(rot), 0.05f)) {
                             p.transform.setRotDeg(rot);
+                            p.version++;
                         }
                 });
 
                 // Proxy object dimensions
                 ImGui::SeparatorText("Proxy Volume");
-                DrawProperty("Size", [&]() { ImGui::DragFloat3("##ps", glm::value_ptr(p.proxyDims), 0.1f, 0.1f, 1000.0f); });
+                DrawProperty("Size", [&]() { if (ImGui::DragFloat3("##ps", glm::value_ptr(p.proxyDims), 0.1f, 0.1f, 1000.0f)) { p.version++; } });
                 DrawProperty("Far", [&]() { ImGui::DragFloat("##pf", &p.farPlane, 1.0f, 0.1f, 10000.0f); });
 
                 ImGui::SeparatorText("Baking");
+                DrawProperty("Capture", [&]() {
+                    const char* sizes[] = { "128", "256", "512" };
+                    int sizeIndex = renderer.getProbeCaptureSize() == 128 ? 0 : (renderer.getProbeCaptureSize() == 512 ? 2 : 1);
+                    if (ImGui::Combo("##pcap", &sizeIndex, sizes, IM_ARRAYSIZE(sizes))) {
+                        renderer.setProbeCaptureSize(128 << sizeIndex);
+                    }
+                });
                 if (ImGui::Button("Bake", ImVec2(-FLT_MIN, 0))) {
                     p.toBeBaked = true;
                 }
@@ -551,9 +559,43 @@ ImVec2 GUI::update(float deltaTime, GLFWwindow* window, Camera& camera, Scene& s
                 scene.createAndAddSkyboxHDR(path);
             }
         }
+        DrawProperty("Resolution", [&]() {
+            const char* sizes[] = { "256", "512", "1024" };
+            int sizeIndex = scene.getSkyboxEnvSize() == 256 ? 0 : (scene.getSkyboxEnvSize() == 1024 ? 2 : 1);
+            if (ImGui::Combo("##skyres", &sizeIndex, sizes, IM_ARRAYSIZE(sizes))) {
+                scene.setSkyboxEnvSize(256 << sizeIndex);
+            }
+        });
         if (ImGui::Button("Delete", ImVec2(-FLT_MIN, 0))) {
             scene.deleteSkybox();
         }
+        if (ImGui::Button("Verify CPU bake", ImVec2(-FLT_MIN, 0))) {
+            scene.verifyCPUBake();
+        }
+        if (const SkyboxLoader* loader = scene.getSkyboxLoader()) {
+            ImGui::ProgressBar(loader->getProgress(), ImVec2(-FLT_MIN, 0), "Loading skybox...");
+        }
+
+        ImGui::Unindent();
+
+        // --Irradiance volume
+        ImGui::SeparatorText("IRRADIANCE VOLUME");
+        ImGui::Indent();
+        IrradianceVolume& volume = scene.getIrradianceVolume();
+
+        DrawProperty("Enable", [&]() { ImGui::Checkbox("##ive", &volume.isEnabled); });
+        DrawProperty("Min", [&]() { if (ImGui::DragFloat3("##ivmin", glm::value_ptr(volume.boundsMin), 0.1f)) { volume.version++; } });
+        DrawProperty("Max", [&]() { if (ImGui::DragFloat3("##ivmax", glm::value_ptr(volume.boundsMax), 0.1f)) { volume.version++; } });
+        DrawProperty("Probes", [&]() {
+            if (ImGui::DragInt3("##ivres", glm::value_ptr(volume.resolution), 0.1f, 1, IrradianceVolume::MAX_RESOLUTION)) {
+                volume.resolution = glm::clamp(volume.resolution, glm::ivec3(1), glm::ivec3(IrradianceVolume::MAX_RESOLUTION));
+                volume.version++;
+            }
+        });
+        DrawProperty("Far", [&]() { if (ImGui::DragFloat("##ivf", &volume.farPlane, 1.0f, 0.1f, 10000.0f)) { volume.version++; } });
+        if (ImGui::Button("Bake Volume", ImVec2(-FLT_MIN, 0))) {
+            volume.toBeBaked = true;
+        }
 
         ImGui::Unindent();
     }
@@ -0,0 +1,208 @@
+#include "headers/hdrImage.h"
+#include "headers/threadPool.h"
+
+#include "../stb_image/stb_image.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+
+namespace {
+    // Radiance .hdr (RGBE) decoding.
+    // Scanline boundaries are found with one serial pass over the run lengths, the
+    // run-length decode and the RGBE -> float conversion then run per row on the thread pool.
+    // Anything unusual (flipped axes, old-style RLE) returns false so stb_image handles it.
+    constexpr size_t ROW_GRAIN = 16;
+
+    bool readLine(const std::vector<uint8_t>& file, size_t& pos, std::string& line) {
+        line.clear();
+        while (pos < file.size() && file[pos] != '\n') {
+            line.push_back(static_cast<char>(file[pos++]));
+        }
+        if (pos >= file.size()) return false;
+        ++pos;
+        return true;
+    }
+
+    bool isRLEScanline(const uint8_t* p, int width) {
+        return width >= 8 && width < 32768 && p[0] == 2 && p[1] == 2 && (p[2] & 0x80) == 0;
+    }
+
+    // Returns the size in bytes of the scanline starting at pos, 0 when it's malformed
+    size_t measureScanline(const std::vector<uint8_t>& file, size_t pos, int width) {
+        const size_t start = pos;
+        if (pos + 4 > file.size()) return 0;
+
+        if (!isRLEScanline(&file[pos], width)) {
+            const size_t flatSize = static_cast<size_t>(width) * 4;
+            return pos + flatSize <= file.size() ? flatSize : 0;
+        }
+
+        if (((file[pos + 2] << 8) | file[pos + 3]) != width) return 0;
+        pos += 4;
+
+        for (int channel = 0; channel < 4; ++channel) {
+            int x = 0;
+            while (x < width) {
+                if (pos >= file.size()) return 0;
+
+                int count = file[pos++];
+                if (count > 128) {
+                    count -= 128;
+                    pos += 1;
+                }
+                else {
+                    pos += count;
+                }
+                if (count == 0 || x + count > width) return 0;
+                x += count;
+            }
+        }
+
+        return pos <= file.size() ? pos - start : 0;
+    }
+
+    // Decodes one scanline into interleaved RGBE bytes
+    bool decodeScanline(const uint8_t* src, int width, uint8_t* rgbe) {
+        if (!isRLEScanline(src, width)) {
+            // Old-style RLE marks repeats with (1, 1, 1, n)
+            for (int x = 0; x < width; ++x) {
+                const uint8_t* p = src + x * 4;
+                if (p[0] == 1 && p[1] == 1 && p[2] == 1) return false;
+            }
+            std::copy(src, src + static_cast<size_t>(width) * 4, rgbe);
+            return true;
+        }
+
+        src += 4;
+        for (int channel = 0; channel < 4; ++channel) {
+            int x = 0;
+            while (x < width) {
+                int count = *src++;
+                if (count > 128) {
+                    count -= 128;
+                    const uint8_t value = *src++;
+                    for (int i = 0; i < count; ++i) rgbe[(x + i) * 4 + channel] = value;
+                }
+                else {
+                    for (int i = 0; i < count; ++i) rgbe[(x + i) * 4 + channel] = *src++;
+                }
+                x += count;
+            }
+        }
+        return true;
+    }
+
+    bool decodeRGBE(const std::vector<uint8_t>& file, HDRImage& image) {
+        size_t      pos = 0;
+        std::string line;
+
+        if (!readLine(file, pos, line) || line.compare(0, 2, "#?") != 0) return false;
+
+        // Header ends at the first empty line
+        while (readLine(file, pos, line) && !line.empty()) {
+            if (line.compare(0, 7, "FORMAT=") == 0 && line != "FORMAT=32-bit_rle_rgbe") return false;
+        }
+
+        // Only the standard orientation, top-to-bottom rows of left-to-right pixels
+        int  width = 0, height = 0;
+        char trailing = 0;
+        if (!readLine(file, pos, line) ||
+            std::sscanf(line.c_str(), "-Y %d +X %d%c", &height, &width, &trailing) != 2 ||
+            width <= 0 || height <= 0) {
+            return false;
+        }
+
+        std::vector<size_t> rowOffsets(height);
+        for (int y = 0; y < height; ++y) {
+            const size_t rowSize = measureScanline(file, pos, width);
+            if (rowSize == 0) return false;
+
+            rowOffsets[y] = pos;
+            pos += rowSize;
+        }
+
+        // ldexp(1, e - 136) for every exponent, same scale as stb_image
+        std::array<float, 256> exponents;
+        exponents[0] = 0.0f;
+        for (int e = 1; e < 256; ++e) {
+            exponents[e] = std::ldexp(1.0f, e - (128 + 8));
+        }
+
+        image.width  = width;
+        image.height = height;
+        image.pixels.resize(static_cast<size_t>(width) * height * 3);
+
+        std::atomic<bool> failed{ false };
+        ThreadPool::getGlobal().parallelFor(static_cast<size_t>(height), ROW_GRAIN, [&](size_t begin, size_t end) {
+            std::vector<uint8_t> rgbe(static_cast<size_t>(width) * 4);
+
+            for (size_t y = begin; y < end; ++y) {
+                if (!decodeScanline(file.data() + rowOffsets[y], width, rgbe.data())) {
+                    failed = true;
+                    return;
+                }
+
+                // File rows go top to bottom, HDRImage rows bottom to top
+                float* dst = image.pixels.data() + (height - 1 - y) * static_cast<size_t>(width) * 3;
+                for (int x = 0; x < width; ++x) {
+                    const uint8_t* p     = rgbe.data() + x * 4;
+                    const float    scale = exponents[p[3]];
+                    dst[x * 3 + 0] = p[0] * scale;
+                    dst[x * 3 + 1] = p[1] * scale;
+                    dst[x * 3 + 2] = p[2] * scale;
+                }
+            }
+        });
+
+        if (failed) {
+            image = HDRImage();
+            return false;
+        }
+        return true;
+    }
+
+    bool readFile(const std::filesystem::path& path, std::vector<uint8_t>& bytes) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file) return false;
+
+        const std::streamsize size = file.tellg();
+        file.seekg(0);
+        bytes.resize(static_cast<size_t>(size));
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(bytes.data()), size));
+    }
+}
+
+
+bool HDRImage::load(const std::filesystem::path& path) {
+    std::cout << "[TEX] Loading HDR: " << path << '\n';
+
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+
+    if (ext == ".hdr") {
+        std::vector<uint8_t> bytes;
+        if (readFile(path, bytes) && decodeRGBE(bytes, *this)) return true;
+    }
+
+    int w, h, nComps;
+    float* data = stbi_loadf(path.string().c_str(), &w, &h, &nComps, 3);
+    if (!data) {
+        std::cerr << "[TEX] Failed to load HDR: " << path << '\n';
+        return false;
+    }
+
+    width  = w;
+    height = h;
+    pixels.assign(data, data + static_cast<size_t>(w) * h * 3);
+
+    stbi_image_free(data);
+    return true;
+}
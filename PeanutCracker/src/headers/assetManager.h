@@ -4,8 +4,9 @@
 #include "shader.h"
 #include "texture.h"
 #include "material.h"
-
-#include <assimp/material.h>
+#include "uploadContext.h"
+#include "textureStreamer.h"
+#include "meshCache.h"
 
 #include <string>
 #include <filesystem>
@@ -13,12 +14,16 @@
 #include <functional>
 #include <unordered_map>
 #include <chrono>
+#include <vector>
 
 class Model;
+class ModelLoader;
+struct MaterialDesc;
 
 class AssetManager {
 public:
-	AssetManager();
+	explicit AssetManager(UploadContext& i_uploadContext);
+	~AssetManager();
 
 	// Shader cache struct
 	struct CachedShader {
@@ -41,9 +46,30 @@ public:
 	// Force reload shader object
 	void reloadShaders();
 
-	std::shared_ptr<Model> loadModel(const std::string& path);
+	// Returns at once, the model imports in the background and stays a placeholder until processModelLoads() finishes it.
+	// Reloads come from the cooked mesh cache when the source hasn't changed.
+	// CPU copies are dropped after upload unless a caller asks for MeshRetention::POSITIONS
+	std::shared_ptr<Model> loadModel(const std::string& path, MeshRetention retention = MeshRetention::NONE);
 	std::shared_ptr<Texture> loadTexture(const std::filesystem::path& path, bool sRGB, bool hdr);
-	std::shared_ptr<Material> loadMaterial(aiMaterial* mat, const std::filesystem::path& dir, int matIndex);
+	std::shared_ptr<Material> loadMaterial(const MaterialDesc& desc, const std::filesystem::path& dir, int matIndex);
+
+	// Textures created off the main context, the cache keeps the first one when two loads race
+	std::shared_ptr<Texture> findTexture(const std::filesystem::path& path) const;
+	std::shared_ptr<Texture> adoptTexture(const std::filesystem::path& path, std::shared_ptr<Texture> texture);
+
+	// Model textures arrive mip tail first, the rest of their chains stream in under its byte budget
+	TextureStreamer& getTextureStreamer() { return m_textureStreamer; }
+
+	// Every frame: queued upload jobs (when there's no upload thread) and texture streaming
+	void update(double uploadBudgetMs);
+
+	// Uploads imported models within the frame budget, returns the ones that became ready
+	std::vector<Model*> processModelLoads(double budgetMs);
+	bool hasPendingModelLoads() const { return !m_modelLoaders.empty(); }
+
+	// LOD chain built for models loaded from now on
+	void setLodSettings(const LodSettings& settings) { m_lodSettings = settings; }
+	const LodSettings& getLodSettings() const { return m_lodSettings; }
 
 private:
 	std::unordered_map<std::string, std::shared_ptr<Model>> modelCache;
@@ -51,5 +77,11 @@ private:
 	std::unordered_map<std::string, std::shared_ptr<Material>> materialCache;
 	std::unordered_map<std::string, CachedShader> shaderCache;
 
+	UploadContext&                            m_uploadContext;
+	MeshCache                                 m_meshCache = MeshCache(std::filesystem::path("cache") / "mesh");
+	LodSettings                               m_lodSettings;
+	TextureStreamer                           m_textureStreamer;
+	std::vector<std::unique_ptr<ModelLoader>> m_modelLoaders;
+
 	std::shared_ptr<Texture> getOrCreateSolidTexture(const glm::vec4& color, bool sRGB);
 };
\ No newline at end of file
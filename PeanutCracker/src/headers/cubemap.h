@@ -2,29 +2,23 @@
 
 #include <filesystem>
 #include <array>
+#include <memory>
 
 #include "texture.h"
 #include "vao.h"
 #include "vbo.h"
 #include "shader.h"
+#include "iblBaker.h"
 
 
 class Cubemap {
 public:
-    Cubemap(
-        const std::filesystem::path& i_hdrPath,
-        const Shader& i_convolutionShader,
-        const Shader& i_conversionShader,
-        const Shader& i_prefilterShader
-    );
+    static constexpr int ENV_SIZE        = IBLSettings::ENV_SIZE;
+    static constexpr int PREFILTER_SIZE  = IBLSettings::PREFILTER_SIZE;
+    static constexpr int PREFILTER_MIPS  = IBLSettings::PREFILTER_MIPS;
 
-    Cubemap(
-        const Shader& i_convolutionShader,
-        const Shader& i_conversionShader,
-        const Shader& i_prefilterShader
-    );
-
-    ~Cubemap();
+    // No texture storage yet, allocate() reserves it once there's something to bake
+    explicit Cubemap(int i_envSize = ENV_SIZE, int i_prefilterSize = PREFILTER_SIZE);
 
     //Skybox(const Skybox&) = delete;
     //Skybox& operator=(const Skybox&) = delete;
@@ -32,37 +26,59 @@ public:
     //Skybox& operator=(Skybox&&) = default;
 
     const Texture& getEnvironmentMap() const { return m_envCubemap; }
-    const Texture& getIrradianceMap() const { return m_irradianceMap; }
+    const SH9& getIrradianceSH() const { return m_irradianceSH; }
     const Texture& getPrefilterMap() const { return m_prefilterMap; }
+    int getEnvSize() const { return m_envSize; }
+    int getPrefilterSize() const { return m_prefilterSize; }
+    bool isAllocated() const { return m_envCubemap.getID() != 0; }
+
+    void allocate();
     
     void draw(const Shader& shader) const;
 
     void generatePrefilterMap(const Shader& prefilterShader) const;
 
+    void setIrradianceSH(const SH9& irradianceSH) { m_irradianceSH = irradianceSH; }
+
+    // --INCREMENTAL BAKE
+    // Each call records one small slice of the HDR bake so it can be spread across frames:
+    // 6 conversion faces, the mip chains, then PREFILTER_MIPS * 6 prefilter faces
+    void convertEquirectFace(GLuint hdrTexID, const Shader& conversionShader, int face) const;
+    void generateMipChains() const;
+    void prefilterFace(const Shader& prefilterShader, int mip, int face) const;
+
+    // --CACHE
+    // Cached entries hold [env, prefilter, irradiance SH]
+    static bool isValidCacheEntry(const std::vector<IBLImage>& images, int envSize = ENV_SIZE, int prefilterSize = PREFILTER_SIZE);
+    void uploadCachedLevel(const std::vector<IBLImage>& images, size_t image, uint32_t level) const;
+
+    // GPU results in the cache layout
+    std::vector<IBLImage> readbackImages() const;
+
 private:
+    // Unit cube and capture FBO, the same for every cubemap. Shared by whichever cubemaps
+    // are alive and freed with the last one, so a skybox swap doesn't rebuild them
+    struct CaptureResources {
+        VAO    cubeVAO;
+        VBO    cubeVBO;
+        GLuint fbo = 0;     // Colour only, seen from its centre the cube never overlaps itself
+
+        CaptureResources();
+        ~CaptureResources();
+    };
+
+    int     m_envSize;
+    int     m_prefilterSize;
     Texture m_envCubemap;     // Environment cubemap
-    Texture m_irradianceMap;  // Diffuse irradiance
     Texture m_prefilterMap;   // Specular prefilter map
-    Texture m_brdfLUT;        // BRDF integration texture
+    SH9     m_irradianceSH;   // Diffuse irradiance, only projected for HDR skyboxes
 
-    VAO m_cubeVAO;
-    VBO m_cubeVBO;
-    VAO m_quadVAO;
-    VBO m_quadVBO;
-
-    GLuint m_captureFBO = 0;
-    GLuint m_captureRBO = 0;
+    std::shared_ptr<CaptureResources> m_capture;
 
     static const glm::mat4 m_captureProjection;
     static const std::array<glm::mat4, 6> m_captureViews;
 
+    static std::shared_ptr<CaptureResources> acquireCaptureResources();
 
-    void convertEquirectToCubemap(GLuint hdrTexID, const Shader& conversionShader);
-
-    void generateIrradianceMap(const Shader& convolutionShader);
-
-
-    void setupCubeMesh();
-    
-    void setupQuadMesh();
+    void bindCaptureTarget(int size) const;
 };
\ No newline at end of file
@@ -12,7 +12,7 @@ public:
 
 	~EBO() { if (m_ID != 0) glDeleteBuffers(1, &m_ID); }
 
-	EBO(EBO&& other) noexcept : m_ID(other.m_ID) {
+	EBO(EBO&& other) noexcept : m_ID(other.m_ID), m_indexType(other.m_indexType) {
 		other.m_ID = 0;
 	}
 
@@ -20,6 +20,7 @@ public:
 		if (this != &other) {
 			if (m_ID != 0) glDeleteBuffers(1, &m_ID);
 			m_ID = other.m_ID;
+			m_indexType = other.m_indexType;
 			other.m_ID = 0;
 		}
 		return *this;
@@ -30,10 +31,38 @@ public:
 
 	GLuint getID() const { return m_ID; }
 
+	// Type of the last upload, what glDrawElements* has to be told
+	GLenum getIndexType() const { return m_indexType; }
+	size_t getIndexSize() const { return getIndexSize(m_indexType); }
+
+	static size_t getIndexSize(GLenum indexType) {
+		return indexType == GL_UNSIGNED_BYTE ? 1 : indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+	}
+
+	template<typename T>
+	static constexpr GLenum getIndexType() {
+		static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4, "Index type must be 8, 16 or 32 bit");
+		return sizeof(T) == 1 ? GL_UNSIGNED_BYTE : sizeof(T) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	}
+
 	template<typename T>
 	void setData(const T* data, size_t count, GLenum usage = GL_STATIC_DRAW) {
 		bind();
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(T), data, usage);
+		m_indexType = getIndexType<T>();
+	}
+
+	// Fills the buffer through the copy target, the element binding belongs to whichever VAO is bound
+	template<typename T>
+	void setDataUnbound(const T* data, size_t count, GLenum usage = GL_STATIC_DRAW) {
+		setDataUnbound(static_cast<const void*>(data), count, getIndexType<T>(), usage);
+	}
+
+	void setDataUnbound(const void* data, size_t count, GLenum indexType, GLenum usage = GL_STATIC_DRAW) {
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_ID);
+		glBufferData(GL_COPY_WRITE_BUFFER, count * getIndexSize(indexType), data, usage);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		m_indexType = indexType;
 	}
 
 	void bind() const {
@@ -46,4 +75,5 @@ public:
 
 private:
 	GLuint m_ID;
+	GLenum m_indexType = GL_UNSIGNED_INT;
 };
\ No newline at end of file
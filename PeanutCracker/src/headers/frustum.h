@@ -12,6 +12,9 @@ public:
 	void constructFrustum(float aspect, const glm::mat4& projectionMat, const glm::mat4& viewMat);
 	bool isInFrustum(const BoundingSphere& sphere) const;
 
+	// (normal, distance), normals point inwards
+	glm::vec4 getPlane(int i) const { return glm::vec4(planes[i].normal, planes[i].distance); }
+
 private:
 	struct Plane {
 		glm::vec3 normal;
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "json.h"
+#include "mappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+
+// A glTF 2.0 asset opened for import: the JSON tree plus every buffer.
+// A .glb is mapped whole and its BIN chunk used in place, .bin files next to a .gltf are mapped too,
+// so accessors point straight at the file's bytes. Only base64 data: URIs are decoded into memory
+class GltfDocument {
+public:
+    // glTF reuses the GL enums for component types
+    static constexpr int BYTE           = 5120;
+    static constexpr int UNSIGNED_BYTE  = 5121;
+    static constexpr int SHORT          = 5122;
+    static constexpr int UNSIGNED_SHORT = 5123;
+    static constexpr int UNSIGNED_INT   = 5125;
+    static constexpr int FLOAT          = 5126;
+
+    // A typed, strided window into a buffer, bounds checked by getAccessor()
+    struct Accessor {
+        const unsigned char* data = nullptr;    // First element
+        size_t count          = 0;
+        size_t stride         = 0;              // Bytes between elements, never 0
+        int    componentType  = 0;
+        int    componentCount = 0;              // 1 for SCALAR up to 16 for MAT4
+        bool   isNormalized   = false;
+
+        size_t getElementSize() const;
+        bool isTight() const { return stride == getElementSize(); }
+
+        // Element i as floats, normalized integers mapped to [0, 1] or [-1, 1]. out holds componentCount
+        void read(size_t i, float* out) const;
+        uint32_t readIndex(size_t i) const;
+    };
+
+    GltfDocument() = default;
+
+    GltfDocument(const GltfDocument&) = delete;
+    GltfDocument& operator=(const GltfDocument&) = delete;
+
+    // False for malformed files and for extensions the importer can't honour, the caller falls back to Assimp
+    bool open(const std::filesystem::path& path);
+
+    const JsonValue& getJson() const { return m_json; }
+
+    // False for missing, sparse or out of bounds accessors
+    bool getAccessor(int index, Accessor& out) const;
+
+    // The image file a texture samples, empty for images embedded in a buffer or data: URI
+    std::filesystem::path getTexturePath(int textureIndex) const;
+
+    // The external .bin files the buffers were mapped from
+    const std::vector<std::filesystem::path>& getBufferPaths() const { return m_bufferPaths; }
+
+private:
+    struct Buffer {
+        const unsigned char* data = nullptr;
+        size_t               size = 0;
+    };
+
+    std::filesystem::path m_directory;
+    MappedFile            m_file;           // The .gltf or .glb itself
+    JsonValue             m_json;
+    std::vector<Buffer>   m_buffers;
+
+    std::vector<std::unique_ptr<MappedFile>>  m_bufferFiles;
+    std::vector<std::filesystem::path>        m_bufferPaths;        // Parallel to m_bufferFiles
+    std::vector<std::vector<unsigned char>>   m_decodedBuffers;     // data: URIs
+
+    bool openBuffers(const Buffer& binChunk);
+};
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+
+// Decoded float RGB image kept on the CPU, rows are in GL upload order
+struct HDRImage {
+    int width  = 0;
+    int height = 0;
+    std::vector<float> pixels;
+
+    bool load(const std::filesystem::path& path);
+    bool isValid() const { return width > 0 && height > 0; }
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "hdrImage.h"
+#include "iblCache.h"
+#include "sphericalHarmonics.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+
+// Bake parameters shared by the GPU passes (Cubemap, Scene) and the CPU baker.
+// They are part of the cache keys, so both paths read and write the same entries.
+namespace IBLSettings {
+    constexpr int      ENV_SIZE         = 512;
+    constexpr int      PREFILTER_SIZE   = 128;
+    constexpr int      PREFILTER_MIPS   = 5;
+    constexpr int      BRDF_LUT_SIZE    = 512;
+    constexpr unsigned SAMPLE_COUNT     = 1024;     // prefilter.frag and brdfLut.frag
+
+    // Bump whenever a bake shader (or the CPU mirror of it) changes
+    constexpr uint64_t BAKE_VERSION     = 3;
+    constexpr uint64_t BRDF_LUT_VERSION = 1;
+
+    int getMipCount(int size);
+
+    // 0 when the file can't be read. The sizes are the ones the entry is baked at
+    uint64_t getEnvironmentKey(const std::filesystem::path& hdrPath, int envSize, int prefilterSize);
+    uint64_t getBRDFLUTKey();
+}
+
+
+// Float RGB cubemap with a mip chain. Faces are in GL order (+X, -X, +Y, -Y, +Z, -Z) and
+// rows start at t = 0, the same layout glGetTexImage returns
+struct FloatCubemap {
+    int baseSize = 0;
+    std::vector<std::vector<float>> levels;     // 6 faces back to back per level
+
+    int getLevelSize(int level) const { return (baseSize >> level) > 0 ? (baseSize >> level) : 1; }
+    size_t getFaceFloatCount(int level) const {
+        size_t size = getLevelSize(level);
+        return size * size * 3;
+    }
+
+    // Bilinear inside a face (clamped at the edges), linear between mips
+    glm::vec3 sample(const glm::vec3& dir, float lod) const;
+};
+
+
+// CPU implementation of the IBL precomputation, mirrors the GPU passes:
+//   equirectToUnitCube.frag -> equirectToCubemap()
+//   glGenerateMipmap        -> generateMipmaps()
+//   prefilter.frag          -> prefilter()
+//   brdfLut.frag            -> integrateBRDF()
+// Work is split across the global thread pool, the BRDF integration runs 4 texels at a time with SSE.
+namespace IBLBaker {
+    FloatCubemap equirectToCubemap(const HDRImage& image, int size);
+    void generateMipmaps(FloatCubemap& cubemap);
+    FloatCubemap prefilter(const FloatCubemap& env, int size, int mipCount, unsigned sampleCount);
+    std::vector<float> integrateBRDF(int size, unsigned sampleCount);   // RG pairs, row = roughness
+
+    // Full bakes in the cache layout: [env, prefilter, irradiance SH] and [BRDF LUT]
+    std::vector<IBLImage> bakeEnvironment(const HDRImage& image, int envSize = IBLSettings::ENV_SIZE, int prefilterSize = IBLSettings::PREFILTER_SIZE);
+    std::vector<IBLImage> bakeBRDFLUT();
+
+    // Cache layout conversions
+    IBLImage toIBLImage(const FloatCubemap& cubemap);
+    IBLImage toIBLImage(const SH9& sh);
+    SH9 toSH9(const IBLImage& image);
+
+    // Error between two bakes of the same layout, used to check the CPU path against the GPU one
+    struct CompareResult {
+        float maxAbsError  = 0.0f;
+        float rmse         = 0.0f;
+        float relativeRmse = 0.0f;      // rmse / mean magnitude of the reference
+
+        bool isWithin(float maxRelativeRmse) const { return relativeRmse <= maxRelativeRmse; }
+    };
+    CompareResult compare(const IBLImage& reference, const IBLImage& other);
+
+    // compare() for each map of a full bake, either layout, against its tolerance. Logs a line per map,
+    // true if all of them pass
+    bool verify(const std::vector<IBLImage>& reference, const std::vector<IBLImage>& images);
+}
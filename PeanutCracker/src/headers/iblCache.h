@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+
+// One texture worth of baked IBL data, stored as half floats.
+// Every level holds all faces back to back (+X, -X, +Y, -Y, +Z, -Z for cubemaps).
+struct IBLImage {
+    uint32_t faceCount = 1;     // 1 = 2D, 6 = cubemap
+    uint32_t channels  = 3;     // 2 = RG16F, 3 = RGB16F
+    uint32_t baseSize  = 0;     // Square textures only
+    std::vector<std::vector<uint16_t>> levels;
+
+    uint32_t getLevelSize(uint32_t level) const { return (baseSize >> level) > 0 ? (baseSize >> level) : 1; }
+    size_t getFaceHalfCount(uint32_t level) const {
+        size_t size = getLevelSize(level);
+        return size * size * channels;
+    }
+};
+
+
+// Disk cache for precomputed IBL maps.
+// Entries are keyed by a hash of the source HDR contents and the bake parameters, so editing
+// the file or changing a resolution produces a new entry instead of stale data.
+//
+// File layout (native endian, KTX2-like: a header, per image descriptors, raw level blobs):
+//   char     magic[8]      "PCIBL01\n"
+//   uint64_t key
+//   uint32_t imageCount
+//   per image:
+//     uint32_t faceCount, channels, baseSize, levelCount
+//     per level:
+//       uint64_t byteLength
+//       byteLength bytes of half floats
+class IBLCache {
+public:
+    explicit IBLCache(const std::filesystem::path& i_dir);
+
+    bool load(uint64_t key, std::vector<IBLImage>& images) const;
+    bool store(uint64_t key, const std::vector<IBLImage>& images) const;
+
+    std::filesystem::path getEntryPath(uint64_t key) const;
+
+    // FNV-1a 64
+    static uint64_t hashFile(const std::filesystem::path& path);  // Returns 0 when the file can't be read
+    static uint64_t hashString(const std::string& str);
+    static uint64_t hashCombine(uint64_t hash, uint64_t value);
+
+private:
+    std::filesystem::path m_dir;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "sphericalHarmonics.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+
+// Grid of L1 SH irradiance probes for local diffuse light.
+// Probes sit on the corners of a resolution.x * resolution.y * resolution.z lattice spanning
+// [boundsMin, boundsMax]. Each probe is stored per colour channel as (L0, L1y, L1z, L1x) in three
+// RGBA16F 3D textures, so model.frag gets trilinear blending between neighbouring probes for free.
+// The renderer captures the probes a few per frame and hands the projected SH back through setProbe().
+struct IrradianceVolume {
+    static constexpr int MAX_RESOLUTION = 32;
+
+    glm::vec3  boundsMin  = glm::vec3(-10.0f, 0.0f, -10.0f);
+    glm::vec3  boundsMax  = glm::vec3( 10.0f, 6.0f,  10.0f);
+    glm::ivec3 resolution = glm::ivec3(8, 4, 8);
+    float farPlane  = 200.0f;
+    bool  isEnabled = true;
+    bool  toBeBaked = false;
+    uint32_t version = 1;   // Bump after editing, a bake in flight restarts
+
+    IrradianceVolume();
+    ~IrradianceVolume();
+
+    IrradianceVolume(const IrradianceVolume&) = delete;
+    IrradianceVolume& operator=(const IrradianceVolume&) = delete;
+
+    int getProbeCount() const { return resolution.x * resolution.y * resolution.z; }
+    glm::vec3 getProbePosition(int index) const;
+
+    // --BAKE
+    void beginBake();                                   // Sizes the coefficient arrays for the current grid
+    void setProbe(int index, const SH9& irradiance);    // Irradiance as returned by SphericalHarmonics::toIrradiance()
+    void finishBake();                                  // Uploads the grid, the baked layout becomes current
+
+    // --SAMPLING, the layout of the last finished bake
+    bool isBaked() const { return m_isBaked; }
+    uint32_t getBakeCount() const { return m_bakeCount; }
+    glm::vec3  getBakedMin() const { return m_bakedMin; }
+    glm::vec3  getBakedMax() const { return m_bakedMax; }
+    glm::ivec3 getBakedResolution() const { return m_bakedResolution; }
+
+    void bind(unsigned int firstSlot) const;            // R, G, B on three consecutive units
+
+private:
+    std::array<GLuint, 3>                 m_textureIDs = {};
+    std::array<std::vector<glm::vec4>, 3> m_coeffs;     // Per channel, x fastest then y then z
+
+    glm::vec3  m_bakingMin = glm::vec3(0.0f);
+    glm::vec3  m_bakingMax = glm::vec3(0.0f);
+    glm::ivec3 m_bakingResolution = glm::ivec3(0);
+
+    bool       m_isBaked   = false;
+    uint32_t   m_bakeCount = 0;
+    glm::vec3  m_bakedMin  = glm::vec3(0.0f);
+    glm::vec3  m_bakedMax  = glm::vec3(0.0f);
+    glm::ivec3 m_bakedResolution = glm::ivec3(0);
+};
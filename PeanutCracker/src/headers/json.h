@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+// Read-only JSON tree for the small documents the engine reads, like glTF headers.
+// Lookups never throw: a missing key or index gives a shared null value, so chains like
+// json["scenes"][0]["nodes"] are safe and end in the caller's fallback
+class JsonValue {
+public:
+    enum class Type {
+        NUL,
+        BOOLEAN,
+        NUMBER,
+        STRING,
+        ARRAY,
+        OBJECT
+    };
+
+    // Replaces out with the document in text, which doesn't have to be null terminated
+    static bool parse(const char* text, size_t length, JsonValue& out, std::string* error = nullptr);
+
+    Type getType() const { return m_type; }
+    bool isNull() const   { return m_type == Type::NUL; }
+    bool isNumber() const { return m_type == Type::NUMBER; }
+    bool isString() const { return m_type == Type::STRING; }
+    bool isArray() const  { return m_type == Type::ARRAY; }
+    bool isObject() const { return m_type == Type::OBJECT; }
+
+    // Elements of an array or members of an object, 0 for anything else
+    size_t size() const { return m_elements.size(); }
+
+    const JsonValue& operator[](size_t index) const;
+    const JsonValue& operator[](int index) const { return (*this)[index < 0 ? m_elements.size() : static_cast<size_t>(index)]; }
+    const JsonValue& operator[](const char* key) const;
+    bool has(const char* key) const;
+
+    // Members in file order, for objects whose keys aren't known up front
+    const std::string& getKey(size_t index) const;
+
+    double getNumber(double fallback = 0.0) const { return m_type == Type::NUMBER ? m_number : fallback; }
+    float  getFloat(float fallback = 0.0f) const  { return m_type == Type::NUMBER ? static_cast<float>(m_number) : fallback; }
+    int    getInt(int fallback = 0) const         { return m_type == Type::NUMBER && m_number >= -2147483648.0 && m_number <= 2147483647.0 ? static_cast<int>(m_number) : fallback; }
+    bool   getBool(bool fallback = false) const   { return m_type == Type::BOOLEAN ? m_bool : fallback; }
+    const std::string& getString() const          { return m_string; }     // Empty unless a string
+
+private:
+    friend class JsonParser;
+
+    Type        m_type   = Type::NUL;
+    bool        m_bool   = false;
+    double      m_number = 0.0;
+    std::string m_string;
+
+    std::vector<JsonValue>   m_elements;    // Array elements or object values
+    std::vector<std::string> m_keys;        // Object keys, parallel to m_elements
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+
+
+// Decoded 8-bit image kept on the CPU so texture files can be decoded off the GL thread
+struct LDRImage {
+    int width    = 0;
+    int height   = 0;
+    int channels = 0;
+    std::vector<unsigned char> pixels;
+    std::vector<std::vector<unsigned char>> mips;   // Level 1 down to 1x1, empty until generateMips()
+
+    bool load(const std::filesystem::path& path);
+    bool isValid() const { return width > 0 && height > 0 && channels > 0; }
+
+    // Box filtered chain, built on the decoding worker so uploads never wait on glGenerateMipmap.
+    // The colour channels of sRGB images are averaged in linear space
+    void generateMips(bool sRGB);
+
+    int getLevelCount() const  { return 1 + static_cast<int>(mips.size()); }
+    int getLevelWidth(int level) const  { return std::max(width >> level, 1); }
+    int getLevelHeight(int level) const { return std::max(height >> level, 1); }
+    size_t getLevelSize(int level) const { return static_cast<size_t>(getLevelWidth(level)) * getLevelHeight(level) * channels; }
+    const unsigned char* getLevelData(int level) const { return level == 0 ? pixels.data() : mips[level - 1].data(); }
+};
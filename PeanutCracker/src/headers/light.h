@@ -3,6 +3,8 @@
 #include <glm/glm.hpp>
 #include "shadowCasterComponent.h"
 
+#include <cstdint>
+
 
 struct Light {
     glm::vec3 color      = glm::vec3(1.0f);
@@ -24,6 +26,7 @@ struct DirectionalLight {
     Light light;
     float range;
     bool  isVisible = true;
+    uint32_t version = 1;   // Bump after editing, the scene only re-packs lights whose version changed
     ShadowCasterComponent shadowCasterComponent;
 
     DirectionalLight()
@@ -51,6 +54,7 @@ struct PointLight {
     Light light;
     float radius;
     bool  isVisible = true;
+    uint32_t version = 1;   // Bump after editing, the scene only re-packs lights whose version changed
     ShadowCasterComponent shadowCasterComponent;
 
     PointLight()
@@ -79,6 +83,7 @@ struct SpotLight {
     float inCosCutoff;
     float outCosCutoff;
     bool  isVisible = true;
+    uint32_t version = 1;   // Bump after editing, the scene only re-packs lights whose version changed
     ShadowCasterComponent shadowCasterComponent;
 
     SpotLight()
@@ -4,6 +4,7 @@
 #include "vao.h"
 #include "vbo.h"
 #include "ebo.h"
+#include "meshlet.h"
 
 #include <glad/glad.h>
 
@@ -12,46 +13,103 @@
 
 #include "material.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
 
 
-const unsigned int MAX_BONE_INFLUENCE = 4;
-
-
+// Packed mesh vertex, 28 bytes.
+// Normal and tangent are octahedral encoded snorm16 pairs. The tangent's z holds the handedness
+// and model.vert rebuilds the bitangent as cross(N, T) * sign. UVs are half floats.
+// Bones aren't stored here, a skinned mesh would carry its own BONE_ID / BONE_W stream
 struct Vertex {
     glm::vec3   position;
-    glm::vec3   normal;
-    glm::vec2   texCoords;
-    glm::vec3   tangent;
-    glm::vec3   bitangent;
+    int16_t     normal[2];
+    int16_t     tangent[4];     // x, y octahedral, z handedness, w padding
+    uint16_t    texCoords[2];
+
+    static Vertex pack(const glm::vec3& position, const glm::vec3& normal, const glm::vec2& texCoords,
+                       const glm::vec3& tangent, const glm::vec3& bitangent);
+};
+static_assert(sizeof(Vertex) == 28, "Vertex layout changed, update Mesh::linkAttributes() and the mesh cache version");
+
+// One glDrawElementsBaseVertex call. Meshes with more than 65536 vertices are split into ranges
+// whose vertices fit 16 bit indices relative to baseVertex, a mesh that doesn't split well stays 32 bit
+struct DrawRange {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    int32_t  baseVertex = 0;
+};
 
-    int         m_boneIDs[MAX_BONE_INFLUENCE];
-    float       m_weights[MAX_BONE_INFLUENCE];
+// One level of detail: a slice of the EBO and the ranges that draw it. Every level indexes the same
+// vertices, error is how far (model space) the simplified surface may sit from the original
+struct MeshLod {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    uint32_t firstRange = 0;
+    uint32_t rangeCount = 0;
+    float    error      = 0.0f;
 };
 
-struct MaterialTexture {
-    unsigned int    id = 0;
-    std::string     type;
-    std::string     path;
+// What a Mesh keeps on the CPU once its buffers are on the GPU
+enum class MeshRetention {
+    NONE,           // Nothing, the default
+    POSITIONS       // Positions and indices, for consumers like a picking BVH, collision or baking
 };
 
 class Mesh {
 public:
-    std::vector<Vertex>			vertices;
+    // CPU copies, empty unless the mesh was built with MeshRetention::POSITIONS
+    std::vector<glm::vec3>		positions;
     std::vector<unsigned int>	indices;
-    std::vector<MaterialTexture>		textures;
     std::shared_ptr<Material>  material;
 
-    Mesh(std::vector<Vertex> i_vertices, std::vector<unsigned int> i_indices, std::shared_ptr<Material> i_mat);
+    // Buffers already filled on the upload context, only the VAOs are built here.
+    // i_positions and i_indices are the retained copies (32 bit, relative to vertex 0, LOD 0 only) and are
+    // usually empty, the ranges and LODs describe what's in the EBO
+    // i_instances places the mesh in its model, one instanced draw covers all of them
+    Mesh(std::vector<glm::vec3> i_positions, std::vector<unsigned int> i_indices, std::vector<DrawRange> i_ranges, std::vector<MeshLod> i_lods,
+         std::vector<Meshlet> i_meshlets, const std::vector<glm::mat4>& i_instances, std::shared_ptr<Material> i_mat,
+         VBO&& i_VBO, VBO&& i_positionVBO, EBO&& i_EBO);
+
+    MeshRetention getRetention() const { return positions.empty() ? MeshRetention::NONE : MeshRetention::POSITIONS; }
 
-    void draw(const Shader& shader, bool isShadowPass = false) const;
+    int getInstanceCount() const { return m_instanceCount; }
+
+    // Largest axis scale across the instances, a LOD's error grows by this much in model space
+    float getMaxInstanceScale() const { return m_maxInstanceScale; }
+
+    int getLodCount() const { return static_cast<int>(m_lods.size()); }
+    const MeshLod& getLod(int lod) const { return m_lods[std::clamp(lod, 0, getLodCount() - 1)]; }
+
+    // Levels past the last one draw the coarsest. LOD 0 of a single instance mesh with a view and meshlets
+    // draws only the meshlets that survive culling, merged into one glMultiDrawElementsBaseVertex call
+    void draw(const Shader& shader, int lod = 0, const MeshletView* view = nullptr) const;
+
+    // Depth, shadow and picking passes: positions only, no material
+    void drawDepth(int lod = 0) const;
 
 private:
     VAO m_VAO;
     VBO m_VBO;
     EBO m_EBO;
-
-    void setupMesh();
+    std::vector<DrawRange> m_ranges;
+    std::vector<MeshLod>   m_lods;
+    MeshletSet             m_meshlets;
+
+    // Tightly packed copy of the positions, 12 bytes a vertex instead of a whole Vertex
+    VAO m_depthVAO;
+    VBO m_positionVBO;
+
+    // Instance transforms, bound to both VAOs
+    VBO m_instanceVBO;
+    int m_instanceCount = 1;
+    float m_maxInstanceScale = 1.0f;
+
+    void setupInstances(const std::vector<glm::mat4>& transforms);
+    void drawRanges(int lod) const;
+    void drawMeshlets(const MeshletView& view) const;
+    void linkAttributes() const;
 };
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "model.h"
+
+#include <cstdint>
+#include <filesystem>
+
+
+// Disk cache of cooked models: the output of Model::importModel() in the layout the GPU wants.
+// Entries are named by a hash of the source path, the LOD settings and the cook version, and remember the mtime and
+// size of the source and of every file its import read (glTF buffers, OBJ material libraries), so touching any of
+// them re-imports it instead of serving stale data.
+// A hit maps the file and points the MeshData straight at the vertex and index blobs, the upload
+// jobs read from the mapping and nothing is parsed or copied on the CPU. Textures aren't cooked,
+// the material table keeps their paths and they're decoded as usual.
+//
+// File layout (native endian, blobs 16 byte aligned):
+//   char     magic[8]      "PCMSH01\n"
+//   uint64_t key
+//   int64_t  sourceTime    Ticks of std::filesystem::last_write_time
+//   uint64_t sourceSize
+//   uint32_t vertexStride  sizeof(Vertex)
+//   float    aabbMin[3], aabbMax[3]
+//   uint32_t materialCount, meshCount
+//   uint32_t dependencyCount
+//   per dependency:
+//     string   path                                            (as the import opened it)
+//     int64_t  time; uint64_t size                             (same stamp as the source)
+//   per material:
+//     string   name, albedo, normal, metallic, roughness, orm   (uint32_t length + UTF-8 bytes)
+//     float    baseColor[4], metallic, roughness
+//   per mesh:
+//     uint32_t materialIndex, vertexCount, indexCount, indexSize (2 or 4)
+//     float    boundsMin[3], boundsMax[3]
+//     uint32_t rangeCount
+//     per range: uint32_t firstIndex, indexCount; int32_t baseVertex
+//     uint32_t lodCount
+//     per LOD: uint32_t firstIndex, indexCount, firstRange, rangeCount; float error
+//     uint32_t meshletCount
+//     Meshlet  meshlets[meshletCount]                            (as laid out in memory)
+//     uint32_t instanceCount
+//     float    instances[instanceCount][16]                      (column major)
+//     uint64_t vertexOffset, positionOffset, indexOffset         (from the start of the file)
+//   vertex, position and index blobs
+class MeshCache {
+public:
+    explicit MeshCache(const std::filesystem::path& i_dir);
+
+    // Maps the entry for source, data.mapping keeps it alive until the uploads are done
+    bool load(const std::filesystem::path& source, const LodSettings& lodSettings, ModelData& data) const;
+    bool store(const std::filesystem::path& source, const LodSettings& lodSettings, const ModelData& data) const;
+
+    std::filesystem::path getEntryPath(const std::filesystem::path& source, const LodSettings& lodSettings) const;
+
+private:
+    std::filesystem::path m_dir;
+
+    static uint64_t getKey(const std::filesystem::path& source, const LodSettings& lodSettings);
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "meshlet.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+// Post-transform vertex cache efficiency of an index buffer, simulated as a FIFO
+struct VertexCacheStats {
+    size_t triangles   = 0;
+    size_t transformed = 0;     // Cache misses, each one is a vertex shader invocation
+    size_t vertices    = 0;     // Distinct vertices referenced
+
+    float getACMR() const { return triangles ? static_cast<float>(transformed) / static_cast<float>(triangles) : 0.0f; }    // Misses per triangle, 0.5 - 3
+    float getATVR() const { return vertices  ? static_cast<float>(transformed) / static_cast<float>(vertices)  : 0.0f; }    // Misses per vertex, 1 is ideal
+
+    VertexCacheStats& operator+=(const VertexCacheStats& other) {
+        triangles   += other.triangles;
+        transformed += other.transformed;
+        vertices    += other.vertices;
+        return *this;
+    }
+};
+
+
+// Import time reordering and simplification of triangle lists, run on the worker after a mesh is processed.
+// optimizeVertexCache() is Tipsify (Sander et al. 2007), it fans around recently used vertices and
+// records where it had to jump, optimizeOverdraw() then sorts those clusters front to back as seen
+// from outside the mesh, and optimizeVertexFetch() renumbers vertices in first-use order.
+// simplify() builds LODs that index into the same vertices, buildMeshlets() cuts a triangle list into culling units.
+namespace MeshOptimizer {
+    constexpr unsigned int CACHE_SIZE = 16;     // Roughly what current GPUs keep, also used for the stats
+
+    VertexCacheStats analyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = CACHE_SIZE);
+
+    // Returns the reordered triangles. clusterStarts receives the first triangle of every cluster
+    std::vector<unsigned int> optimizeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount,
+                                                  std::vector<size_t>* clusterStarts = nullptr, unsigned int cacheSize = CACHE_SIZE);
+
+    // Reorders the clusters so outward facing ones come first. Clusters whose local ACMR stays within
+    // threshold * the mesh's are split further, which keeps the cache win while giving the sort more freedom
+    void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions,
+                          const std::vector<size_t>& clusterStarts, float threshold = 1.05f);
+
+    // Renumbers the vertices in the order the indices first touch them and rewrites the indices.
+    // Returns the remap table (old index -> new index), unreferenced vertices go to the end
+    std::vector<unsigned int> optimizeVertexFetch(std::vector<unsigned int>& indices, size_t vertexCount);
+
+    // Quadric error edge collapse (Garland & Heckbert 1997) onto existing vertices, so the result indexes
+    // the same vertex buffer. Stops at targetIndexCount or once the next collapse would move the surface
+    // further than targetError (model space units). Border and UV/normal seam vertices are kept in place.
+    // resultError receives the largest error of the collapses that were made
+    std::vector<unsigned int> simplify(const std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions,
+                                       size_t targetIndexCount, float targetError, float* resultError = nullptr);
+
+    // Cuts [firstIndex, firstIndex + indexCount) into consecutive meshlets without reordering, so the
+    // vertex cache order is kept. Appends them to meshlets with their bounds and normal cones
+    void buildMeshlets(const std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions,
+                       size_t firstIndex, size_t indexCount, uint32_t range, std::vector<Meshlet>& meshlets);
+
+    template <typename T>
+    void remapVertices(std::vector<T>& vertices, const std::vector<unsigned int>& remap) {
+        std::vector<T> result(vertices.size());
+        for (size_t i = 0; i < vertices.size(); ++i) {
+            result[remap[i]] = std::move(vertices[i]);
+        }
+        vertices = std::move(result);
+    }
+}
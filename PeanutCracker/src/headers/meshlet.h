@@ -0,0 +1,60 @@
+#pragma once
+
+#include "frustum.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+// A run of consecutive triangles in a mesh's LOD 0, at most MAX_VERTICES distinct vertices and
+// MAX_TRIANGLES triangles, built at import by MeshOptimizer::buildMeshlets().
+// The sphere bounds it for frustum culling. The cone bounds its triangle normals: when the camera
+// sits inside the cone's back side every triangle faces away and the whole meshlet can go.
+// Stored as is in the mesh cache, so the layout is fixed
+struct Meshlet {
+    static constexpr unsigned int MAX_VERTICES  = 64;
+    static constexpr unsigned int MAX_TRIANGLES = 124;
+
+    uint32_t  firstIndex = 0;
+    uint32_t  indexCount = 0;
+    uint32_t  range      = 0;       // DrawRange it lies in, meshlets never straddle two
+    glm::vec3 center     = glm::vec3(0.0f);
+    float     radius     = 0.0f;
+    glm::vec3 coneAxis   = glm::vec3(0.0f, 0.0f, 1.0f);
+    float     coneCutoff = 1.0f;    // sin of the normals' spread around the axis, 1 never culls
+};
+static_assert(sizeof(Meshlet) == 44, "Meshlet layout changed, update the mesh cache version");
+
+// One view of one node, with the frustum planes and the camera moved into the model's space.
+// The planes keep world units, so a sphere is tested with radius * radiusScale
+struct MeshletView {
+    glm::vec4 planes[6];
+    glm::vec3 cameraPos      = glm::vec3(0.0f);
+    float     radiusScale    = 1.0f;
+    bool      isConeCullable = true;    // Mirrored transforms swap front and back faces
+
+    static MeshletView create(const Frustum& frustum, const glm::vec3& viewPos, const glm::mat4& worldMatrix);
+};
+
+// A mesh's meshlets, with the bounds also kept as structure-of-arrays for the SSE culling path
+class MeshletSet {
+public:
+    MeshletSet() = default;
+    explicit MeshletSet(std::vector<Meshlet> i_meshlets);
+
+    bool empty() const { return m_meshlets.empty(); }
+    size_t size() const { return m_meshlets.size(); }
+    const Meshlet& operator[](size_t i) const { return m_meshlets[i]; }
+
+    // visible[i] is 1 for every meshlet that survives the frustum and cone tests, returns how many did
+    size_t cull(const MeshletView& view, std::vector<uint8_t>& visible) const;
+
+private:
+    std::vector<Meshlet> m_meshlets;
+
+    std::vector<float> m_centerX, m_centerY, m_centerZ, m_radius;
+    std::vector<float> m_axisX, m_axisY, m_axisZ, m_cutoff;
+};
@@ -3,6 +3,7 @@
 #include "mesh.h"
 #include "shader.h"
 #include "material.h"
+#include "ldrImage.h"
 
 #include <glad/glad.h> 
 #include <glm/glm.hpp>
@@ -17,18 +18,90 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
 #include <filesystem>
 #include <map>
 #include <vector>
 
 
 class AssetManager;
+class MappedFile;
+class GltfDocument;
+class JsonValue;
+struct VertexCacheStats;
 
 struct AABB {
 	glm::vec3 min = glm::vec3(FLT_MAX);
 	glm::vec3 max = glm::vec3(-FLT_MAX);
 };
 
+// How far import simplifies each mesh. Part of the mesh cache key, so changing it re-cooks
+struct LodSettings {
+	int   maxLevels = 4;        // Including the full mesh, 1 turns LODs off
+	float reduction = 0.5f;     // Triangle ratio between consecutive levels
+	float maxError  = 0.05f;    // Relative to the mesh's bounding radius, the chain stops before exceeding it
+	size_t minIndexCount = 384; // Meshes smaller than this aren't worth another level
+
+	uint64_t getKey() const;
+};
+
+// CPU side results of an import, built on a worker thread and uploaded by ModelLoader.
+// A MeshCache hit leaves the vectors empty and points into ModelData::mapping instead.
+// A mesh used by one node has that node's transform baked in and a single identity instance,
+// one used by several nodes stays in its own space and gets one instance per node
+struct MeshData {
+	std::vector<Vertex>       vertices;
+	std::vector<glm::vec3>    positions;        // Depth-only stream, same order as vertices
+	std::vector<unsigned int> indices;          // 32 bit, relative to vertex 0
+	std::vector<uint16_t>     shortIndices;     // What gets uploaded when indexType is GL_UNSIGNED_SHORT, relative to each range
+	std::vector<DrawRange>    ranges;
+	std::vector<MeshLod>      lods;             // Every level back to back in indices, LOD 0 first
+	std::vector<Meshlet>      meshlets;         // Culling units over LOD 0, empty for small meshes
+	std::vector<glm::mat4>    instances;        // Mesh to model space, one per referencing node
+	GLenum                    indexType       = GL_UNSIGNED_INT;
+	const Vertex*             mappedVertices  = nullptr;
+	const glm::vec3*          mappedPositions = nullptr;
+	const void*               mappedIndices   = nullptr;    // In indexType
+	size_t                    vertexCount    = 0;
+	size_t                    indexCount     = 0;
+	unsigned int              materialIndex  = 0;
+	AABB                      bounds;
+
+	const Vertex*    getVertexData() const   { return mappedVertices ? mappedVertices : vertices.data(); }
+	const glm::vec3* getPositionData() const { return mappedPositions ? mappedPositions : positions.data(); }
+	const void*      getIndexData() const {
+		if (mappedIndices) return mappedIndices;
+		return indexType == GL_UNSIGNED_SHORT ? static_cast<const void*>(shortIndices.data()) : static_cast<const void*>(indices.data());
+	}
+};
+
+// What AssetManager needs to build a Material, read out of the aiMaterial on the worker.
+// Empty paths fall back to the solid colour factors
+struct MaterialDesc {
+	std::string name;
+
+	std::filesystem::path albedoPath;
+	std::filesystem::path normalPath;
+	std::filesystem::path metallicPath;
+	std::filesystem::path roughnessPath;
+	std::filesystem::path ormPath;
+
+	glm::vec4 baseColor = glm::vec4(1.0f, 0.0f, 1.0f, 1.0f);
+	float     metallic  = 0.0f;
+	float     roughness = 0.5f;
+};
+
+struct ModelData {
+	bool                      isValid = false;
+	std::string               directory;
+	AABB                      aabb;
+	std::vector<MeshData>     meshes;
+	std::vector<MaterialDesc> materials;
+	std::map<std::string, LDRImage> images;    // Every texture the materials reference, by path
+	std::shared_ptr<MappedFile>     mapping;   // Cooked mesh blobs, held until they're uploaded
+	std::vector<std::filesystem::path> dependencies;   // Files the import read besides the source, like glTF buffers or an OBJ's .mtl
+};
+
 class Model {
 public:
 	std::vector<Mesh>    meshes;            // One mesh per material type
@@ -37,18 +110,59 @@ public:
 	std::string          path;
 	AABB				 aabb;
 	bool                 gammaCorrection;
+	MeshRetention        retention = MeshRetention::NONE;   // Read once the GPU buffers are filled
+	std::vector<float>   lodErrors;         // Worst mesh error per level, model space, filled with the meshes
 
-	Model(AssetManager* assetManager, std::string const& path, bool gamma = false);
+	// Empty until a ModelLoader fills it in, drawn as a placeholder box in the meantime
+	Model(std::string const& path, bool gamma = false);
 
-	void draw(const Shader& shader);
+	// With a view, big meshes cull their meshlets against it before drawing LOD 0
+	void draw(const Shader& shader, int lod = 0, const MeshletView* view = nullptr);
+	void drawDepth(int lod = 0) const;     // Positions only, for depth, shadow and picking shaders
 
-	int loadModel(AssetManager* assetManager, std::string const& path);
+	int   getLodCount() const { return std::max(static_cast<int>(lodErrors.size()), 1); }
+	float getLodError(int lod) const { return lodErrors.empty() ? 0.0f : lodErrors[std::clamp(lod, 0, getLodCount() - 1)]; }
+
+	bool isReady() const { return m_isReady; }
+	void markReady() { m_isReady = true; }
+
+	// glTF natively, anything else through Assimp, then mesh processing. Touches no GL state, so it runs on the thread pool
+	static ModelData importModel(std::string const& path, const LodSettings& lodSettings = LodSettings());
+
+	// Decodes every texture the materials reference into data.images with its mip chain, in parallel
+	static void decodeImages(ModelData& data);
 
 private:
-	Mesh processMesh(AssetManager* assetManager, aiMesh* mesh, const aiScene* scene, const glm::mat4& transform);
+	bool m_isReady = false;
+
+	// Fill data.meshes and data.materials, false if the file couldn't be read
+	static bool importGltf(const std::filesystem::path& path, ModelData& data);
+	static bool importAssimp(std::string const& path, ModelData& data);
+
+	// Converts one aiMesh with the transform baked in, pre-sized outputs and its own bounds
+	static MeshData processMesh(aiMesh* mesh, const glm::mat4& transform);
+
+	// Triangle order for the vertex cache and overdraw, then vertex order for fetch
+	static void optimizeMesh(MeshData& mesh, VertexCacheStats& before, VertexCacheStats& after);
+
+	// Appends the simplified levels after LOD 0 in mesh.indices
+	static void buildLods(MeshData& mesh, const LodSettings& settings);
+
+	// Picks 16 bit indices and the draw ranges of every level, expects the vertices in fetch order
+	static void packIndices(MeshData& mesh);
+
+	// Cuts LOD 0 into meshlets along its draw ranges
+	static void buildMeshlets(MeshData& mesh);
 	
-	void processNode(AssetManager* assetManager, aiNode* node, const aiScene* scene, const glm::mat4& parentTransform);
+	// Collects the model space transform of every node reference, per aiMesh
+	static void processNode(aiNode* node, const glm::mat4& parentTransform, std::vector<std::vector<glm::mat4>>& meshTransforms);
+
+	static MaterialDesc describeMaterial(aiMaterial* mat, const std::filesystem::path& dir);
+
+	// glTF counterparts of processNode(), processMesh() and describeMaterial()
+	static void processGltfNode(const JsonValue& json, int nodeIndex, const glm::mat4& parentTransform, std::vector<std::vector<glm::mat4>>& meshTransforms, size_t depth);
+	static bool processPrimitive(const GltfDocument& doc, const JsonValue& primitive, const glm::mat4& transform, MeshData& data);
+	static MaterialDesc describeGltfMaterial(const GltfDocument& doc, const JsonValue& material);
 	
-	glm::mat4 aiMatrix4x4ToGlm(const aiMatrix4x4& from);
+	static glm::mat4 aiMatrix4x4ToGlm(const aiMatrix4x4& from);
 };
-
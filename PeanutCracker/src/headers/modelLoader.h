@@ -0,0 +1,88 @@
+#pragma once
+
+#include "model.h"
+#include "meshCache.h"
+#include "material.h"
+#include "texture.h"
+#include "uploadContext.h"
+#include "vbo.h"
+#include "ebo.h"
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+class AssetManager;
+
+// Imports a model without stalling the editor.
+// The MeshCache lookup (or the glTF / Assimp import and mesh processing on a miss) and texture decoding run on
+// the thread pool and produce a ModelData.
+// The vertex buffers and the textures' mip tails are then created on the upload context, one job each,
+// the rest of every mip chain streams in through the AssetManager's TextureStreamer afterwards.
+// Once the last job's fence has signalled, update() adopts them: materials and VAOs are built
+// on the main thread a step at a time within the frame budget. The Model is drawn as a
+// placeholder until the last mesh is in.
+class ModelLoader {
+public:
+    enum class State {
+        IMPORTING,
+        UPLOADING,
+        BUILDING_MATERIALS,
+        BUILDING_MESHES,
+        DONE,
+        FAILED
+    };
+
+    ModelLoader(const std::string& i_path, std::shared_ptr<Model> i_model, const MeshCache& i_cache, const LodSettings& i_lodSettings);
+
+    ModelLoader(const ModelLoader&) = delete;
+    ModelLoader& operator=(const ModelLoader&) = delete;
+
+    // Returns true once the load has finished, successfully or not
+    bool update(AssetManager& assetManager, UploadContext& uploadContext, double budgetMs);
+
+    State getState() const { return m_state; }
+    bool hasFailed() const { return m_state == State::FAILED; }
+    Model* getModel() const { return m_model.get(); }
+
+private:
+    struct PendingTexture {
+        std::string              path;
+        bool                     isSRGB = false;
+        std::shared_ptr<Texture> texture;       // Samples its mip tail once the batch's last ticket completes
+    };
+
+    // Shared with the upload jobs, which may outlive the loader
+    struct UploadBatch {
+        ModelData                   data;
+        std::vector<PendingTexture> textures;
+        std::vector<VBO>            vbos;       // Indexed like data.meshes
+        std::vector<VBO>            positionVbos;
+        std::vector<EBO>            ebos;
+    };
+
+    std::string            m_path;
+    std::shared_ptr<Model> m_model;
+    State                  m_state = State::IMPORTING;
+
+    std::future<ModelData>        m_pending;
+    std::shared_ptr<UploadBatch>  m_batch;
+    std::shared_ptr<UploadTicket> m_lastTicket;
+
+    std::vector<std::shared_ptr<Material>> m_materials;     // Indexed like data.materials
+
+    // Step cursors
+    size_t m_nextMaterial = 0;
+    size_t m_nextMesh     = 0;
+
+    static ModelData decode(const std::string& path, const MeshCache& cache, const LodSettings& lodSettings);
+
+    MeshRetention m_retention = MeshRetention::NONE;        // What releaseCpuData() kept
+
+    void submitUploads(AssetManager& assetManager, UploadContext& uploadContext);
+    void releaseCpuData();
+    void runStep(AssetManager& assetManager);
+    void finish();
+};
@@ -64,7 +64,7 @@ public:
 
 
     /* === INTERFACE =========================================================== */
-    void draw(const Shader& shader, const glm::mat4& worldMatrix) const;
+    void draw(const Shader& shader, const glm::mat4& worldMatrix, int lod = 0, const MeshletView* view = nullptr) const;
 
-    void drawShadow(const glm::mat4& modelMatrix, const Shader& depthShader) const;
+    void drawShadow(const glm::mat4& modelMatrix, const Shader& depthShader, int lod = 0) const;
 };
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "shader.h"
+#include "texture.h"
+#include "vao.h"
+#include "iblBaker.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <vector>
+
+
+// Prefiltered radiance of every reflection probe, packed into one GL_TEXTURE_2D_ARRAY.
+// Cube map arrays need GL 4.0 and the context is 3.3, so each probe stores its prefilter chain
+// as an octahedral map in one layer. The model shader samples every probe through one unit.
+//
+// One extra layer is kept out of the free list for bakes: the new chain is filtered there and
+// then swapped with the probe's layer, so a probe never shows a half-filtered map.
+class ProbeAtlas {
+public:
+    static constexpr int MAX_PROBES = 32;
+    static constexpr int SIZE       = 2 * IBLSettings::PREFILTER_SIZE;  // One octahedral map ~ the texels of a 128 cube
+    static constexpr int MIPS       = IBLSettings::PREFILTER_MIPS;
+
+    ProbeAtlas();
+    ~ProbeAtlas();
+
+    ProbeAtlas(const ProbeAtlas&) = delete;
+    ProbeAtlas& operator=(const ProbeAtlas&) = delete;
+
+    // --SLOTS
+    int  allocate();                    // Returns -1 when every layer is taken
+    void release(int layer);
+    bool isFull() const { return m_freeLayers.empty(); }
+
+    int getStagingLayer() const { return m_stagingLayer; }
+    int swapStaging(int layer);         // Returns the staging layer, layer becomes the new staging one
+
+    // --BAKE
+    // GGX-filters rows [firstRow, firstRow + rowCount) of one mip from a captured environment cubemap
+    void prefilterRows(const Texture& envMap, int envSize, const Shader& prefilterShader, int layer, int mip, int firstRow, int rowCount) const;
+
+    static int getMipSize(int mip) { return std::max(SIZE >> mip, 1); }
+
+    void bind(unsigned int slot) const;
+
+private:
+    GLuint m_textureID = 0;
+    GLuint m_fbo       = 0;
+    VAO    m_emptyVAO;                  // Fullscreen triangle is generated from gl_VertexID
+
+    std::vector<int> m_freeLayers;
+    int              m_stagingLayer = MAX_PROBES;
+};
@@ -1,22 +1,23 @@
 #pragma once
 
 #include "transform.h"
-#include "cubemap.h"
+
+#include <cstdint>
+
+// The (at most) two probes an object reflects and how much of each, picked on the CPU per draw
+struct RefProbeSelection {
+    glm::ivec2 indices = glm::ivec2(-1);      // Probe UBO slots, -1 = unused
+    glm::vec2  weights = glm::vec2(0.0f);     // Sum <= 1, the rest comes from the skybox
+};
 
 struct RefProbe {
     Transform transform;
-    Cubemap localEnvMap;
+    int  atlasLayer = -1;       // ProbeAtlas layer holding the prefiltered chain, assigned by the scene
+    bool isBaked    = false;    // The layer holds garbage until the first bake completes
 
     glm::vec3 proxyDims = glm::vec3(30.0f);   // probe position is inside a 30x30x30 square
     float farPlane = 200.0f;
     bool toBeBaked = false;
     bool isVisible = true;
-
-    RefProbe(
-        const Shader& i_convolutionShader,
-        const Shader& i_conversionShader,
-        const Shader& i_prefilterShader)
-        : localEnvMap(i_convolutionShader, i_conversionShader, i_prefilterShader)
-    {
-    }
-};
\ No newline at end of file
+    uint32_t version = 1;   // Bump after editing the transform or proxy volume
+};
@@ -7,6 +7,10 @@
 #include "sceneNode.h"
 #include "cubemap.h"
 #include "refProbe.h"
+#include "frustum.h"
+#include "irradianceVolume.h"
+
+#include <memory>
 
 enum class Render_Mode {
     PBR,
@@ -148,6 +152,35 @@ struct PickingFBO {
     }
 };
 
+// Offscreen target for reflection probe captures, allocated once and reused by every bake
+struct CaptureTarget {
+    unsigned int fbo = 0;
+    unsigned int depthRbo = 0;
+    int size = 0;
+
+    ~CaptureTarget() {
+        if (fbo)      glDeleteFramebuffers(1, &fbo);
+        if (depthRbo) glDeleteRenderbuffers(1, &depthRbo);
+        fbo = depthRbo = 0;
+    }
+
+    void setup(int s) {
+        if (fbo && s == size) return;
+        if (!fbo) {
+            glGenFramebuffers(1, &fbo);
+            glGenRenderbuffers(1, &depthRbo);
+        }
+        size = s;
+
+        glBindRenderbuffer(GL_RENDERBUFFER, depthRbo);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size, size);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+};
+
 
 class Renderer {
 public:
@@ -167,6 +200,14 @@ public:
     void setBgCol(const glm::vec4& bgCol) { m_winBgCol = bgCol; }
     void setEV100(float i_EV100) { m_EV100 = i_EV100; }
 
+    int getProbeCaptureSize() const { return m_probeCaptureSize; }
+    void setProbeCaptureSize(int size) { m_probeCaptureSize = size; }     // Applies from the next bake
+
+    float getLodPixelError() const { return m_lodPixelError; }
+    void setLodPixelError(float pixels) { m_lodPixelError = pixels; }
+    int getShadowLodBias() const { return m_shadowLodBias; }
+    void setShadowLodBias(int levels) { m_shadowLodBias = levels; }
+
     uint32_t renderPickingPass(const Scene& scene, const Camera& cam, int mouseX, int mouseY, int vWidth, int vHeight);
 
 private:
@@ -198,15 +239,67 @@ private:
     VBO m_cubeVBO;
 
     float m_EV100 = 0.0f;
+
+    // LOD selection: the coarsest level whose error projects to at most m_lodPixelError pixels.
+    // A node only steps coarser once that level is under LOD_HYSTERESIS of the threshold, so one
+    // sitting on the boundary doesn't flip every frame. Shadow maps go m_shadowLodBias levels coarser
+    static constexpr float LOD_HYSTERESIS = 0.75f;
+
+    float m_lodPixelError = 1.0f;
+    int   m_shadowLodBias = 1;
+
+    // Reflection probe baking, one probe at a time and a few steps per frame.
+    // Faces are captured into one shared cubemap and filtered into the atlas' staging layer,
+    // the probe keeps its old layer until the whole chain is done and the two are swapped
+    struct ProbeBake {
+        enum class Stage { CAPTURING, MIPMAPPING, PREFILTERING };
+
+        RefProbe* probe   = nullptr;
+        uint32_t  version = 0;      // Probe version the capture started from
+        Stage     stage   = Stage::CAPTURING;
+        int       face    = 0;
+        int       mip     = 0;
+        int       row     = 0;
+        int       envSize = 0;
+        std::unique_ptr<Texture> envMap;    // Allocated on the first bake, kept for the next ones
+    };
+    static constexpr double PROBE_BAKE_BUDGET_MS = 2.0;
+    static constexpr int    PROBE_PREFILTER_ROWS = 64;     // Rows of an atlas mip filtered per step
+
+    int                   m_probeCaptureSize = Cubemap::ENV_SIZE;
+    mutable ProbeBake     m_probeBake;
+    mutable CaptureTarget m_probeCaptureTarget;
+
+    // Irradiance volume baking, whole probes per step: 6 small faces, a readback and the SH projection
+    struct VolumeBake {
+        bool     isActive = false;
+        uint32_t version  = 0;      // Volume version the bake started from
+        int      probe    = 0;
+        std::unique_ptr<Texture> envMap;
+        std::vector<float>       texels;
+    };
+    static constexpr int    VOLUME_CAPTURE_SIZE   = 32;
+    static constexpr double VOLUME_BAKE_BUDGET_MS = 2.0;
+
+    mutable VolumeBake    m_volumeBake;
+    mutable CaptureTarget m_volumeCaptureTarget;
     
     void renderPostProcess(const Scene& scene, int vWidth, int vHeight) const;
 
     void renderShadowPass(const Scene& scene, const Camera& cam) const;
     void renderLightPass(const Scene& scene, const Camera& cam, int vWidth, int vHeight) const;
     void bakeRefProbePass(const Scene& scene) const;
+    void runProbeBakeStep(const Scene& scene) const;
+    void bakeIrradianceVolumePass(const Scene& scene) const;
+    void bakeVolumeProbe(const Scene& scene, IrradianceVolume& volume, int probe) const;
+    void captureCubeFace(const Scene& scene, const glm::vec3& position, float farPlane, const Texture& target,
+                         const CaptureTarget& captureTarget, int size, int face) const;
     
-    void renderObjectsFC(const Scene& scene, const SceneNode* node, const Camera& cam) const;
+    void selectLods(SceneNode* node, const glm::vec3& camPos, float projScale) const;
+
+    void renderObjectsFC(const Scene& scene, const SceneNode* node, const Frustum& frustum, const glm::vec3& viewPos) const;
     void renderObjects(const Scene& scene, const SceneNode* node) const;
+    void setRefProbeUniforms(const Scene& scene, const SceneNode* node) const;
     void renderShadowMap(const SceneNode* node, const Shader& depthShader) const;
     void renderSkybox(const Scene& scena) const;
 
@@ -217,6 +310,8 @@ private:
     // DEBUG
     void renderLightAreas(const Scene& scene, const Camera& cam, int vWidth, int vHeight) const;
     void renderRefProbeProxy(const Scene& scene, const Camera& cam, int vWidth, int vHeight) const;
+    void renderLoadingPlaceholders(const Scene& scene, const Camera& cam, int vWidth, int vHeight) const;
+    void renderPlaceholderNode(const SceneNode* node, const Shader& primitiveShader) const;
 
     // TODO: inside a rendering utils class? (the renderer class just keeps track of the vao)
     void setupUnitLine();
@@ -9,12 +9,18 @@
 #include "cubemap.h"
 #include "camera.h"
 #include "refPRobe.h"
+#include "uniformRingBuffer.h"
+#include "iblBaker.h"
+#include "skyboxLoader.h"
+#include "probeAtlas.h"
+#include "irradianceVolume.h"
 
 //#include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <array>
 #include <memory>
 #include <vector>
 #include <filesystem>
@@ -22,11 +28,13 @@
 
 
 const unsigned int MAX_LIGHTS = 8;
+const unsigned int MAX_REF_PROBES = ProbeAtlas::MAX_PROBES;
 
 class Scene {
 public:
     Scene(AssetManager* i_assetManager);
     Scene(const Scene&) = delete;
+    ~Scene();
     //Scene& operator = (const Scene&);
 
 
@@ -34,10 +42,12 @@ public:
     const SceneNode* getWorldNode() const { return m_worldNode.get(); }
     SceneNode* getWorldNode() { return m_worldNode.get(); }
     const Cubemap* getSkybox() const { return m_skybox.get(); }
+    const SkyboxLoader* getSkyboxLoader() const { return m_skyboxLoader.get(); }
+    int getSkyboxEnvSize() const { return m_skyboxEnvSize; }
     const Shader& getSkyboxShader() const { return *m_skyboxShader; }
-    const Shader& getConvolutionShader() const { return *m_convolutionShader; }
     const Shader& getConversionShader() const { return *m_conversionShader; }
     const Shader& getPrefilterShader() const { return *m_prefilterShader; }
+    const Shader& getProbePrefilterShader() const { return *m_probePrefilterShader; }
     const Shader& getModelShader() const { return *m_modelShader; }
     const Shader& getDirDepthShader() const { return *m_dirDepthShader; }
     const Shader& getOmniDepthShader() const { return *m_omniDepthShader; }
@@ -51,6 +61,8 @@ public:
     const std::vector<std::unique_ptr<SpotLight>>& getSpotLights() const { return m_spotLights; }
     
     const std::vector<std::unique_ptr<RefProbe>>& getRefProbes() const { return m_refProbes; }
+    ProbeAtlas& getProbeAtlas() const { return m_probeAtlas; }     // The renderer bakes into it
+    IrradianceVolume& getIrradianceVolume() const { return m_irradianceVolume; }
 
     const std::vector<SceneNode*>& getSelectedEnts() const { return m_selectedEntities; }
 
@@ -65,7 +77,10 @@ public:
 
     /* ===== OBJECT LOADING QUEUE ================================================================= */
     void queueModelLoad(const std::filesystem::path& path);
-    void processLoadQueue();
+    void processLoadQueue();                        // Starts queued imports, runs upload jobs and texture streaming, uploads finished imports within the frame budget
+
+    // Steps a pending skybox load within the frame budget, the current skybox stays until it completes
+    void processSkyboxLoad();
 
 
     /* ===== ADDING ENTITIES ================================================================= */
@@ -75,6 +90,7 @@ public:
     void createAndAddSpotLight(std::unique_ptr<SpotLight> light);
     void createAndAddReflectionProbe(std::unique_ptr<RefProbe> probe);
     void createAndAddSkyboxHDR(const std::filesystem::path& path);
+    void setSkyboxEnvSize(int size) { m_skyboxEnvSize = size; }    // Applies to the next skybox load
 
 
     /* ===== DELETING ENTITIES ================================================================= */
@@ -85,15 +101,29 @@ public:
     void deleteSkybox();
 
 
+    /* ===== IBL ============================================================================= */
+    // Re-bakes the current skybox and the BRDF LUT on the CPU and logs the error against the GPU maps.
+    // True if every map is within IBLBaker::verify()'s tolerances
+    bool verifyCPUBake() const;
+
+
     /* ===== UBOs ============================================================================*/
     void setupUBOBindings();                        // Binding point allocation
     void bindToUBOs(const Shader& shader) const;    // Binding shaders to binding points
+
+    void beginUBOFrame() const;                     // Advances the UBO ring to the next frame region
+    void endUBOFrame() const;                       // Fences the current frame region
     
     void updateCameraUBO(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& cameraPos) const;
     void updateLightingUBO() const;
     void updateRefProbeUBO() const;
     void updateShadowUBO() const;
-    void updateShadowMapLSMats() const;
+    void updateShadowMapLSMats() const;             // Only recomputes lights whose version changed
+    void updateEnvironmentUBO() const;              // Skybox SH and the irradiance volume layout, uploaded when either changes
+
+    // Ranks the baked probes by how deep the bounding sphere sits in their proxy volumes.
+    // Reads the matrices packed by updateRefProbeUBO(), so call it after that
+    RefProbeSelection selectRefProbes(const glm::vec3& center, float radius) const;
 
     // Bind texture
     void bindDepthMaps() const;
@@ -112,17 +142,18 @@ private:
         DIR_SHADOW_MAP_SLOT   = 20,
         POINT_SHADOW_MAP_SLOT = 30,
         SPOT_SHADOW_MAP_SLOT  = 40,
-        REF_ENV_MAP_SLOT      = 50,
-        IRRADIANCE_MAP_SLOT   = 60,
+        REF_PROBE_ATLAS_SLOT  = 50,
         PREFILTER_MAP_SLOT    = 61,
-        BRDF_LUT_SLOT         = 62
+        BRDF_LUT_SLOT         = 62,
+        IRRADIANCE_VOLUME_SLOT = 63     // 63-65, one per colour channel
     };
 
     enum Binding_Point {
         CAMERA_BINDING_POINT    = 0,
         LIGHTS_BINDING_POINT    = 1,
         REF_PROBE_BINDING_POINT = 2,
-        SHADOW_BINDING_POINT    = 3
+        SHADOW_BINDING_POINT    = 3,
+        ENVIRONMENT_BINDING_POINT = 4
     };
 
     struct alignas(16) DirectionalLightStruct {
@@ -168,11 +199,11 @@ private:
         int padding;											// 4
     };
 
-    struct alignas(16) ReflectionProbeUBOData {     // 1296 Bytes
-        glm::vec4 position[MAX_LIGHTS];             // 16 * 8 = 128
-        glm::mat4 worldMats[MAX_LIGHTS];            // 64 * 8 = 512
-        glm::mat4 invWorldMats[MAX_LIGHTS];         // 64 * 8 = 512
-        glm::vec4 proxyDims[MAX_LIGHTS];            // 16 * 8 = 128
+    struct alignas(16) ReflectionProbeUBOData {     // 5136 Bytes
+        glm::vec4 position[MAX_REF_PROBES];         // 16 * 32 = 512, w = atlas layer or -1 if unbaked
+        glm::mat4 worldMats[MAX_REF_PROBES];        // 64 * 32 = 2048
+        glm::mat4 invWorldMats[MAX_REF_PROBES];     // 64 * 32 = 2048
+        glm::vec4 proxyDims[MAX_REF_PROBES];        // 16 * 32 = 512
         int numRefProbes;                           // 4
         int padding0;
         int padding1;
@@ -184,17 +215,58 @@ private:
         glm::mat4 spotLightSpaceMatrices[MAX_LIGHTS];			// 64 * 8  = 512
     };
 
+    struct alignas(16) EnvironmentUBOData {     // 192 Bytes
+        glm::vec4 irradianceSH[9];              // 16 * 9 = 144, rgb = pre-convolved L2 coefficient
+        glm::vec4 volumeMin;                    // 16, w = 1 when the irradiance volume is baked and enabled
+        glm::vec4 volumeMax;                    // 16
+        glm::vec4 volumeResolution;             // 16
+    };
+
     struct alignas(16) CameraMatricesUBOData {	// 144 Bytes
         glm::mat4 projection;		            // 64
         glm::mat4 view;				            // 64
         glm::vec4 cameraPos;		            // 16
     };
 
+    // Byte span of a UBO image that has to be re-uploaded
+    struct DirtyRange {
+        GLintptr begin = 0;
+        GLintptr end   = 0;
+
+        template <typename Block, typename Field>
+        void add(const Block& block, const Field& field) {
+            GLintptr offset = reinterpret_cast<const unsigned char*>(&field) - reinterpret_cast<const unsigned char*>(&block);
+            if (empty()) {
+                begin = offset;
+                end   = offset + static_cast<GLintptr>(sizeof(Field));
+            }
+            else {
+                begin = std::min(begin, offset);
+                end   = std::max(end, offset + static_cast<GLintptr>(sizeof(Field)));
+            }
+        }
+        bool empty() const { return end <= begin; }
+        void clear() { begin = end = 0; }
+    };
+
+    // Last packed version of every slot, 0 means the slot has to be re-packed
+    using SlotVersions      = std::array<uint32_t, MAX_LIGHTS>;
+    using ProbeSlotVersions = std::array<uint32_t, MAX_REF_PROBES>;
+
 
     AssetManager* m_assetManager;
 
     std::unique_ptr<SceneNode> m_worldNode;	// Scene graph parent
     std::unique_ptr<Cubemap>    m_skybox;
+    std::filesystem::path       m_skyboxPath;
+    std::unique_ptr<SkyboxLoader> m_skyboxLoader;
+    int                         m_skyboxEnvSize = Cubemap::ENV_SIZE;
+
+    static constexpr double SKYBOX_LOAD_BUDGET_MS = 4.0;
+    static constexpr double MODEL_UPLOAD_BUDGET_MS = 4.0;
+
+    // Outer fraction of a proxy volume where a probe fades out
+    static constexpr float REF_PROBE_BLEND_FRACTION = 0.2f;
 
     std::vector<std::unique_ptr<DirectionalLight>> m_directionalLights;
     std::vector<std::unique_ptr<PointLight>>	   m_pointLights;
@@ -209,10 +281,34 @@ private:
 
     std::vector<std::filesystem::path> loadQueue;
 
-    GLuint m_cameraMatricesUBO = 0;
-    GLuint m_lightingUBO       = 0;
-    GLuint m_refProbeUBO       = 0;
-    GLuint m_shadowUBO         = 0;
+    // All per-frame uniform blocks are streamed through this ring and bound by range
+    static constexpr GLsizeiptr UBO_RING_FRAME_SIZE = 64 * 1024;
+    mutable UniformRingBuffer m_uboRing;
+
+    // Lighting, probe and shadow blocks live in static buffers bound once. Their CPU images are
+    // patched per element and only the dirty span is staged through the ring and copied over
+    GLuint m_lightingUBO = 0;
+    GLuint m_refProbeUBO = 0;
+    GLuint m_shadowUBO   = 0;
+    GLuint m_environmentUBO = 0;
+
+    mutable LightingUBOData        m_lightingData = {};
+    mutable ReflectionProbeUBOData m_refProbeData = {};
+    mutable ShadowMatricesUBOData  m_shadowData   = {};
+    mutable EnvironmentUBOData     m_environmentData = {};
+
+    mutable DirtyRange m_lightingDirty;
+    mutable DirtyRange m_refProbeDirty;
+    mutable DirtyRange m_shadowDirty;
+    mutable DirtyRange m_environmentDirty;
+
+    mutable SlotVersions m_dirLightVersions   = {};
+    mutable SlotVersions m_pointLightVersions = {};
+    mutable SlotVersions m_spotLightVersions  = {};
+    mutable ProbeSlotVersions m_refProbeVersions = {};
+    mutable SlotVersions m_dirShadowVersions   = {};
+    mutable SlotVersions m_pointShadowVersions = {};
+    mutable SlotVersions m_spotShadowVersions  = {};
 
     std::shared_ptr<Shader> m_modelShader;
     std::shared_ptr<Shader> m_dirDepthShader;
@@ -224,13 +320,28 @@ private:
 
     std::shared_ptr<Shader> m_skyboxShader;
     std::shared_ptr<Shader> m_conversionShader;
-    std::shared_ptr<Shader> m_convolutionShader;
 
     std::shared_ptr<Shader> m_prefilterShader;
+    std::shared_ptr<Shader> m_probePrefilterShader;
     std::shared_ptr<Shader> m_brdfShader;
 
-    Texture m_brdfLUT = Texture(512, 512, GL_RG16F);
+    static constexpr int BRDF_LUT_SIZE = IBLSettings::BRDF_LUT_SIZE;
+    Texture m_brdfLUT = Texture(BRDF_LUT_SIZE, BRDF_LUT_SIZE, GL_RG16F);
+
+    // Prefiltered chains of every reflection probe
+    mutable ProbeAtlas m_probeAtlas;
+
+    // Local diffuse light, sampled instead of the skybox SH inside its bounds
+    mutable IrradianceVolume m_irradianceVolume;
+    mutable uint32_t         m_volumeBakeCount = 0;   // Last bake packed into the environment UBO
+    mutable bool             m_volumeEnabled   = false;
+
+    // Precomputed skybox maps and the BRDF LUT persist here between runs
+    IBLCache m_iblCache = IBLCache(std::filesystem::path("cache") / "ibl");
 
     /* ===== UTILITIIES ================================================================= */
     void generateBRDFLUT();
+    void flushUBOData(GLuint buffer, const void* data, DirtyRange& range) const;
+    void setEnvironmentSH(const SH9& irradiance);
+    void refreshModelBounds(SceneNode* node, const std::vector<Model*>& readyModels);
 };
\ No newline at end of file
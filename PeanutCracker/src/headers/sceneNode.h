@@ -28,6 +28,8 @@ public:
 
 	std::unique_ptr<SphereColliderComponent> sphereColliderComponent;
 
+	int lodLevel = 0;	// Picked by the renderer each frame from the projected bounding sphere
+
 	SceneNode(std::string i_name);
 
 	glm::vec3 getPosition() const;
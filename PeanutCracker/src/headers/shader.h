@@ -30,6 +30,8 @@ public:
 	void setUint(const std::string& name, unsigned int value) const;
 	void setFloat(const std::string& name, float value) const;
 	void setMat4(const std::string& name, const glm::mat4& transformation) const;
+	void setIVec2(const std::string& name, const glm::ivec2& vector) const;
+	void setVec2(const std::string& name, const glm::vec2& vector) const;
 	void setVec3(const std::string& name, const glm::vec3& vector) const;
 	void setVec3(const std::string& name, float a, float b, float c) const;
 	void setVec4(const std::string& name, const glm::vec4& vector) const;
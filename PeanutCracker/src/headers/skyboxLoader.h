@@ -0,0 +1,96 @@
+#pragma once
+
+#include "cubemap.h"
+#include "iblCache.h"
+#include "shader.h"
+#include "texture.h"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <vector>
+
+
+// Loads an HDR skybox without stalling the editor.
+// Hashing, the cache lookup, decoding and the SH projection run on the thread pool. The GPU half of
+// the bake is cut into small steps (HDR row bands, cube faces, prefilter mip faces) and update()
+// only records as many as fit in the frame budget. GPU cost is estimated per texel sample and
+// corrected with GL_TIME_ELAPSED queries, since the CPU side of a draw says nothing about its cost.
+class SkyboxLoader {
+public:
+    enum class State {
+        DECODING,
+        UPLOADING_CACHE,
+        UPLOADING_HDR,
+        CONVERTING,
+        MIPMAPPING,
+        PREFILTERING,
+        STORING,
+        DONE,
+        FAILED
+    };
+
+    SkyboxLoader(const std::filesystem::path& i_path, const IBLCache& i_cache, int i_envSize = Cubemap::ENV_SIZE);
+    ~SkyboxLoader();
+
+    SkyboxLoader(const SkyboxLoader&) = delete;
+    SkyboxLoader& operator=(const SkyboxLoader&) = delete;
+
+    // Returns true once the load has finished, successfully or not
+    bool update(const Shader& conversionShader, const Shader& prefilterShader, double budgetMs);
+
+    State getState() const { return m_state; }
+    bool hasFailed() const { return m_state == State::FAILED; }
+    float getProgress() const;
+    const std::filesystem::path& getPath() const { return m_path; }
+
+    std::unique_ptr<Cubemap> takeCubemap() { return std::move(m_cubemap); }
+
+private:
+    // Everything the worker produces, either a cache hit or a decoded image
+    struct DecodedSkybox {
+        bool     isValid  = false;
+        uint64_t cacheKey = 0;
+        std::vector<IBLImage> cachedImages;   // Non-empty on a cache hit
+
+        int width  = 0;
+        int height = 0;
+        std::vector<uint16_t> halfPixels;     // RGB16F, rows bottom to top
+        SH9 irradianceSH;
+    };
+
+    std::filesystem::path m_path;
+    IBLCache              m_cache;
+    int                   m_envSize;
+    State                 m_state = State::DECODING;
+
+    std::future<DecodedSkybox> m_pending;
+    DecodedSkybox              m_decoded;
+
+    std::unique_ptr<Cubemap> m_cubemap;
+    std::unique_ptr<Texture> m_hdrTexture;
+
+    // Step cursors
+    int      m_nextRow   = 0;
+    int      m_face      = 0;
+    int      m_mip       = 0;
+    size_t   m_image     = 0;
+    uint32_t m_level     = 0;
+    int      m_stepsDone = 0;
+
+    // GPU timing
+    GLuint m_timerQuery     = 0;
+    bool   m_isQueryPending = false;
+    double m_queryUnits     = 0.0;
+    double m_gpuMsPerUnit   = 1e-7;     // Conservative until the first query comes back
+
+    static DecodedSkybox decode(const std::filesystem::path& path, const IBLCache& cache, int envSize);
+
+    void   runStep(const Shader& conversionShader, const Shader& prefilterShader);
+    double getStepCost() const;         // Texel samples the next step will run on the GPU
+    int    getTotalSteps() const;
+    void   readTimerQuery();
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "hdrImage.h"
+
+#include <glm/glm.hpp>
+
+#include <array>
+
+
+// Order 2 (L2) real spherical harmonics, 9 RGB coefficients.
+// Index order: (0,0) (1,-1) (1,0) (1,1) (2,-2) (2,-1) (2,0) (2,1) (2,2)
+struct SH9 {
+    std::array<glm::vec3, 9> coeffs = {};
+};
+
+
+namespace SphericalHarmonics {
+    // Projects the radiance of a lat-long image (same mapping as equirectToUnitCube.frag).
+    // Rows are split across the global thread pool, each row is accumulated with SSE when available.
+    SH9 projectEquirect(const HDRImage& image);
+
+    // Projects the radiance of 6 RGB float cube faces (GL face order, rows as glGetTexImage returns them).
+    // Meant for small captures like irradiance volume probes, runs on the calling thread
+    SH9 projectCubemap(const float* faces, int size);
+
+    // Folds the clamped cosine lobe, 1/PI and the basis constants into the coefficients.
+    // The result is diffuse irradiance / PI as a plain polynomial of the normal, see evalIrradiance()
+    SH9 toIrradiance(const SH9& radiance);
+
+    // CPU mirror of evalIrradianceSH() in model.frag
+    glm::vec3 evalIrradiance(const SH9& irradiance, const glm::vec3& n);
+}
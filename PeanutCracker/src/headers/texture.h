@@ -3,6 +3,9 @@
 #include "glad/glad.h"
 #include "glm/glm.hpp"
 
+#include "hdrImage.h"
+#include "ldrImage.h"
+
 #include <filesystem>
 
 
@@ -35,9 +38,18 @@ class Texture {
 public:
     Texture();
 
+    // Name only, the storage is defined later, e.g. by a job on the upload context
+    explicit Texture(TexType type);
+
     // Load 2D texture
     Texture(const std::filesystem::path& i_path, bool sRGB = false, bool hdr = false);
     
+    // Upload a decoded HDR image
+    explicit Texture(const HDRImage& image);
+
+    // Upload a decoded 8-bit image
+    Texture(const LDRImage& image, bool sRGB);
+
     // Make 1x1 colored texture
     Texture(const glm::vec4& color, bool sRGB);
 
@@ -78,6 +90,16 @@ public:
 
     void generateMipmaps() const;
 
+    // Raw level access, face is ignored for 2D textures
+    void uploadLevel(int level, int face, int w, int h, GLenum internalFormat, const void* data) const;
+    void uploadRegion(int level, int face, int x, int y, int w, int h, GLenum internalFormat, const void* data) const;
+    void readLevel(int level, int face, GLenum internalFormat, void* data) const;
+    void setMaxLevel(int level) const;
+    void setBaseLevel(int level) const;
+
+    // Sized internal format for an 8-bit image with this many channels
+    static GLenum getLDRFormat(int channels, bool sRGB);
+
     void bind(unsigned int slot) const;
     void unbind() const;
 
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "ldrImage.h"
+#include "texture.h"
+#include "uploadContext.h"
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+
+// Streams decoded mip chains into textures, smallest level first.
+// add() queues one upload job that allocates every level and fills the tail (levels up to TAIL_SIZE),
+// with GL_TEXTURE_BASE_LEVEL pointing at the tail so the texture samples as soon as that job's ticket
+// signals. update() then queues the bigger levels under a per frame byte budget, always the smallest
+// one still missing across all textures, and lowers the base level once a level's ticket has signalled.
+// Every level goes through one orphaned pixel unpack buffer, the driver copies out of it asynchronously
+class TextureStreamer {
+public:
+    static constexpr int TAIL_SIZE = 128;
+
+    explicit TextureStreamer(UploadContext& i_uploadContext);
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // The image needs its mips (LDRImage::generateMips()). Returns the texture, which must not be
+    // sampled before ticket completes
+    std::shared_ptr<Texture> add(std::shared_ptr<const LDRImage> image, bool sRGB, std::shared_ptr<UploadTicket>& ticket);
+
+    // Main thread, once per frame
+    void update();
+
+    void setByteBudget(size_t bytes) { m_byteBudget = bytes; }
+    size_t getByteBudget() const { return m_byteBudget; }
+
+    size_t getPendingBytes() const;
+    size_t getStreamingCount() const { return m_entries.size(); }
+
+private:
+    struct UnpackBuffer {
+        GLuint id = 0;
+        ~UnpackBuffer();
+    };
+
+    struct Entry {
+        std::shared_ptr<Texture>        texture;
+        std::shared_ptr<const LDRImage> image;
+        GLenum                          internalFormat = GL_RGBA8;
+        int                             residentLevel  = 0;     // GL_TEXTURE_BASE_LEVEL
+        int                             uploadingLevel = -1;    // In flight, -1 if none
+        std::shared_ptr<UploadTicket>   ticket;                 // Of the tail or of uploadingLevel
+    };
+
+    UploadContext&                m_uploadContext;
+    std::shared_ptr<UnpackBuffer> m_unpackBuffer;       // Used by the upload jobs only, shared so it outlives them
+    std::vector<Entry>            m_entries;
+    size_t                        m_byteBudget = 16u << 20;
+
+    static int getTailLevel(const LDRImage& image);
+    static void uploadLevel(UnpackBuffer& buffer, const Texture& texture, const LDRImage& image, int level, GLenum internalFormat);
+};
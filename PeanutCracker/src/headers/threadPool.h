@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+// Fixed size worker pool for CPU side jobs (asset decoding, IBL projection, mesh processing).
+// parallelFor() lets the calling thread work on chunks too, so it never waits on work that
+// hasn't started and is safe to call from inside another job.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned int threadCount = 0);   // 0 = one less than the hardware threads
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator = (const ThreadPool&) = delete;
+
+    // Shared pool used by the engine
+    static ThreadPool& getGlobal();
+
+    unsigned int getThreadCount() const { return static_cast<unsigned int>(m_workers.size()); }
+
+    template <typename F>
+    auto submit(F&& func) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        using Result = std::invoke_result_t<std::decay_t<F>>;
+
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(func));
+        std::future<Result> future = task->get_future();
+        enqueue([task]() { (*task)(); });
+        return future;
+    }
+
+    // Calls func(begin, end) over [0, count) split into chunks of at least grainSize
+    void parallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& func);
+
+private:
+    std::vector<std::thread>          m_workers;
+    std::queue<std::function<void()>> m_jobs;
+    std::mutex                        m_mutex;
+    std::condition_variable           m_condition;
+    bool                              m_isStopping = false;
+
+    void enqueue(std::function<void()> job);
+    void workerLoop();
+};
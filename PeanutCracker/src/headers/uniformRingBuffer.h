@@ -0,0 +1,70 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <array>
+#include <vector>
+
+
+// Streaming allocator for per-frame uniform data.
+// The buffer is split into FRAME_COUNT regions, each frame writes into its own region and
+// binds slices with glBindBufferRange. A fence is placed at the end of every frame so a
+// region is only reused once the GPU is done reading it.
+//  - GL 4.4+: glBufferStorage, persistently + coherently mapped, writes are a plain memcpy
+//  - GL 3.3 : the whole ring is orphaned every time it wraps and slices are written with
+//             unsynchronized glMapBufferRange
+class UniformRingBuffer {
+public:
+    struct Allocation {
+        GLuint     buffer = 0;
+        GLintptr   offset = 0;
+        GLsizeiptr size   = 0;
+    };
+
+    UniformRingBuffer() = default;
+    ~UniformRingBuffer();
+
+    UniformRingBuffer(const UniformRingBuffer&) = delete;
+    UniformRingBuffer& operator = (const UniformRingBuffer&) = delete;
+
+    void init(GLsizeiptr bytesPerFrame);
+
+    // Frame pacing
+    void beginFrame();
+    void endFrame();
+
+    // Copies data into the current frame region
+    Allocation upload(const void* data, GLsizeiptr size);
+
+    // Copies data into the current frame region and binds it to the binding point
+    Allocation uploadAndBind(GLuint bindingPoint, const void* data, GLsizeiptr size);
+
+    GLuint getID() const { return m_ID; }
+    bool isPersistent() const { return m_isPersistent; }
+
+private:
+    static constexpr unsigned int FRAME_COUNT = 3;
+
+    struct RetiredBuffer {
+        GLuint ID    = 0;
+        GLsync fence = nullptr;
+    };
+
+    GLuint         m_ID           = 0;
+    bool           m_isPersistent = false;
+    unsigned char* m_mappedPtr    = nullptr;
+
+    GLsizeiptr m_frameSize = 0;
+    GLint      m_alignment = 256;
+
+    unsigned int m_frameIndex = 0;
+    GLsizeiptr   m_head       = 0;   // Write offset inside the current frame region
+
+    std::array<GLsync, FRAME_COUNT> m_fences = {};
+    std::vector<RetiredBuffer>      m_retired;
+
+    void allocateStorage(GLsizeiptr frameSize);
+    void grow(GLsizeiptr minFrameSize);
+    void waitFence(GLsync& fence) const;
+    void collectRetired();
+};
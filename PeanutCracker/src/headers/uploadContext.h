@@ -0,0 +1,72 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+
+// Completion handle for one upload job. The fence is created right after the job on the context
+// that ran it; the main thread only polls it, so adopting a resource never waits on the driver
+class UploadTicket {
+public:
+    UploadTicket() = default;
+    ~UploadTicket();
+
+    UploadTicket(const UploadTicket&) = delete;
+    UploadTicket& operator=(const UploadTicket&) = delete;
+
+    bool isComplete();          // Main thread, never blocks
+
+private:
+    friend class UploadContext;
+
+    std::atomic<GLsync> m_sync{ nullptr };
+    bool                m_isSignaled = false;
+};
+
+// Second GL context sharing objects with the main window, driven by its own thread.
+// Buffers and textures created there are visible to the main context once the job's
+// ticket completes. VAOs and FBOs are not shared between contexts, so those stay on the main thread.
+// If the shared context can't be created the jobs run on the main thread inside update()'s budget instead.
+class UploadContext {
+public:
+    explicit UploadContext(GLFWwindow* mainWindow);
+    ~UploadContext();
+
+    UploadContext(const UploadContext&) = delete;
+    UploadContext& operator=(const UploadContext&) = delete;
+
+    // Jobs run in submission order, so the last ticket of a batch covers the whole batch
+    std::shared_ptr<UploadTicket> submit(std::function<void()> job);
+
+    // Runs queued jobs within the budget when there's no upload thread
+    void update(double budgetMs);
+
+    // Joins the thread and destroys the shared context, call before the main window goes away
+    void shutdown();
+
+    bool isThreaded() const { return m_window != nullptr; }
+
+private:
+    struct Job {
+        std::function<void()>         func;
+        std::shared_ptr<UploadTicket> ticket;
+    };
+
+    GLFWwindow*             m_window = nullptr;     // Hidden, only owns the shared context
+    std::thread             m_thread;
+    std::queue<Job>         m_jobs;
+    std::mutex              m_mutex;
+    std::condition_variable m_condition;
+    bool                    m_isStopping = false;
+
+    void threadLoop();
+    static void runJob(Job& job);
+};
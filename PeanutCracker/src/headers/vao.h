@@ -7,9 +7,11 @@
 
 namespace VertLayout {
     struct AttribData {
-        GLuint layout;
-        GLuint components;
-        GLenum type;
+        GLuint    layout;
+        GLuint    components;
+        GLenum    type;
+        GLboolean normalized = GL_FALSE;    // Integer types are read as [-1, 1] / [0, 1] floats instead of ints
+        GLuint    divisor    = 0;           // 1 steps once per instance instead of per vertex
     };
 
     constexpr AttribData POS     = { 0, 3, GL_FLOAT };  // Position
@@ -17,8 +19,19 @@ namespace VertLayout {
     constexpr AttribData UV      = { 2, 2, GL_FLOAT };  // UV
     constexpr AttribData TAN     = { 3, 3, GL_FLOAT };  // Tangent
     constexpr AttribData BITAN   = { 4, 3, GL_FLOAT };  // Bitangent
-    constexpr AttribData BONE_ID = { 5, 4, GL_INT };    // Bone indices
-    constexpr AttribData BONE_W  = { 6, 4, GL_FLOAT };  // Bone weights
+
+    // Packed mesh vertex, see Vertex in mesh.h
+    constexpr AttribData NORM_OCT = { 1, 2, GL_SHORT, GL_TRUE };            // Octahedral normal
+    constexpr AttribData UV_HALF  = { 2, 2, GL_HALF_FLOAT };                // UV
+    constexpr AttribData TAN_OCT  = { 3, 3, GL_SHORT, GL_TRUE };            // Octahedral tangent, z = bitangent sign
+
+    // Skinned meshes only, a separate stream
+    constexpr AttribData BONE_ID = { 5, 4, GL_UNSIGNED_BYTE };              // Bone indices
+    constexpr AttribData BONE_W  = { 6, 4, GL_UNSIGNED_BYTE, GL_TRUE };     // Bone weights
+
+    // Per instance stream of a Mesh, a mat4 (7 - 10) and the matching normal mat3 (11 - 13)
+    constexpr AttribData INSTANCE_MODEL  = { 7,  4, GL_FLOAT, GL_FALSE, 1 };   // First column, 3 more follow
+    constexpr AttribData INSTANCE_NORMAL = { 11, 3, GL_FLOAT, GL_FALSE, 1 };   // First column, 2 more follow
 }
 
 class VAO {
@@ -49,15 +62,19 @@ public:
         VBO.bind();
         glEnableVertexAttribArray(attribData.layout);
         
-        if (attribData.type == GL_INT   || attribData.type == GL_UNSIGNED_INT ||
-            attribData.type == GL_SHORT || attribData.type == GL_UNSIGNED_SHORT ||
-            attribData.type == GL_BYTE  || attribData.type == GL_UNSIGNED_BYTE)
-        {
+        const bool isInteger = attribData.type == GL_INT   || attribData.type == GL_UNSIGNED_INT ||
+                               attribData.type == GL_SHORT || attribData.type == GL_UNSIGNED_SHORT ||
+                               attribData.type == GL_BYTE  || attribData.type == GL_UNSIGNED_BYTE;
+
+        if (isInteger && !attribData.normalized) {
             glVertexAttribIPointer(attribData.layout, attribData.components, attribData.type, stride, offset);
         }
         else {
-            glVertexAttribPointer(attribData.layout, attribData.components, attribData.type, GL_FALSE, stride, offset);
-        
+            // Floats, half floats, normalized and packed (GL_INT_2_10_10_10_REV) formats
+            glVertexAttribPointer(attribData.layout, attribData.components, attribData.type, attribData.normalized, stride, offset);
+        }
+        if (attribData.divisor != 0) {
+            glVertexAttribDivisor(attribData.layout, attribData.divisor);
         }
         VBO.unbind();
     }
@@ -0,0 +1,584 @@
+#include "headers/iblBaker.h"
+#include "headers/threadPool.h"
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PC_IBL_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+
+/* ===== SETTINGS ============================================================ */
+namespace IBLSettings {
+
+int getMipCount(int size) {
+    return static_cast<int>(std::floor(std::log2(size))) + 1;
+}
+
+uint64_t getEnvironmentKey(const std::filesystem::path& hdrPath, int envSize, int prefilterSize) {
+    uint64_t key = IBLCache::hashFile(hdrPath);
+    if (key == 0) return 0;
+
+    key = IBLCache::hashCombine(key, BAKE_VERSION);
+    key = IBLCache::hashCombine(key, static_cast<uint64_t>(envSize));
+    key = IBLCache::hashCombine(key, static_cast<uint64_t>(prefilterSize));
+    key = IBLCache::hashCombine(key, PREFILTER_MIPS);
+    return key;
+}
+
+uint64_t getBRDFLUTKey() {
+    uint64_t key = IBLCache::hashString("brdfLut");
+    key = IBLCache::hashCombine(key, BRDF_LUT_VERSION);
+    key = IBLCache::hashCombine(key, BRDF_LUT_SIZE);
+    return key;
+}
+
+}
+
+
+namespace {
+    const float PI = glm::pi<float>();
+
+    // Direction through a face texel, sc/tc in [-1, 1] (GL cube map face table)
+    glm::vec3 getFaceDirection(int face, float sc, float tc) {
+        switch (face) {
+        case 0:  return glm::vec3( 1.0f, -tc,  -sc);
+        case 1:  return glm::vec3(-1.0f, -tc,   sc);
+        case 2:  return glm::vec3( sc,    1.0f, tc);
+        case 3:  return glm::vec3( sc,   -1.0f, -tc);
+        case 4:  return glm::vec3( sc,   -tc,   1.0f);
+        default: return glm::vec3(-sc,   -tc,  -1.0f);
+        }
+    }
+
+    // Inverse of getFaceDirection(), s/t in [0, 1]
+    void getFaceCoords(const glm::vec3& dir, int& face, float& s, float& t) {
+        const glm::vec3 a = glm::abs(dir);
+        float sc, tc, ma;
+
+        if (a.x >= a.y && a.x >= a.z) {
+            face = dir.x > 0.0f ? 0 : 1;
+            sc   = dir.x > 0.0f ? -dir.z : dir.z;
+            tc   = -dir.y;
+            ma   = a.x;
+        }
+        else if (a.y >= a.z) {
+            face = dir.y > 0.0f ? 2 : 3;
+            sc   = dir.x;
+            tc   = dir.y > 0.0f ? dir.z : -dir.z;
+            ma   = a.y;
+        }
+        else {
+            face = dir.z > 0.0f ? 4 : 5;
+            sc   = dir.z > 0.0f ? dir.x : -dir.x;
+            tc   = -dir.y;
+            ma   = a.z;
+        }
+
+        s = 0.5f * (sc / ma + 1.0f);
+        t = 0.5f * (tc / ma + 1.0f);
+    }
+
+    float radicalInverseVDC(uint32_t bits) {
+        bits = (bits << 16u) | (bits >> 16u);
+        bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+        bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+        bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+        bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+        return static_cast<float>(bits) * 2.3283064365386963e-10f;
+    }
+
+    // GGX half vector around +Z
+    glm::vec3 sampleGGXTangent(unsigned i, unsigned count, float roughness) {
+        const float a   = roughness * roughness;
+        const float xiX = static_cast<float>(i) / static_cast<float>(count);
+        const float xiY = radicalInverseVDC(i);
+
+        const float phi      = 2.0f * PI * xiX;
+        const float cosTheta = std::sqrt((1.0f - xiY) / (1.0f + (a * a - 1.0f) * xiY));
+        const float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+
+        return glm::vec3(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta);
+    }
+
+    float distributionGGX(float nDotH, float roughness) {
+        const float a2    = roughness * roughness * roughness * roughness;
+        const float denom = nDotH * nDotH * (a2 - 1.0f) + 1.0f;
+        return a2 / (PI * denom * denom);
+    }
+
+    float geometrySchlickGGX(float nDotV, float k) {
+        return nDotV / (nDotV * (1.0f - k) + k);
+    }
+
+    glm::vec3 sampleEquirect(const HDRImage& image, const glm::vec3& dir) {
+        // Same constants as equirectToUnitCube.frag, GL_REPEAT + GL_LINEAR
+        const float u = std::atan2(dir.z, dir.x) * 0.1591f + 0.5f;
+        const float v = std::asin(glm::clamp(dir.y, -1.0f, 1.0f)) * 0.3183f + 0.5f;
+
+        const float px = u * image.width  - 0.5f;
+        const float py = v * image.height - 0.5f;
+        const int   x0 = static_cast<int>(std::floor(px));
+        const int   y0 = static_cast<int>(std::floor(py));
+        const float fx = px - x0;
+        const float fy = py - y0;
+
+        auto wrap = [](int i, int n) { return ((i % n) + n) % n; };
+        auto texel = [&](int x, int y) {
+            const float* p = image.pixels.data() + (static_cast<size_t>(wrap(y, image.height)) * image.width + wrap(x, image.width)) * 3;
+            return glm::vec3(p[0], p[1], p[2]);
+        };
+
+        return glm::mix(
+            glm::mix(texel(x0, y0),     texel(x0 + 1, y0),     fx),
+            glm::mix(texel(x0, y0 + 1), texel(x0 + 1, y0 + 1), fx),
+            fy);
+    }
+
+    glm::vec3 sampleFace(const float* face, int size, float s, float t) {
+        const float px = s * size - 0.5f;
+        const float py = t * size - 0.5f;
+        const int   x0 = static_cast<int>(std::floor(px));
+        const int   y0 = static_cast<int>(std::floor(py));
+        const float fx = px - x0;
+        const float fy = py - y0;
+
+        auto texel = [&](int x, int y) {
+            x = glm::clamp(x, 0, size - 1);
+            y = glm::clamp(y, 0, size - 1);
+            const float* p = face + (static_cast<size_t>(y) * size + x) * 3;
+            return glm::vec3(p[0], p[1], p[2]);
+        };
+
+        return glm::mix(
+            glm::mix(texel(x0, y0),     texel(x0 + 1, y0),     fx),
+            glm::mix(texel(x0, y0 + 1), texel(x0 + 1, y0 + 1), fx),
+            fy);
+    }
+
+    uint16_t toHalf(float value) {
+        return glm::packHalf1x16(value);
+    }
+}
+
+
+/* ===== FLOAT CUBEMAP ======================================================= */
+glm::vec3 FloatCubemap::sample(const glm::vec3& dir, float lod) const {
+    int   face;
+    float s, t;
+    getFaceCoords(dir, face, s, t);
+
+    const int maxLevel = static_cast<int>(levels.size()) - 1;
+    lod = glm::clamp(lod, 0.0f, static_cast<float>(maxLevel));
+
+    const int   level0 = static_cast<int>(std::floor(lod));
+    const int   level1 = std::min(level0 + 1, maxLevel);
+    const float frac   = lod - level0;
+
+    auto sampleLevel = [&](int level) {
+        return sampleFace(levels[level].data() + face * getFaceFloatCount(level), getLevelSize(level), s, t);
+    };
+
+    glm::vec3 result = sampleLevel(level0);
+    if (frac > 0.0f && level1 != level0) {
+        result = glm::mix(result, sampleLevel(level1), frac);
+    }
+    return result;
+}
+
+
+/* ===== BAKING ============================================================== */
+namespace IBLBaker {
+
+FloatCubemap equirectToCubemap(const HDRImage& image, int size) {
+    FloatCubemap cubemap;
+    cubemap.baseSize = size;
+    cubemap.levels.resize(1);
+    cubemap.levels[0].resize(cubemap.getFaceFloatCount(0) * 6);
+
+    if (!image.isValid()) return cubemap;
+
+    // One job item per face row
+    ThreadPool::getGlobal().parallelFor(static_cast<size_t>(6 * size), 16, [&](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; ++row) {
+            const int face = static_cast<int>(row) / size;
+            const int y    = static_cast<int>(row) % size;
+            const float tc = 2.0f * (y + 0.5f) / size - 1.0f;
+
+            float* dst = cubemap.levels[0].data() + face * cubemap.getFaceFloatCount(0) + static_cast<size_t>(y) * size * 3;
+            for (int x = 0; x < size; ++x) {
+                const float sc = 2.0f * (x + 0.5f) / size - 1.0f;
+                const glm::vec3 color = sampleEquirect(image, glm::normalize(getFaceDirection(face, sc, tc)));
+
+                dst[x * 3 + 0] = color.r;
+                dst[x * 3 + 1] = color.g;
+                dst[x * 3 + 2] = color.b;
+            }
+        }
+    });
+
+    return cubemap;
+}
+
+// 2x2 box filter per face, like most glGenerateMipmap implementations
+void generateMipmaps(FloatCubemap& cubemap) {
+    const int mipCount = IBLSettings::getMipCount(cubemap.baseSize);
+    cubemap.levels.resize(mipCount);
+
+    for (int level = 1; level < mipCount; ++level) {
+        const int srcSize = cubemap.getLevelSize(level - 1);
+        const int dstSize = cubemap.getLevelSize(level);
+        const std::vector<float>& src = cubemap.levels[level - 1];
+        std::vector<float>&       dst = cubemap.levels[level];
+        dst.resize(cubemap.getFaceFloatCount(level) * 6);
+
+        ThreadPool::getGlobal().parallelFor(static_cast<size_t>(6 * dstSize), 32, [&](size_t begin, size_t end) {
+            for (size_t row = begin; row < end; ++row) {
+                const int face = static_cast<int>(row) / dstSize;
+                const int y    = static_cast<int>(row) % dstSize;
+
+                const float* srcFace = src.data() + face * cubemap.getFaceFloatCount(level - 1);
+                float*       dstRow  = dst.data() + face * cubemap.getFaceFloatCount(level) + static_cast<size_t>(y) * dstSize * 3;
+
+                for (int x = 0; x < dstSize; ++x) {
+                    const int sx0 = std::min(x * 2, srcSize - 1), sx1 = std::min(x * 2 + 1, srcSize - 1);
+                    const int sy0 = std::min(y * 2, srcSize - 1), sy1 = std::min(y * 2 + 1, srcSize - 1);
+
+                    for (int c = 0; c < 3; ++c) {
+                        dstRow[x * 3 + c] = 0.25f * (
+                            srcFace[(sy0 * srcSize + sx0) * 3 + c] + srcFace[(sy0 * srcSize + sx1) * 3 + c] +
+                            srcFace[(sy1 * srcSize + sx0) * 3 + c] + srcFace[(sy1 * srcSize + sx1) * 3 + c]);
+                    }
+                }
+            }
+        });
+    }
+}
+
+FloatCubemap prefilter(const FloatCubemap& env, int size, int mipCount, unsigned sampleCount) {
+    struct Sample {
+        glm::vec3 dir;      // Light direction around +Z
+        float     nDotL;
+        float     lod;
+    };
+
+    FloatCubemap result;
+    result.baseSize = size;
+    result.levels.resize(mipCount);
+
+    const float saTexel = 4.0f * PI / (6.0f * env.baseSize * env.baseSize);
+
+    for (int mip = 0; mip < mipCount; ++mip) {
+        const float roughness = mipCount > 1 ? static_cast<float>(mip) / static_cast<float>(mipCount - 1) : 0.0f;
+        const int   mipSize   = result.getLevelSize(mip);
+        result.levels[mip].resize(result.getFaceFloatCount(mip) * 6);
+
+        // V = N, so every sample only depends on the roughness and can be set up once per mip
+        std::vector<Sample> samples;
+        samples.reserve(sampleCount);
+        for (unsigned i = 0; i < sampleCount; ++i) {
+            const glm::vec3 halfVec = sampleGGXTangent(i, sampleCount, roughness);
+            const glm::vec3 l       = 2.0f * halfVec.z * halfVec - glm::vec3(0.0f, 0.0f, 1.0f);
+            if (l.z <= 0.0f) continue;
+
+            const float pdf      = distributionGGX(halfVec.z, roughness) * 0.25f + 0.0001f;
+            const float saSample = 1.0f / (static_cast<float>(sampleCount) * pdf + 0.0001f);
+            const float lod      = roughness == 0.0f ? 0.0f : 0.5f * std::log2(saSample / saTexel);
+
+            samples.push_back({ l, l.z, lod });
+        }
+
+        ThreadPool::getGlobal().parallelFor(static_cast<size_t>(6 * mipSize), 4, [&](size_t begin, size_t end) {
+            for (size_t row = begin; row < end; ++row) {
+                const int face = static_cast<int>(row) / mipSize;
+                const int y    = static_cast<int>(row) % mipSize;
+                const float tc = 2.0f * (y + 0.5f) / mipSize - 1.0f;
+
+                float* dst = result.levels[mip].data() + face * result.getFaceFloatCount(mip) + static_cast<size_t>(y) * mipSize * 3;
+                for (int x = 0; x < mipSize; ++x) {
+                    const float     sc = 2.0f * (x + 0.5f) / mipSize - 1.0f;
+                    const glm::vec3 n  = glm::normalize(getFaceDirection(face, sc, tc));
+
+                    glm::vec3 color(0.0f);
+                    if (roughness == 0.0f) {
+                        color = env.sample(n, 0.0f);
+                    }
+                    else {
+                        const glm::vec3 up        = std::abs(n.z) < 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+                        const glm::vec3 tangent   = glm::normalize(glm::cross(up, n));
+                        const glm::vec3 bitangent = glm::cross(tangent, n);
+
+                        float totalWeight = 0.0f;
+                        for (const Sample& smp : samples) {
+                            const glm::vec3 l = tangent * smp.dir.x + bitangent * smp.dir.y + n * smp.dir.z;
+                            color       += env.sample(l, smp.lod) * smp.nDotL;
+                            totalWeight += smp.nDotL;
+                        }
+                        color /= totalWeight;
+                    }
+
+                    dst[x * 3 + 0] = color.r;
+                    dst[x * 3 + 1] = color.g;
+                    dst[x * 3 + 2] = color.b;
+                }
+            }
+        });
+    }
+
+    return result;
+}
+
+// Split-sum BRDF, texel (x, y) = (nDotV, roughness) at texel centers like the fullscreen quad
+std::vector<float> integrateBRDF(int size, unsigned sampleCount) {
+    std::vector<float> lut(static_cast<size_t>(size) * size * 2);
+
+    ThreadPool::getGlobal().parallelFor(static_cast<size_t>(size), 8, [&](size_t begin, size_t end) {
+        std::vector<float> halfX(sampleCount);
+        std::vector<float> halfZ(sampleCount);
+
+        for (size_t y = begin; y < end; ++y) {
+            const float roughness = (y + 0.5f) / size;
+            const float k         = roughness * roughness * 0.5f;
+
+            // With N = +Z the shader's tangent frame is T = -Y, B = -X, so world H.x = -H_tangent.y.
+            // V has no Y component, H.y never matters
+            for (unsigned i = 0; i < sampleCount; ++i) {
+                const glm::vec3 h = sampleGGXTangent(i, sampleCount, roughness);
+                halfX[i] = -h.y;
+                halfZ[i] = h.z;
+            }
+
+            float* dst = lut.data() + y * size * 2;
+            int x = 0;
+
+#ifdef PC_IBL_USE_SSE2
+            const __m128 vZero = _mm_setzero_ps();
+            const __m128 vOne  = _mm_set1_ps(1.0f);
+            const __m128 vTwo  = _mm_set1_ps(2.0f);
+            const __m128 vK    = _mm_set1_ps(k);
+            const __m128 vOneMinusK = _mm_set1_ps(1.0f - k);
+
+            for (; x + 4 <= size; x += 4) {
+                const __m128 nDotV = _mm_setr_ps((x + 0.5f) / size, (x + 1.5f) / size, (x + 2.5f) / size, (x + 3.5f) / size);
+                const __m128 vX    = _mm_sqrt_ps(_mm_sub_ps(vOne, _mm_mul_ps(nDotV, nDotV)));
+                const __m128 vZ    = nDotV;
+                const __m128 gV    = _mm_div_ps(nDotV, _mm_add_ps(_mm_mul_ps(nDotV, vOneMinusK), vK));
+
+                __m128 sumA = vZero;
+                __m128 sumB = vZero;
+
+                for (unsigned i = 0; i < sampleCount; ++i) {
+                    const __m128 hX = _mm_set1_ps(halfX[i]);
+                    const __m128 hZ = _mm_set1_ps(halfZ[i]);
+
+                    const __m128 vDotHRaw = _mm_add_ps(_mm_mul_ps(vX, hX), _mm_mul_ps(vZ, hZ));
+                    const __m128 lZ       = _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(vTwo, vDotHRaw), hZ), vZ);
+                    const __m128 mask     = _mm_cmpgt_ps(lZ, vZero);
+
+                    const __m128 vDotH = _mm_max_ps(vDotHRaw, vZero);
+                    const __m128 nDotH = _mm_max_ps(hZ, vZero);
+                    const __m128 gL    = _mm_div_ps(lZ, _mm_add_ps(_mm_mul_ps(lZ, vOneMinusK), vK));
+                    const __m128 gVis  = _mm_div_ps(_mm_mul_ps(_mm_mul_ps(gV, gL), vDotH), _mm_mul_ps(nDotH, nDotV));
+
+                    const __m128 oneMinusVDotH = _mm_sub_ps(vOne, vDotH);
+                    const __m128 sq = _mm_mul_ps(oneMinusVDotH, oneMinusVDotH);
+                    const __m128 fc = _mm_mul_ps(_mm_mul_ps(sq, sq), oneMinusVDotH);
+
+                    sumA = _mm_add_ps(sumA, _mm_and_ps(mask, _mm_mul_ps(_mm_sub_ps(vOne, fc), gVis)));
+                    sumB = _mm_add_ps(sumB, _mm_and_ps(mask, _mm_mul_ps(fc, gVis)));
+                }
+
+                const __m128 invCount = _mm_set1_ps(1.0f / static_cast<float>(sampleCount));
+                alignas(16) float a[4];
+                alignas(16) float b[4];
+                _mm_store_ps(a, _mm_mul_ps(sumA, invCount));
+                _mm_store_ps(b, _mm_mul_ps(sumB, invCount));
+
+                for (int lane = 0; lane < 4; ++lane) {
+                    dst[(x + lane) * 2 + 0] = a[lane];
+                    dst[(x + lane) * 2 + 1] = b[lane];
+                }
+            }
+#endif
+
+            // Scalar tail (or the whole row without SSE)
+            for (; x < size; ++x) {
+                const float nDotV = (x + 0.5f) / size;
+                const float vX    = std::sqrt(1.0f - nDotV * nDotV);
+                const float gV    = geometrySchlickGGX(nDotV, k);
+
+                float sumA = 0.0f;
+                float sumB = 0.0f;
+                for (unsigned i = 0; i < sampleCount; ++i) {
+                    const float vDotHRaw = vX * halfX[i] + nDotV * halfZ[i];
+                    const float lZ       = 2.0f * vDotHRaw * halfZ[i] - nDotV;
+                    if (lZ <= 0.0f) continue;
+
+                    const float vDotH = std::max(vDotHRaw, 0.0f);
+                    const float nDotH = std::max(halfZ[i], 0.0f);
+                    const float gVis  = (gV * geometrySchlickGGX(lZ, k) * vDotH) / (nDotH * nDotV);
+                    const float fc    = std::pow(1.0f - vDotH, 5.0f);
+
+                    sumA += (1.0f - fc) * gVis;
+                    sumB += fc * gVis;
+                }
+
+                dst[x * 2 + 0] = sumA / static_cast<float>(sampleCount);
+                dst[x * 2 + 1] = sumB / static_cast<float>(sampleCount);
+            }
+        }
+    });
+
+    return lut;
+}
+
+
+// --FULL BAKES
+std::vector<IBLImage> bakeEnvironment(const HDRImage& image, int envSize, int prefilterSize) {
+    FloatCubemap env = equirectToCubemap(image, envSize);
+    generateMipmaps(env);
+
+    const FloatCubemap prefiltered = prefilter(env, prefilterSize, IBLSettings::PREFILTER_MIPS, IBLSettings::SAMPLE_COUNT);
+    const SH9          irradiance  = SphericalHarmonics::toIrradiance(SphericalHarmonics::projectEquirect(image));
+
+    return { toIBLImage(env), toIBLImage(prefiltered), toIBLImage(irradiance) };
+}
+
+std::vector<IBLImage> bakeBRDFLUT() {
+    const std::vector<float> lut = integrateBRDF(IBLSettings::BRDF_LUT_SIZE, IBLSettings::SAMPLE_COUNT);
+
+    IBLImage image;
+    image.faceCount = 1;
+    image.channels  = 2;
+    image.baseSize  = IBLSettings::BRDF_LUT_SIZE;
+    image.levels.resize(1);
+    image.levels[0].resize(lut.size());
+    std::transform(lut.begin(), lut.end(), image.levels[0].begin(), toHalf);
+
+    return { image };
+}
+
+
+// --CACHE LAYOUT
+IBLImage toIBLImage(const FloatCubemap& cubemap) {
+    IBLImage image;
+    image.faceCount = 6;
+    image.channels  = 3;
+    image.baseSize  = cubemap.baseSize;
+    image.levels.resize(cubemap.levels.size());
+
+    for (size_t level = 0; level < cubemap.levels.size(); ++level) {
+        image.levels[level].resize(cubemap.levels[level].size());
+        std::transform(cubemap.levels[level].begin(), cubemap.levels[level].end(), image.levels[level].begin(), toHalf);
+    }
+    return image;
+}
+
+// The 9 coefficients are stored as a 3x3 RGB image
+IBLImage toIBLImage(const SH9& sh) {
+    IBLImage image;
+    image.faceCount = 1;
+    image.channels  = 3;
+    image.baseSize  = 3;
+    image.levels.resize(1);
+
+    for (const glm::vec3& c : sh.coeffs) {
+        image.levels[0].push_back(toHalf(c.x));
+        image.levels[0].push_back(toHalf(c.y));
+        image.levels[0].push_back(toHalf(c.z));
+    }
+    return image;
+}
+
+SH9 toSH9(const IBLImage& image) {
+    SH9 sh;
+    if (image.levels.empty() || image.levels[0].size() < 27) return sh;
+
+    for (int k = 0; k < 9; ++k) {
+        const uint16_t* c = image.levels[0].data() + k * 3;
+        sh.coeffs[k] = glm::vec3(glm::unpackHalf1x16(c[0]), glm::unpackHalf1x16(c[1]), glm::unpackHalf1x16(c[2]));
+    }
+    return sh;
+}
+
+
+// --VERIFICATION
+CompareResult compare(const IBLImage& reference, const IBLImage& other) {
+    CompareResult result;
+    if (reference.levels.size() != other.levels.size()) {
+        result.maxAbsError = result.rmse = result.relativeRmse = INFINITY;
+        return result;
+    }
+
+    double sumSq  = 0.0;
+    double sumRef = 0.0;
+    size_t count  = 0;
+
+    for (size_t level = 0; level < reference.levels.size(); ++level) {
+        const std::vector<uint16_t>& a = reference.levels[level];
+        const std::vector<uint16_t>& b = other.levels[level];
+        if (a.size() != b.size()) {
+            result.maxAbsError = result.rmse = result.relativeRmse = INFINITY;
+            return result;
+        }
+
+        for (size_t i = 0; i < a.size(); ++i) {
+            const float ref  = glm::unpackHalf1x16(a[i]);
+            const float diff = glm::unpackHalf1x16(b[i]) - ref;
+
+            result.maxAbsError = std::max(result.maxAbsError, std::abs(diff));
+            sumSq  += static_cast<double>(diff) * diff;
+            sumRef += std::abs(ref);
+        }
+        count += a.size();
+    }
+
+    if (count > 0) {
+        result.rmse = static_cast<float>(std::sqrt(sumSq / count));
+        const double meanRef = sumRef / count;
+        result.relativeRmse = meanRef > 0.0 ? static_cast<float>(result.rmse / meanRef) : 0.0f;
+    }
+    return result;
+}
+
+namespace {
+    // Relative RMSE limits. The CPU clamps its bilinear lookups at face edges where the GPU filters
+    // across them, the prefilter's blurry mips pick up the most of that
+    struct VerifiedMap {
+        const char* name;
+        float       tolerance;
+    };
+    constexpr VerifiedMap ENVIRONMENT_MAPS[] = { { "environment", 0.02f }, { "prefilter", 0.05f }, { "irradianceSH", 0.01f } };
+    constexpr VerifiedMap BRDF_LUT_MAP       = { "brdfLut", 0.01f };
+}
+
+bool verify(const std::vector<IBLImage>& reference, const std::vector<IBLImage>& images) {
+    const bool isEnvironment = reference.size() == std::size(ENVIRONMENT_MAPS);
+    if ((!isEnvironment && reference.size() != 1) || images.size() != reference.size()) {
+        std::cout << "[IBL VERIFY] Bake layouts differ: FAIL\n";
+        return false;
+    }
+
+    bool isPassing = true;
+    for (size_t i = 0; i < reference.size(); ++i) {
+        const VerifiedMap&  map    = isEnvironment ? ENVIRONMENT_MAPS[i] : BRDF_LUT_MAP;
+        const CompareResult result = compare(reference[i], images[i]);
+        const bool          isOk   = result.isWithin(map.tolerance);
+
+        std::cout << "[IBL VERIFY] " << map.name
+                  << ": max abs " << result.maxAbsError
+                  << ", rmse " << result.rmse
+                  << ", relative rmse " << result.relativeRmse * 100.0f << "% (limit " << map.tolerance * 100.0f << "%): "
+                  << (isOk ? "PASS" : "FAIL") << '\n';
+        isPassing = isPassing && isOk;
+    }
+    return isPassing;
+}
+
+}
@@ -0,0 +1,178 @@
+#include "headers/iblCache.h"
+
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+
+
+namespace {
+    constexpr char     IBL_MAGIC[8] = { 'P', 'C', 'I', 'B', 'L', '0', '1', '\n' };
+    constexpr uint64_t FNV_OFFSET   = 14695981039346656037ull;
+    constexpr uint64_t FNV_PRIME    = 1099511628211ull;
+
+    constexpr uint32_t MAX_IMAGES   = 16;
+    constexpr uint32_t MAX_LEVELS   = 16;
+    constexpr uint32_t MAX_SIZE     = 8192;
+
+    uint64_t fnv1a(uint64_t hash, const unsigned char* data, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= data[i];
+            hash *= FNV_PRIME;
+        }
+        return hash;
+    }
+
+    template <typename T>
+    void writePOD(std::ofstream& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    bool readPOD(std::ifstream& in, T& value) {
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+}
+
+
+IBLCache::IBLCache(const std::filesystem::path& i_dir) : m_dir(i_dir) {}
+
+std::filesystem::path IBLCache::getEntryPath(uint64_t key) const {
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << key << ".pcibl";
+    return m_dir / name.str();
+}
+
+
+// --LOADING
+bool IBLCache::load(uint64_t key, std::vector<IBLImage>& images) const {
+    const std::filesystem::path path = getEntryPath(key);
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+
+    char     magic[8];
+    uint64_t fileKey    = 0;
+    uint32_t imageCount = 0;
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, IBL_MAGIC, sizeof(magic)) != 0 ||
+        !readPOD(in, fileKey) || fileKey != key ||
+        !readPOD(in, imageCount) || imageCount > MAX_IMAGES) {
+        std::cerr << "[IBL CACHE] Bad header, ignoring " << path << '\n';
+        return false;
+    }
+
+    std::vector<IBLImage> result(imageCount);
+    for (IBLImage& image : result) {
+        uint32_t levelCount = 0;
+        if (!readPOD(in, image.faceCount) || !readPOD(in, image.channels) ||
+            !readPOD(in, image.baseSize)  || !readPOD(in, levelCount) ||
+            (image.faceCount != 1 && image.faceCount != 6) ||
+            image.channels == 0 || image.channels > 4 ||
+            image.baseSize == 0 || image.baseSize > MAX_SIZE || levelCount > MAX_LEVELS) {
+            std::cerr << "[IBL CACHE] Bad image descriptor, ignoring " << path << '\n';
+            return false;
+        }
+
+        image.levels.resize(levelCount);
+        for (uint32_t level = 0; level < levelCount; ++level) {
+            uint64_t byteLength = 0;
+            const uint64_t expected = image.getFaceHalfCount(level) * image.faceCount * sizeof(uint16_t);
+            if (!readPOD(in, byteLength) || byteLength != expected) {
+                std::cerr << "[IBL CACHE] Bad level size, ignoring " << path << '\n';
+                return false;
+            }
+
+            image.levels[level].resize(byteLength / sizeof(uint16_t));
+            if (!in.read(reinterpret_cast<char*>(image.levels[level].data()), byteLength)) {
+                std::cerr << "[IBL CACHE] Truncated entry, ignoring " << path << '\n';
+                return false;
+            }
+        }
+    }
+
+    images = std::move(result);
+    std::cout << "[IBL CACHE] Hit " << path.filename() << '\n';
+    return true;
+}
+
+
+// --STORING
+// Written to a temp file first so an interrupted write never leaves a half entry behind
+bool IBLCache::store(uint64_t key, const std::vector<IBLImage>& images) const {
+    std::error_code ec;
+    std::filesystem::create_directories(m_dir, ec);
+    if (ec) {
+        std::cerr << "[IBL CACHE] Can't create " << m_dir << ": " << ec.message() << '\n';
+        return false;
+    }
+
+    const std::filesystem::path path    = getEntryPath(key);
+    std::filesystem::path       tmpPath = path;
+    tmpPath += ".tmp";
+
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "[IBL CACHE] Can't write " << tmpPath << '\n';
+            return false;
+        }
+
+        out.write(IBL_MAGIC, sizeof(IBL_MAGIC));
+        writePOD(out, key);
+        writePOD(out, static_cast<uint32_t>(images.size()));
+
+        for (const IBLImage& image : images) {
+            writePOD(out, image.faceCount);
+            writePOD(out, image.channels);
+            writePOD(out, image.baseSize);
+            writePOD(out, static_cast<uint32_t>(image.levels.size()));
+
+            for (const auto& level : image.levels) {
+                const uint64_t byteLength = level.size() * sizeof(uint16_t);
+                writePOD(out, byteLength);
+                out.write(reinterpret_cast<const char*>(level.data()), byteLength);
+            }
+        }
+
+        if (!out) {
+            std::cerr << "[IBL CACHE] Write failed for " << tmpPath << '\n';
+            out.close();
+            std::filesystem::remove(tmpPath, ec);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec) {
+        std::filesystem::remove(tmpPath, ec);
+        return false;
+    }
+
+    std::cout << "[IBL CACHE] Stored " << path.filename() << '\n';
+    return true;
+}
+
+
+// --HASHING
+uint64_t IBLCache::hashFile(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return 0;
+
+    uint64_t hash = FNV_OFFSET;
+    std::array<char, 64 * 1024> buffer;
+    while (in) {
+        in.read(buffer.data(), buffer.size());
+        hash = fnv1a(hash, reinterpret_cast<const unsigned char*>(buffer.data()), static_cast<size_t>(in.gcount()));
+    }
+    return hash;
+}
+
+uint64_t IBLCache::hashString(const std::string& str) {
+    return fnv1a(FNV_OFFSET, reinterpret_cast<const unsigned char*>(str.data()), str.size());
+}
+
+uint64_t IBLCache::hashCombine(uint64_t hash, uint64_t value) {
+    return fnv1a(hash, reinterpret_cast<const unsigned char*>(&value), sizeof(value));
+}
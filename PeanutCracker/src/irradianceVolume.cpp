@@ -0,0 +1,90 @@
+#include "headers/irradianceVolume.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+
+IrradianceVolume::IrradianceVolume() {
+    glGenTextures(3, m_textureIDs.data());
+
+    for (GLuint id : m_textureIDs) {
+        glBindTexture(GL_TEXTURE_3D, id);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+IrradianceVolume::~IrradianceVolume() {
+    glDeleteTextures(3, m_textureIDs.data());
+}
+
+
+glm::vec3 IrradianceVolume::getProbePosition(int index) const {
+    const glm::ivec3 cell(index % resolution.x, (index / resolution.x) % resolution.y, index / (resolution.x * resolution.y));
+    const glm::vec3  t = glm::vec3(cell) / glm::max(glm::vec3(resolution - 1), glm::vec3(1.0f));
+    return boundsMin + t * (boundsMax - boundsMin);
+}
+
+
+// --BAKE
+void IrradianceVolume::beginBake() {
+    resolution = glm::clamp(resolution, glm::ivec3(1), glm::ivec3(MAX_RESOLUTION));
+
+    m_bakingMin        = boundsMin;
+    m_bakingMax        = boundsMax;
+    m_bakingResolution = resolution;
+
+    for (auto& channel : m_coeffs) {
+        channel.assign(static_cast<size_t>(getProbeCount()), glm::vec4(0.0f));
+    }
+}
+
+void IrradianceVolume::setProbe(int index, const SH9& irradiance) {
+    // Same basis order as evalIrradianceSH(), only the L0 and L1 bands are kept
+    for (int c = 0; c < 3; ++c) {
+        m_coeffs[c][index] = glm::vec4(irradiance.coeffs[0][c], irradiance.coeffs[1][c], irradiance.coeffs[2][c], irradiance.coeffs[3][c]);
+    }
+}
+
+void IrradianceVolume::finishBake() {
+    const glm::ivec3 res = m_bakingResolution;
+
+    std::vector<uint16_t> halfs(m_coeffs[0].size() * 4);
+    for (int c = 0; c < 3; ++c) {
+        for (size_t i = 0; i < m_coeffs[c].size(); ++i) {
+            for (int k = 0; k < 4; ++k) {
+                halfs[i * 4 + k] = glm::packHalf1x16(m_coeffs[c][i][k]);
+            }
+        }
+
+        glBindTexture(GL_TEXTURE_3D, m_textureIDs[c]);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, res.x, res.y, res.z, 0, GL_RGBA, GL_HALF_FLOAT, halfs.data());
+    }
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    m_bakedMin        = m_bakingMin;
+    m_bakedMax        = m_bakingMax;
+    m_bakedResolution = res;
+    m_isBaked         = true;
+    ++m_bakeCount;
+
+    for (auto& channel : m_coeffs) {
+        channel = std::vector<glm::vec4>();
+    }
+
+    std::cout << "[VOLUME] Baked " << res.x << "x" << res.y << "x" << res.z << " irradiance probes\n";
+}
+
+void IrradianceVolume::bind(unsigned int firstSlot) const {
+    for (unsigned int c = 0; c < 3; ++c) {
+        glActiveTexture(GL_TEXTURE0 + firstSlot + c);
+        glBindTexture(GL_TEXTURE_3D, m_textureIDs[c]);
+    }
+}
@@ -0,0 +1,270 @@
+#include "headers/json.h"
+
+#include <cstdlib>
+#include <cstring>
+
+
+namespace {
+    const JsonValue NULL_VALUE;
+    const std::string EMPTY_STRING;
+
+    constexpr int MAX_DEPTH = 256;      // Deeper documents are rejected instead of overflowing the stack
+}
+
+
+// Recursive descent over the raw bytes, strings are taken as UTF-8
+class JsonParser {
+public:
+    JsonParser(const char* text, size_t length)
+        : m_cursor(text)
+        , m_end(text + length)
+    {}
+
+    bool parseDocument(JsonValue& out) {
+        if (!parseValue(out, 0)) return false;
+
+        skipWhitespace();
+        if (m_cursor != m_end) return fail("trailing characters after the document");
+        return true;
+    }
+
+    const std::string& getError() const { return m_error; }
+
+private:
+    const char* m_cursor;
+    const char* m_end;
+    std::string m_error;
+
+    bool fail(const char* message) {
+        if (m_error.empty()) m_error = message;
+        return false;
+    }
+
+    void skipWhitespace() {
+        while (m_cursor < m_end && (*m_cursor == ' ' || *m_cursor == '\t' || *m_cursor == '\n' || *m_cursor == '\r')) {
+            ++m_cursor;
+        }
+    }
+
+    bool consume(const char* literal) {
+        const size_t length = std::strlen(literal);
+        if (static_cast<size_t>(m_end - m_cursor) < length || std::memcmp(m_cursor, literal, length) != 0) return false;
+        m_cursor += length;
+        return true;
+    }
+
+    bool parseValue(JsonValue& out, int depth) {
+        if (depth > MAX_DEPTH) return fail("nesting too deep");
+
+        skipWhitespace();
+        if (m_cursor == m_end) return fail("unexpected end of document");
+
+        switch (*m_cursor) {
+        case '{': return parseObject(out, depth);
+        case '[': return parseArray(out, depth);
+        case '"':
+            out.m_type = JsonValue::Type::STRING;
+            return parseString(out.m_string);
+        case 't':
+        case 'f':
+            out.m_type = JsonValue::Type::BOOLEAN;
+            out.m_bool = *m_cursor == 't';
+            return consume(out.m_bool ? "true" : "false") || fail("invalid literal");
+        case 'n':
+            out.m_type = JsonValue::Type::NUL;
+            return consume("null") || fail("invalid literal");
+        default:
+            return parseNumber(out);
+        }
+    }
+
+    bool parseObject(JsonValue& out, int depth) {
+        out.m_type = JsonValue::Type::OBJECT;
+        ++m_cursor;
+
+        skipWhitespace();
+        if (m_cursor < m_end && *m_cursor == '}') {
+            ++m_cursor;
+            return true;
+        }
+
+        while (true) {
+            skipWhitespace();
+            if (m_cursor == m_end || *m_cursor != '"') return fail("expected a key");
+
+            out.m_keys.emplace_back();
+            if (!parseString(out.m_keys.back())) return false;
+
+            skipWhitespace();
+            if (m_cursor == m_end || *m_cursor != ':') return fail("expected ':'");
+            ++m_cursor;
+
+            out.m_elements.emplace_back();
+            if (!parseValue(out.m_elements.back(), depth + 1)) return false;
+
+            skipWhitespace();
+            if (m_cursor == m_end) return fail("unterminated object");
+            if (*m_cursor == ',') { ++m_cursor; continue; }
+            if (*m_cursor == '}') { ++m_cursor; return true; }
+            return fail("expected ',' or '}'");
+        }
+    }
+
+    bool parseArray(JsonValue& out, int depth) {
+        out.m_type = JsonValue::Type::ARRAY;
+        ++m_cursor;
+
+        skipWhitespace();
+        if (m_cursor < m_end && *m_cursor == ']') {
+            ++m_cursor;
+            return true;
+        }
+
+        while (true) {
+            out.m_elements.emplace_back();
+            if (!parseValue(out.m_elements.back(), depth + 1)) return false;
+
+            skipWhitespace();
+            if (m_cursor == m_end) return fail("unterminated array");
+            if (*m_cursor == ',') { ++m_cursor; continue; }
+            if (*m_cursor == ']') { ++m_cursor; return true; }
+            return fail("expected ',' or ']'");
+        }
+    }
+
+    bool parseHex4(unsigned int& code) {
+        if (m_end - m_cursor < 4) return fail("truncated escape");
+
+        code = 0;
+        for (int i = 0; i < 4; ++i) {
+            const char c = *m_cursor++;
+            code <<= 4;
+            if      (c >= '0' && c <= '9') code |= static_cast<unsigned int>(c - '0');
+            else if (c >= 'a' && c <= 'f') code |= static_cast<unsigned int>(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') code |= static_cast<unsigned int>(c - 'A' + 10);
+            else return fail("invalid escape");
+        }
+        return true;
+    }
+
+    static void appendUtf8(std::string& out, unsigned int code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        }
+        else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        else {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    bool parseString(std::string& out) {
+        ++m_cursor;     // Opening quote
+
+        while (m_cursor < m_end) {
+            // Copy plain runs in one go, most strings have no escapes at all
+            const char* runStart = m_cursor;
+            while (m_cursor < m_end && *m_cursor != '"' && *m_cursor != '\\') ++m_cursor;
+            out.append(runStart, m_cursor);
+            if (m_cursor == m_end) break;
+
+            if (*m_cursor == '"') {
+                ++m_cursor;
+                return true;
+            }
+
+            ++m_cursor;     // Backslash
+            if (m_cursor == m_end) break;
+
+            const char escape = *m_cursor++;
+            switch (escape) {
+            case '"':  out += '"';  break;
+            case '\\': out += '\\'; break;
+            case '/':  out += '/';  break;
+            case 'b':  out += '\b'; break;
+            case 'f':  out += '\f'; break;
+            case 'n':  out += '\n'; break;
+            case 'r':  out += '\r'; break;
+            case 't':  out += '\t'; break;
+            case 'u': {
+                unsigned int code;
+                if (!parseHex4(code)) return false;
+
+                // Surrogate pair
+                if (code >= 0xD800 && code < 0xDC00 && consume("\\u")) {
+                    unsigned int low;
+                    if (!parseHex4(low)) return false;
+                    if (low >= 0xDC00 && low < 0xE000) {
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                }
+                appendUtf8(out, code);
+                break;
+            }
+            default:
+                return fail("invalid escape");
+            }
+        }
+        return fail("unterminated string");
+    }
+
+    bool parseNumber(JsonValue& out) {
+        // strtod needs a terminator, the text may be a mapped file without one
+        char buffer[64];
+        size_t length = 0;
+        while (m_cursor < m_end && length < sizeof(buffer) - 1) {
+            const char c = *m_cursor;
+            if (!((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E')) break;
+            buffer[length++] = c;
+            ++m_cursor;
+        }
+        buffer[length] = '\0';
+        if (length == 0) return fail("unexpected character");
+
+        char* parsedEnd = nullptr;
+        out.m_type   = JsonValue::Type::NUMBER;
+        out.m_number = std::strtod(buffer, &parsedEnd);
+        return parsedEnd == buffer + length || fail("invalid number");
+    }
+};
+
+
+bool JsonValue::parse(const char* text, size_t length, JsonValue& out, std::string* error) {
+    out = JsonValue();
+
+    JsonParser parser(text, length);
+    if (parser.parseDocument(out)) return true;
+
+    if (error) *error = parser.getError();
+    out = JsonValue();
+    return false;
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const {
+    return index < m_elements.size() ? m_elements[index] : NULL_VALUE;
+}
+
+const JsonValue& JsonValue::operator[](const char* key) const {
+    for (size_t i = 0; i < m_keys.size(); ++i) {
+        if (m_keys[i] == key) return m_elements[i];
+    }
+    return NULL_VALUE;
+}
+
+bool JsonValue::has(const char* key) const {
+    return !(*this)[key].isNull();
+}
+
+const std::string& JsonValue::getKey(size_t index) const {
+    return index < m_keys.size() ? m_keys[index] : EMPTY_STRING;
+}
@@ -0,0 +1,105 @@
+#include "headers/ldrImage.h"
+
+#include "../stb_image/stb_image.h"
+
+#include <array>
+#include <cmath>
+#include <iostream>
+
+
+namespace {
+    struct SRGBTables {
+        std::array<float, 256>          toLinear;
+        std::array<unsigned char, 4096> fromLinear;     // Indexed by linear * 4095
+
+        SRGBTables() {
+            for (int i = 0; i < 256; ++i) {
+                const float c = i / 255.0f;
+                toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+            for (int i = 0; i < 4096; ++i) {
+                const float l = i / 4095.0f;
+                const float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+                fromLinear[i] = static_cast<unsigned char>(std::lround(c * 255.0f));
+            }
+        }
+    };
+
+    const SRGBTables& getSRGBTables() {
+        static const SRGBTables tables;
+        return tables;
+    }
+}
+
+
+bool LDRImage::load(const std::filesystem::path& path) {
+    std::cout << "[TEX] Loading: " << path << '\n';
+
+    int w, h, nComps;
+    unsigned char* data = stbi_load(path.string().c_str(), &w, &h, &nComps, 0);
+    if (!data) {
+        std::cerr << "[TEX] Failed to load: " << path << '\n';
+        return false;
+    }
+
+    width    = w;
+    height   = h;
+    channels = nComps;
+    pixels.assign(data, data + static_cast<size_t>(w) * h * nComps);
+
+    stbi_image_free(data);
+    return true;
+}
+
+void LDRImage::generateMips(bool sRGB) {
+    mips.clear();
+    if (!isValid()) return;
+
+    const SRGBTables& tables = getSRGBTables();
+    const int colorChannels  = sRGB ? std::min(channels, 3) : 0;   // Alpha stays linear
+
+    int levelCount = 1;
+    while ((width >> levelCount) > 0 || (height >> levelCount) > 0) ++levelCount;
+    mips.resize(levelCount - 1);
+
+    for (int level = 1; level < levelCount; ++level) {
+        const unsigned char* src = getLevelData(level - 1);
+        const int srcWidth  = getLevelWidth(level - 1);
+        const int srcHeight = getLevelHeight(level - 1);
+        const int dstWidth  = getLevelWidth(level);
+        const int dstHeight = getLevelHeight(level);
+
+        std::vector<unsigned char>& dst = mips[level - 1];
+        dst.resize(getLevelSize(level));
+
+        for (int y = 0; y < dstHeight; ++y) {
+            // A side that is already 1 texel wide reads the same texel twice
+            const int y0 = std::min(y * 2, srcHeight - 1);
+            const int y1 = std::min(y * 2 + 1, srcHeight - 1);
+
+            for (int x = 0; x < dstWidth; ++x) {
+                const int x0 = std::min(x * 2, srcWidth - 1);
+                const int x1 = std::min(x * 2 + 1, srcWidth - 1);
+
+                const unsigned char* texels[4] = {
+                    src + (static_cast<size_t>(y0) * srcWidth + x0) * channels,
+                    src + (static_cast<size_t>(y0) * srcWidth + x1) * channels,
+                    src + (static_cast<size_t>(y1) * srcWidth + x0) * channels,
+                    src + (static_cast<size_t>(y1) * srcWidth + x1) * channels
+                };
+                unsigned char* out = dst.data() + (static_cast<size_t>(y) * dstWidth + x) * channels;
+
+                for (int c = 0; c < channels; ++c) {
+                    if (c < colorChannels) {
+                        const float sum = tables.toLinear[texels[0][c]] + tables.toLinear[texels[1][c]]
+                                        + tables.toLinear[texels[2][c]] + tables.toLinear[texels[3][c]];
+                        out[c] = tables.fromLinear[static_cast<size_t>(std::lround(sum * 0.25f * 4095.0f))];
+                    }
+                    else {
+                        out[c] = static_cast<unsigned char>((texels[0][c] + texels[1][c] + texels[2][c] + texels[3][c] + 2) / 4);
+                    }
+                }
+            }
+        }
+    }
+}
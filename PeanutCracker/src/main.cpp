@@ -11,6 +11,7 @@
 #include "headers/gui.h"
 #include "headers/scene.h"
 #include "headers/assetManager.h"
+#include "headers/uploadContext.h"
 #include "headers/renderer.h"
 
 #include <glad/glad.h>
@@ -132,7 +133,10 @@ int main() {
 	stbi_set_flip_vertically_on_load(true);
 
 
-	auto assetManagerPtr = std::make_unique<AssetManager>();
+	// Shares objects with the main context, model textures and buffers get created there
+	UploadContext uploadContext(window);
+
+	auto assetManagerPtr = std::make_unique<AssetManager>(uploadContext);
 	Scene scene(assetManagerPtr.get());
 	GUI gui(window, "#version 330");
 	Renderer renderer(SCR_WIDTH, SCR_HEIGHT);
@@ -179,8 +183,12 @@ int main() {
 
 		// OBJECT LOADING QUEUE
 		scene.processLoadQueue();
+
+		// SKYBOX LOADING
+		scene.processSkyboxLoad();
 	}
 
+	uploadContext.shutdown();
 	glfwDestroyWindow(window);
 	glfwTerminate();
 	return 0;
@@ -5,28 +5,104 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 #include <iostream>
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 
 
+namespace {
+    int16_t packSnorm16(float value) {
+        return static_cast<int16_t>(std::round(glm::clamp(value, -1.0f, 1.0f) * 32767.0f));
+    }
 
-Mesh::Mesh(std::vector<Vertex> i_vertices, std::vector<unsigned int> i_indices, std::shared_ptr<Material> i_mat)
-    : vertices(i_vertices)
-    , indices(i_indices)
-    , material(i_mat)
+    // Maps the unit sphere onto the [-1, 1] square, the lower hemisphere folded over the corners.
+    // A zero vector (no normals / tangents in the source) comes out as +Z
+    glm::vec2 encodeOctahedral(const glm::vec3& v) {
+        const float l1 = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+        if (l1 < 1e-8f) return glm::vec2(0.0f);
+
+        glm::vec2 p = glm::vec2(v.x, v.y) / l1;
+        if (v.z < 0.0f) {
+            p = glm::vec2((1.0f - std::abs(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f),
+                          (1.0f - std::abs(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f));
+        }
+        return p;
+    }
+
+    // Layout of m_instanceVBO, see VertLayout::INSTANCE_MODEL / INSTANCE_NORMAL
+    struct InstanceData {
+        glm::mat4 transform;
+        glm::mat3 normalMatrix;
+    };
+
+    void linkInstanceAttributes(const VAO& vao, const VBO& instanceVBO) {
+        for (GLuint column = 0; column < 4; ++column) {
+            VertLayout::AttribData attrib = VertLayout::INSTANCE_MODEL;
+            attrib.layout += column;
+            vao.linkAttrib(instanceVBO, attrib, sizeof(InstanceData), (void*)(offsetof(InstanceData, transform) + column * sizeof(glm::vec4)));
+        }
+        for (GLuint column = 0; column < 3; ++column) {
+            VertLayout::AttribData attrib = VertLayout::INSTANCE_NORMAL;
+            attrib.layout += column;
+            vao.linkAttrib(instanceVBO, attrib, sizeof(InstanceData), (void*)(offsetof(InstanceData, normalMatrix) + column * sizeof(glm::vec3)));
+        }
+    }
+}
+
+
+Vertex Vertex::pack(const glm::vec3& position, const glm::vec3& normal, const glm::vec2& texCoords,
+                    const glm::vec3& tangent, const glm::vec3& bitangent) {
+    Vertex vertex{};
+    vertex.position = position;
+
+    const glm::vec2 n = encodeOctahedral(normal);
+    vertex.normal[0] = packSnorm16(n.x);
+    vertex.normal[1] = packSnorm16(n.y);
+
+    const glm::vec2 t = encodeOctahedral(tangent);
+    vertex.tangent[0] = packSnorm16(t.x);
+    vertex.tangent[1] = packSnorm16(t.y);
+    vertex.tangent[2] = glm::dot(glm::cross(normal, tangent), bitangent) < 0.0f ? packSnorm16(-1.0f) : packSnorm16(1.0f);
+
+    vertex.texCoords[0] = glm::packHalf1x16(texCoords.x);
+    vertex.texCoords[1] = glm::packHalf1x16(texCoords.y);
+    return vertex;
+}
+
+
+Mesh::Mesh(std::vector<glm::vec3> i_positions, std::vector<unsigned int> i_indices, std::vector<DrawRange> i_ranges, std::vector<MeshLod> i_lods,
+           std::vector<Meshlet> i_meshlets, const std::vector<glm::mat4>& i_instances, std::shared_ptr<Material> i_mat,
+           VBO&& i_VBO, VBO&& i_positionVBO, EBO&& i_EBO)
+    : positions(std::move(i_positions))
+    , indices(std::move(i_indices))
+    , material(std::move(i_mat))
+    , m_VBO(std::move(i_VBO))
+    , m_EBO(std::move(i_EBO))
+    , m_ranges(std::move(i_ranges))
+    , m_lods(std::move(i_lods))
+    , m_meshlets(std::move(i_meshlets))
+    , m_positionVBO(std::move(i_positionVBO))
 {
-    setupMesh();
+    setupInstances(i_instances);
+    linkAttributes();
 }
 
-// TODO: REMOVE isShadowPass
-void Mesh::draw(const Shader& shader, bool isShadowPass) const {
+void Mesh::draw(const Shader& shader, int lod, const MeshletView* view) const {
     material->bind(shader);
 
     // draw mesh
     m_VAO.bind();
-    glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
+    if (view && lod <= 0 && m_instanceCount == 1 && !m_meshlets.empty()) {
+        drawMeshlets(*view);
+    }
+    else {
+        drawRanges(lod);
+    }
     m_VAO.unbind();
 
     // setting the default texture back
@@ -34,18 +110,99 @@ void Mesh::draw(const Shader& shader, bool isShadowPass) const {
 
 }
 
-void Mesh::setupMesh() {
-    m_VAO.bind();
-    m_VBO.setData(vertices.data(), vertices.size());
-    m_EBO.setData(indices.data(),  indices.size());
+void Mesh::drawDepth(int lod) const {
+    m_depthVAO.bind();
+    drawRanges(lod);
+    m_depthVAO.unbind();
+}
 
-    m_VAO.linkAttrib(m_VBO, VertLayout::POS,     sizeof(Vertex), (void*)0);
-    m_VAO.linkAttrib(m_VBO, VertLayout::NORM,    sizeof(Vertex), (void*)offsetof(Vertex, normal));
-    m_VAO.linkAttrib(m_VBO, VertLayout::UV,      sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
-    m_VAO.linkAttrib(m_VBO, VertLayout::TAN,     sizeof(Vertex), (void*)offsetof(Vertex, tangent));
-    m_VAO.linkAttrib(m_VBO, VertLayout::BITAN,   sizeof(Vertex), (void*)offsetof(Vertex, bitangent));
-    m_VAO.linkAttrib(m_VBO, VertLayout::BONE_ID, sizeof(Vertex), (void*)offsetof(Vertex, m_boneIDs));
-    m_VAO.linkAttrib(m_VBO, VertLayout::BONE_W,  sizeof(Vertex), (void*)offsetof(Vertex, m_weights));
+// Expects one of the VAOs to be bound
+void Mesh::drawRanges(int lod) const {
+    if (m_lods.empty()) return;
 
-    m_VAO.unbind();
+    const GLenum   indexType = m_EBO.getIndexType();
+    const size_t   indexSize = m_EBO.getIndexSize();
+    const MeshLod& level     = getLod(lod);
+
+    for (uint32_t r = level.firstRange; r < level.firstRange + level.rangeCount; ++r) {
+        const DrawRange& range = m_ranges[r];
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(range.indexCount), indexType,
+                                          (void*)(static_cast<size_t>(range.firstIndex) * indexSize), m_instanceCount, range.baseVertex);
+    }
+}
+
+// Visible meshlets next to each other in the same range become one draw
+void Mesh::drawMeshlets(const MeshletView& view) const {
+    // Rebuilt for every draw, only the main thread draws so one set of scratch arrays does
+    static std::vector<uint8_t>     visible;
+    static std::vector<GLsizei>     counts;
+    static std::vector<const void*> offsets;
+    static std::vector<GLint>       baseVertices;
+
+    if (m_meshlets.cull(view, visible) == 0) return;
+
+    const GLenum indexType = m_EBO.getIndexType();
+    const size_t indexSize = m_EBO.getIndexSize();
+
+    counts.clear();
+    offsets.clear();
+    baseVertices.clear();
+
+    uint32_t nextIndex = UINT32_MAX;
+    uint32_t lastRange = UINT32_MAX;
+    for (size_t i = 0; i < m_meshlets.size(); ++i) {
+        if (!visible[i]) continue;
+
+        const Meshlet& meshlet = m_meshlets[i];
+        if (meshlet.firstIndex == nextIndex && meshlet.range == lastRange) {
+            counts.back() += static_cast<GLsizei>(meshlet.indexCount);
+        }
+        else {
+            counts.push_back(static_cast<GLsizei>(meshlet.indexCount));
+            offsets.push_back((void*)(static_cast<size_t>(meshlet.firstIndex) * indexSize));
+            baseVertices.push_back(m_ranges[meshlet.range].baseVertex);
+        }
+
+        nextIndex = meshlet.firstIndex + meshlet.indexCount;
+        lastRange = meshlet.range;
+    }
+
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), indexType, offsets.data(), static_cast<GLsizei>(counts.size()), baseVertices.data());
+}
+
+// Normal matrices are worked out here so the shaders don't invert a matrix per vertex
+void Mesh::setupInstances(const std::vector<glm::mat4>& transforms) {
+    std::vector<InstanceData> instances;
+    instances.reserve(std::max<size_t>(transforms.size(), 1));
+    m_maxInstanceScale = 0.0f;
+    for (const glm::mat4& transform : transforms) {
+        instances.push_back({ transform, glm::transpose(glm::inverse(glm::mat3(transform))) });
+        m_maxInstanceScale = std::max({ m_maxInstanceScale, glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])),
+                                        glm::length(glm::vec3(transform[2])) });
+    }
+    if (instances.empty()) {
+        instances.push_back({ glm::mat4(1.0f), glm::mat3(1.0f) });
+        m_maxInstanceScale = 1.0f;
+    }
+
+    m_instanceVBO.setData(instances.data(), instances.size());
+    m_instanceVBO.unbind();
+    m_instanceCount = static_cast<int>(instances.size());
+}
+
+// Both VAOs share the index buffer and the instance stream
+void Mesh::linkAttributes() const {
+    m_VAO.bind();
+    m_EBO.bind();
+    m_VAO.linkAttrib(m_VBO, VertLayout::POS,      sizeof(Vertex), (void*)0);
+    m_VAO.linkAttrib(m_VBO, VertLayout::NORM_OCT, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+    m_VAO.linkAttrib(m_VBO, VertLayout::UV_HALF,  sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
+    m_VAO.linkAttrib(m_VBO, VertLayout::TAN_OCT,  sizeof(Vertex), (void*)offsetof(Vertex, tangent));
+    linkInstanceAttributes(m_VAO, m_instanceVBO);
+
+    m_depthVAO.bind();
+    m_EBO.bind();
+    m_depthVAO.linkAttrib(m_positionVBO, VertLayout::POS, sizeof(glm::vec3), (void*)0);
+    linkInstanceAttributes(m_depthVAO, m_instanceVBO);
+    m_depthVAO.unbind();
 }
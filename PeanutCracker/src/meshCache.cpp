@@ -0,0 +1,435 @@
+#include "headers/meshCache.h"
+#include "headers/iblCache.h"
+#include "headers/mappedFile.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+
+
+namespace {
+    constexpr char     MESH_MAGIC[8]      = { 'P', 'C', 'M', 'S', 'H', '0', '1', '\n' };
+    constexpr uint64_t MESH_CACHE_VERSION = 10;      // Bump when Vertex or the import changes
+    constexpr uint64_t BLOB_ALIGNMENT     = 16;
+
+    constexpr uint32_t MAX_MATERIALS      = 4096;
+    constexpr uint32_t MAX_MESHES         = 65536;
+    constexpr uint32_t MAX_STRING         = 4096;
+    constexpr uint32_t MAX_RANGES         = 4096;
+    constexpr uint32_t MAX_LODS           = 16;
+    constexpr uint32_t MAX_INSTANCES      = 1u << 20;
+    constexpr uint32_t MAX_DEPENDENCIES   = 1024;
+
+    struct SourceStamp {
+        int64_t  time = 0;
+        uint64_t size = 0;
+    };
+
+    bool getSourceStamp(const std::filesystem::path& source, SourceStamp& stamp) {
+        std::error_code ec;
+        const auto time = std::filesystem::last_write_time(source, ec);
+        if (ec) return false;
+        const auto size = std::filesystem::file_size(source, ec);
+        if (ec) return false;
+
+        stamp.time = static_cast<int64_t>(time.time_since_epoch().count());
+        stamp.size = static_cast<uint64_t>(size);
+        return true;
+    }
+
+    bool isStampCurrent(const std::filesystem::path& file, const SourceStamp& stamp) {
+        SourceStamp current;
+        return getSourceStamp(file, current) && current.time == stamp.time && current.size == stamp.size;
+    }
+
+    template <typename T>
+    void writePOD(std::ofstream& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void writeString(std::ofstream& out, const std::string& str) {
+        writePOD(out, static_cast<uint32_t>(str.size()));
+        out.write(str.data(), str.size());
+    }
+
+    void writePadding(std::ofstream& out) {
+        static const char zeros[BLOB_ALIGNMENT] = {};
+        const uint64_t offset = static_cast<uint64_t>(out.tellp());
+        out.write(zeros, (BLOB_ALIGNMENT - offset % BLOB_ALIGNMENT) % BLOB_ALIGNMENT);
+    }
+
+    // Bounds checked cursor over the mapping
+    struct MappedReader {
+        const unsigned char* data   = nullptr;
+        size_t               size   = 0;
+        size_t               offset = 0;
+
+        template <typename T>
+        bool read(T& value) {
+            if (size - offset < sizeof(T)) return false;
+            std::memcpy(&value, data + offset, sizeof(T));
+            offset += sizeof(T);
+            return true;
+        }
+
+        bool readString(std::string& str) {
+            uint32_t length = 0;
+            if (!read(length) || length > MAX_STRING || size - offset < length) return false;
+            str.assign(reinterpret_cast<const char*>(data + offset), length);
+            offset += length;
+            return true;
+        }
+
+        bool readPath(std::filesystem::path& path) {
+            std::string str;
+            if (!readString(str)) return false;
+            path = std::filesystem::u8path(str);
+            return true;
+        }
+
+        bool readVec3(glm::vec3& v) { return read(v.x) && read(v.y) && read(v.z); }
+
+        // The blob has to lie inside the file and be aligned for its element type
+        bool isBlobValid(uint64_t blobOffset, uint64_t count, size_t elementSize) const {
+            return blobOffset % BLOB_ALIGNMENT == 0 && blobOffset <= size &&
+                   count <= (size - blobOffset) / elementSize;
+        }
+    };
+
+    void writeVec3(std::ofstream& out, const glm::vec3& v) {
+        writePOD(out, v.x);
+        writePOD(out, v.y);
+        writePOD(out, v.z);
+    }
+}
+
+
+MeshCache::MeshCache(const std::filesystem::path& i_dir) : m_dir(i_dir) {}
+
+uint64_t MeshCache::getKey(const std::filesystem::path& source, const LodSettings& lodSettings) {
+    std::error_code ec;
+    std::filesystem::path absolute = std::filesystem::absolute(source, ec);
+    if (ec) absolute = source;
+
+    uint64_t key = IBLCache::hashString(absolute.lexically_normal().generic_u8string());
+    key = IBLCache::hashCombine(key, MESH_CACHE_VERSION);
+    key = IBLCache::hashCombine(key, sizeof(Vertex));
+    key = IBLCache::hashCombine(key, lodSettings.getKey());
+    return key;
+}
+
+std::filesystem::path MeshCache::getEntryPath(const std::filesystem::path& source, const LodSettings& lodSettings) const {
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << getKey(source, lodSettings) << ".pcmesh";
+    return m_dir / name.str();
+}
+
+
+// --LOADING
+bool MeshCache::load(const std::filesystem::path& source, const LodSettings& lodSettings, ModelData& data) const {
+    SourceStamp stamp;
+    if (!getSourceStamp(source, stamp)) return false;
+
+    const std::filesystem::path path = getEntryPath(source, lodSettings);
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) return false;
+
+    auto mapping = std::make_shared<MappedFile>();
+    if (!mapping->open(path)) return false;
+
+    MappedReader in{ mapping->getData(), mapping->getSize() };
+
+    char        magic[8];
+    uint64_t    fileKey      = 0;
+    SourceStamp fileStamp;
+    uint32_t    vertexStride = 0;
+    AABB        aabb;
+    uint32_t    materialCount = 0;
+    uint32_t    meshCount     = 0;
+    if (!in.read(magic) || std::memcmp(magic, MESH_MAGIC, sizeof(magic)) != 0 ||
+        !in.read(fileKey) || fileKey != getKey(source, lodSettings) ||
+        !in.read(fileStamp.time) || !in.read(fileStamp.size) ||
+        !in.read(vertexStride) || vertexStride != sizeof(Vertex) ||
+        !in.readVec3(aabb.min) || !in.readVec3(aabb.max) ||
+        !in.read(materialCount) || materialCount > MAX_MATERIALS ||
+        !in.read(meshCount) || meshCount > MAX_MESHES) {
+        std::cerr << "[MESH CACHE] Bad header, ignoring " << path << '\n';
+        return false;
+    }
+
+    // Source edited since it was cooked
+    if (fileStamp.time != stamp.time || fileStamp.size != stamp.size) return false;
+
+    ModelData result;
+    result.directory = source.parent_path().string();
+    result.aabb      = aabb;
+
+    uint32_t dependencyCount = 0;
+    if (!in.read(dependencyCount) || dependencyCount > MAX_DEPENDENCIES) {
+        std::cerr << "[MESH CACHE] Bad dependency table, ignoring " << path << '\n';
+        return false;
+    }
+
+    // Same for the buffers and material libraries the import read
+    result.dependencies.resize(dependencyCount);
+    for (std::filesystem::path& dependency : result.dependencies) {
+        SourceStamp dependencyStamp;
+        if (!in.readPath(dependency) || !in.read(dependencyStamp.time) || !in.read(dependencyStamp.size)) {
+            std::cerr << "[MESH CACHE] Bad dependency table, ignoring " << path << '\n';
+            return false;
+        }
+        if (!isStampCurrent(dependency, dependencyStamp)) return false;
+    }
+
+    result.materials.resize(materialCount);
+    for (MaterialDesc& material : result.materials) {
+        if (!in.readString(material.name) ||
+            !in.readPath(material.albedoPath) || !in.readPath(material.normalPath) ||
+            !in.readPath(material.metallicPath) || !in.readPath(material.roughnessPath) || !in.readPath(material.ormPath) ||
+            !in.read(material.baseColor.r) || !in.read(material.baseColor.g) ||
+            !in.read(material.baseColor.b) || !in.read(material.baseColor.a) ||
+            !in.read(material.metallic) || !in.read(material.roughness)) {
+            std::cerr << "[MESH CACHE] Bad material table, ignoring " << path << '\n';
+            return false;
+        }
+    }
+
+    result.meshes.resize(meshCount);
+    for (MeshData& mesh : result.meshes) {
+        uint32_t vertexCount    = 0;
+        uint32_t indexCount     = 0;
+        uint32_t indexSize      = 0;
+        uint32_t rangeCount     = 0;
+        uint64_t vertexOffset   = 0;
+        uint64_t positionOffset = 0;
+        uint64_t indexOffset    = 0;
+        if (!in.read(mesh.materialIndex) || !in.read(vertexCount) || !in.read(indexCount) || !in.read(indexSize) ||
+            !in.readVec3(mesh.bounds.min) || !in.readVec3(mesh.bounds.max) ||
+            !in.read(rangeCount) || rangeCount > MAX_RANGES ||
+            mesh.materialIndex >= materialCount || (indexSize != 2 && indexSize != 4)) {
+            std::cerr << "[MESH CACHE] Bad mesh table, ignoring " << path << '\n';
+            return false;
+        }
+
+        mesh.ranges.resize(rangeCount);
+        for (DrawRange& range : mesh.ranges) {
+            if (!in.read(range.firstIndex) || !in.read(range.indexCount) || !in.read(range.baseVertex) ||
+                range.firstIndex > indexCount || range.indexCount > indexCount - range.firstIndex ||
+                range.baseVertex < 0 || static_cast<uint32_t>(range.baseVertex) > vertexCount) {
+                std::cerr << "[MESH CACHE] Bad draw range, ignoring " << path << '\n';
+                return false;
+            }
+        }
+
+        uint32_t lodCount = 0;
+        if (!in.read(lodCount) || lodCount == 0 || lodCount > MAX_LODS) {
+            std::cerr << "[MESH CACHE] Bad LOD table, ignoring " << path << '\n';
+            return false;
+        }
+
+        mesh.lods.resize(lodCount);
+        for (MeshLod& lod : mesh.lods) {
+            if (!in.read(lod.firstIndex) || !in.read(lod.indexCount) || !in.read(lod.firstRange) || !in.read(lod.rangeCount) || !in.read(lod.error) ||
+                lod.firstIndex > indexCount || lod.indexCount > indexCount - lod.firstIndex ||
+                lod.firstRange > rangeCount || lod.rangeCount > rangeCount - lod.firstRange) {
+                std::cerr << "[MESH CACHE] Bad LOD table, ignoring " << path << '\n';
+                return false;
+            }
+        }
+
+        uint32_t meshletCount = 0;
+        if (!in.read(meshletCount) || meshletCount > indexCount / 3) {
+            std::cerr << "[MESH CACHE] Bad meshlet table, ignoring " << path << '\n';
+            return false;
+        }
+
+        mesh.meshlets.resize(meshletCount);
+        for (Meshlet& meshlet : mesh.meshlets) {
+            if (!in.read(meshlet) || meshlet.range >= rangeCount ||
+                meshlet.firstIndex > indexCount || meshlet.indexCount > indexCount - meshlet.firstIndex) {
+                std::cerr << "[MESH CACHE] Bad meshlet table, ignoring " << path << '\n';
+                return false;
+            }
+        }
+
+        uint32_t instanceCount = 0;
+        if (!in.read(instanceCount) || instanceCount == 0 || instanceCount > MAX_INSTANCES) {
+            std::cerr << "[MESH CACHE] Bad instance table, ignoring " << path << '\n';
+            return false;
+        }
+
+        mesh.instances.resize(instanceCount);
+        for (glm::mat4& instance : mesh.instances) {
+            if (!in.read(instance)) {
+                std::cerr << "[MESH CACHE] Bad instance table, ignoring " << path << '\n';
+                return false;
+            }
+        }
+
+        if (!in.read(vertexOffset) || !in.read(positionOffset) || !in.read(indexOffset) ||
+            !in.isBlobValid(vertexOffset, vertexCount, sizeof(Vertex)) ||
+            !in.isBlobValid(positionOffset, vertexCount, sizeof(glm::vec3)) ||
+            !in.isBlobValid(indexOffset, indexCount, indexSize)) {
+            std::cerr << "[MESH CACHE] Bad mesh table, ignoring " << path << '\n';
+            return false;
+        }
+
+        mesh.vertexCount     = vertexCount;
+        mesh.indexCount      = indexCount;
+        mesh.indexType       = indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        mesh.mappedVertices  = reinterpret_cast<const Vertex*>(in.data + vertexOffset);
+        mesh.mappedPositions = reinterpret_cast<const glm::vec3*>(in.data + positionOffset);
+        mesh.mappedIndices   = in.data + indexOffset;
+    }
+
+    result.mapping = std::move(mapping);
+    result.isValid = true;
+    data = std::move(result);
+
+    std::cout << "[MESH CACHE] Hit " << path.filename() << '\n';
+    return true;
+}
+
+
+// --STORING
+// Written to a temp file first so an interrupted write never leaves a half entry behind.
+// The mesh table is written twice, the blob offsets are only known once the blobs are out
+bool MeshCache::store(const std::filesystem::path& source, const LodSettings& lodSettings, const ModelData& data) const {
+    SourceStamp stamp;
+    if (!data.isValid || !getSourceStamp(source, stamp)) return false;
+
+    std::vector<SourceStamp> dependencyStamps(data.dependencies.size());
+    for (size_t i = 0; i < data.dependencies.size(); ++i) {
+        if (!getSourceStamp(data.dependencies[i], dependencyStamps[i])) return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(m_dir, ec);
+    if (ec) {
+        std::cerr << "[MESH CACHE] Can't create " << m_dir << ": " << ec.message() << '\n';
+        return false;
+    }
+
+    const std::filesystem::path path    = getEntryPath(source, lodSettings);
+    std::filesystem::path       tmpPath = path;
+    tmpPath += ".tmp";
+
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "[MESH CACHE] Can't write " << tmpPath << '\n';
+            return false;
+        }
+
+        out.write(MESH_MAGIC, sizeof(MESH_MAGIC));
+        writePOD(out, getKey(source, lodSettings));
+        writePOD(out, stamp.time);
+        writePOD(out, stamp.size);
+        writePOD(out, static_cast<uint32_t>(sizeof(Vertex)));
+        writeVec3(out, data.aabb.min);
+        writeVec3(out, data.aabb.max);
+        writePOD(out, static_cast<uint32_t>(data.materials.size()));
+        writePOD(out, static_cast<uint32_t>(data.meshes.size()));
+
+        writePOD(out, static_cast<uint32_t>(data.dependencies.size()));
+        for (size_t i = 0; i < data.dependencies.size(); ++i) {
+            writeString(out, data.dependencies[i].u8string());
+            writePOD(out, dependencyStamps[i].time);
+            writePOD(out, dependencyStamps[i].size);
+        }
+
+        for (const MaterialDesc& material : data.materials) {
+            writeString(out, material.name);
+            for (const std::filesystem::path* texPath : { &material.albedoPath, &material.normalPath, &material.metallicPath, &material.roughnessPath, &material.ormPath }) {
+                writeString(out, texPath->u8string());
+            }
+            writePOD(out, material.baseColor.r);
+            writePOD(out, material.baseColor.g);
+            writePOD(out, material.baseColor.b);
+            writePOD(out, material.baseColor.a);
+            writePOD(out, material.metallic);
+            writePOD(out, material.roughness);
+        }
+
+        std::vector<uint64_t> vertexOffsets(data.meshes.size(), 0);
+        std::vector<uint64_t> positionOffsets(data.meshes.size(), 0);
+        std::vector<uint64_t> indexOffsets(data.meshes.size(), 0);
+
+        auto writeMeshTable = [&]() {
+            for (size_t i = 0; i < data.meshes.size(); ++i) {
+                const MeshData& mesh = data.meshes[i];
+                writePOD(out, static_cast<uint32_t>(mesh.materialIndex));
+                writePOD(out, static_cast<uint32_t>(mesh.vertexCount));
+                writePOD(out, static_cast<uint32_t>(mesh.indexCount));
+                writePOD(out, static_cast<uint32_t>(EBO::getIndexSize(mesh.indexType)));
+                writeVec3(out, mesh.bounds.min);
+                writeVec3(out, mesh.bounds.max);
+                writePOD(out, static_cast<uint32_t>(mesh.ranges.size()));
+                for (const DrawRange& range : mesh.ranges) {
+                    writePOD(out, range.firstIndex);
+                    writePOD(out, range.indexCount);
+                    writePOD(out, range.baseVertex);
+                }
+                writePOD(out, static_cast<uint32_t>(mesh.lods.size()));
+                for (const MeshLod& lod : mesh.lods) {
+                    writePOD(out, lod.firstIndex);
+                    writePOD(out, lod.indexCount);
+                    writePOD(out, lod.firstRange);
+                    writePOD(out, lod.rangeCount);
+                    writePOD(out, lod.error);
+                }
+                writePOD(out, static_cast<uint32_t>(mesh.meshlets.size()));
+                for (const Meshlet& meshlet : mesh.meshlets) {
+                    writePOD(out, meshlet);
+                }
+                writePOD(out, static_cast<uint32_t>(mesh.instances.size()));
+                for (const glm::mat4& instance : mesh.instances) {
+                    writePOD(out, instance);
+                }
+                writePOD(out, vertexOffsets[i]);
+                writePOD(out, positionOffsets[i]);
+                writePOD(out, indexOffsets[i]);
+            }
+        };
+
+        const std::streampos tableStart = out.tellp();
+        writeMeshTable();
+
+        for (size_t i = 0; i < data.meshes.size(); ++i) {
+            const MeshData& mesh = data.meshes[i];
+
+            writePadding(out);
+            vertexOffsets[i] = static_cast<uint64_t>(out.tellp());
+            out.write(reinterpret_cast<const char*>(mesh.getVertexData()), mesh.vertexCount * sizeof(Vertex));
+
+            writePadding(out);
+            positionOffsets[i] = static_cast<uint64_t>(out.tellp());
+            out.write(reinterpret_cast<const char*>(mesh.getPositionData()), mesh.vertexCount * sizeof(glm::vec3));
+
+            writePadding(out);
+            indexOffsets[i] = static_cast<uint64_t>(out.tellp());
+            out.write(reinterpret_cast<const char*>(mesh.getIndexData()), mesh.indexCount * EBO::getIndexSize(mesh.indexType));
+        }
+
+        out.seekp(tableStart);
+        writeMeshTable();
+
+        if (!out) {
+            std::cerr << "[MESH CACHE] Write failed for " << tmpPath << '\n';
+            out.close();
+            std::filesystem::remove(tmpPath, ec);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec) {
+        std::filesystem::remove(tmpPath, ec);
+        return false;
+    }
+
+    std::cout << "[MESH CACHE] Stored " << path.filename() << '\n';
+    return true;
+}
@@ -0,0 +1,553 @@
+#include "headers/meshOptimizer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <unordered_map>
+
+
+namespace {
+    constexpr unsigned int NO_VERTEX = ~0u;
+
+    // Triangles around each vertex, flattened: the triangles of v are [offsets[v], offsets[v + 1])
+    struct Adjacency {
+        std::vector<unsigned int> offsets;
+        std::vector<unsigned int> triangles;
+
+        Adjacency(const std::vector<unsigned int>& indices, size_t vertexCount) : offsets(vertexCount + 1, 0) {
+            for (unsigned int index : indices) {
+                ++offsets[index + 1];
+            }
+            std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+            triangles.resize(indices.size());
+            std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); ++i) {
+                triangles[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+            }
+        }
+    };
+
+    // Small FIFO with a cheap "is v in it" check, shared by the stats and the overdraw splitter
+    class FifoCache {
+    public:
+        FifoCache(size_t vertexCount, unsigned int cacheSize) : m_stamps(vertexCount, 0), m_cacheSize(cacheSize) {}
+
+        // Returns true on a miss
+        bool touch(unsigned int v) {
+            if (m_stamps[v] != 0 && m_time - m_stamps[v] < m_cacheSize) return false;
+            m_stamps[v] = ++m_time;
+            return true;
+        }
+
+        void reset() { m_time += m_cacheSize; }
+
+    private:
+        std::vector<unsigned int> m_stamps;     // Miss count when v last entered, 0 = never
+        unsigned int              m_time = 0;
+        unsigned int              m_cacheSize;
+    };
+
+    // Symmetric 4x4 error quadric, the plane terms of every triangle around a vertex.
+    // weight is the sum of the plane weights, dividing by it keeps evaluate() a squared distance
+    struct Quadric {
+        double a2 = 0.0, b2 = 0.0, c2 = 0.0, d2 = 0.0;
+        double ab = 0.0, ac = 0.0, ad = 0.0, bc = 0.0, bd = 0.0, cd = 0.0;
+        double weight = 0.0;
+
+        static Quadric fromPlane(const glm::vec3& n, float d, float planeWeight) {
+            const double a = n.x, b = n.y, c = n.z, w = planeWeight;
+            Quadric q;
+            q.a2 = a * a * w; q.b2 = b * b * w; q.c2 = c * c * w; q.d2 = d * d * w;
+            q.ab = a * b * w; q.ac = a * c * w; q.ad = a * d * w;
+            q.bc = b * c * w; q.bd = b * d * w; q.cd = c * d * w;
+            q.weight = w;
+            return q;
+        }
+
+        Quadric& operator+=(const Quadric& o) {
+            a2 += o.a2; b2 += o.b2; c2 += o.c2; d2 += o.d2;
+            ab += o.ab; ac += o.ac; ad += o.ad; bc += o.bc; bd += o.bd; cd += o.cd;
+            weight += o.weight;
+            return *this;
+        }
+
+        // Weighted mean of the squared distances from p to the planes
+        double evaluate(const glm::vec3& p) const {
+            if (weight <= 0.0) return 0.0;
+
+            const double x = p.x, y = p.y, z = p.z;
+            const double sum = a2 * x * x + b2 * y * y + c2 * z * z + 2.0 * (ab * x * y + ac * x * z + bc * y * z)
+                             + 2.0 * (ad * x + bd * y + cd * z) + d2;
+            return sum / weight;
+        }
+    };
+
+    struct Collapse {
+        unsigned int from;
+        unsigned int to;
+        double       cost;
+    };
+
+    uint64_t edgeKey(unsigned int a, unsigned int b) {
+        return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+    }
+}
+
+
+VertexCacheStats MeshOptimizer::analyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize) {
+    VertexCacheStats stats;
+    stats.triangles = indices.size() / 3;
+
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<bool> seen(vertexCount, false);
+    for (unsigned int index : indices) {
+        if (cache.touch(index)) ++stats.transformed;
+        if (!seen[index]) {
+            seen[index] = true;
+            ++stats.vertices;
+        }
+    }
+    return stats;
+}
+
+
+// --VERTEX CACHE
+std::vector<unsigned int> MeshOptimizer::optimizeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount,
+                                                             std::vector<size_t>* clusterStarts, unsigned int cacheSize) {
+    const size_t triangleCount = indices.size() / 3;
+    std::vector<unsigned int> result;
+    result.reserve(triangleCount * 3);
+    if (clusterStarts) clusterStarts->clear();
+    if (triangleCount == 0) return result;
+
+    const Adjacency adjacency(indices, vertexCount);
+
+    std::vector<unsigned int> liveTriangles(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+    }
+
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    std::vector<bool>         isEmitted(triangleCount, false);
+    std::vector<unsigned int> deadEnds;
+    std::vector<unsigned int> candidates;
+
+    unsigned int time   = cacheSize + 1;
+    unsigned int cursor = 0;            // Scan position for when the dead end stack runs dry
+
+    // The fanning vertex comes from the candidates while possible, a jump anywhere else starts a new cluster
+    while (cursor < vertexCount && liveTriangles[cursor] == 0) ++cursor;
+    unsigned int fanning = cursor < vertexCount ? cursor : NO_VERTEX;
+    bool         isJump  = true;
+
+    while (fanning != NO_VERTEX) {
+        if (isJump && clusterStarts) clusterStarts->push_back(result.size() / 3);
+
+        candidates.clear();
+        for (unsigned int a = adjacency.offsets[fanning]; a < adjacency.offsets[fanning + 1]; ++a) {
+            const unsigned int triangle = adjacency.triangles[a];
+            if (isEmitted[triangle]) continue;
+
+            for (int k = 0; k < 3; ++k) {
+                const unsigned int v = indices[triangle * 3 + k];
+                result.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                --liveTriangles[v];
+
+                if (time - cacheTime[v] > cacheSize) {
+                    cacheTime[v] = time++;
+                }
+            }
+            isEmitted[triangle] = true;
+        }
+
+        // Best candidate: still has live triangles and will still be in the cache after emitting them,
+        // preferring the one that has been in the cache longest
+        unsigned int next     = NO_VERTEX;
+        int          bestScore = -1;
+        for (unsigned int v : candidates) {
+            if (liveTriangles[v] == 0) continue;
+
+            int score = 0;
+            if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize) {
+                score = static_cast<int>(time - cacheTime[v]);
+            }
+            if (score > bestScore) {
+                bestScore = score;
+                next      = v;
+            }
+        }
+
+        isJump = next == NO_VERTEX;
+        if (isJump) {
+            while (!deadEnds.empty() && next == NO_VERTEX) {
+                const unsigned int v = deadEnds.back();
+                deadEnds.pop_back();
+                if (liveTriangles[v] > 0) next = v;
+            }
+            while (next == NO_VERTEX && cursor < vertexCount) {
+                if (liveTriangles[cursor] > 0) next = cursor;
+                ++cursor;
+            }
+        }
+
+        fanning = next;
+    }
+
+    return result;
+}
+
+
+// --OVERDRAW
+void MeshOptimizer::optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions,
+                                     const std::vector<size_t>& clusterStarts, float threshold) {
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || clusterStarts.empty()) return;
+
+    // Soft splits: end a cluster wherever its own ACMR has come down to the mesh's
+    const float meshACMR = analyzeVertexCache(indices, positions.size()).getACMR();
+
+    std::vector<size_t> starts;
+    FifoCache cache(positions.size(), CACHE_SIZE);
+    size_t hardIndex    = 0;
+    size_t clusterBegin = 0;
+    size_t misses       = 0;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        const bool isHard = hardIndex < clusterStarts.size() && clusterStarts[hardIndex] == t;
+        if (isHard) ++hardIndex;
+
+        const bool isSoft = t > clusterBegin && static_cast<float>(misses) <= threshold * meshACMR * static_cast<float>(t - clusterBegin);
+        if (isHard || isSoft || t == 0) {
+            starts.push_back(t);
+            clusterBegin = t;
+            misses       = 0;
+            cache.reset();
+        }
+
+        for (int k = 0; k < 3; ++k) {
+            if (cache.touch(indices[t * 3 + k])) ++misses;
+        }
+    }
+    starts.push_back(triangleCount);
+
+    // Area weighted centroid of the whole mesh, then each cluster's centroid and summed normal
+    glm::vec3 meshCentroid(0.0f);
+    float     meshArea = 0.0f;
+
+    struct Cluster {
+        size_t    begin;
+        size_t    end;
+        glm::vec3 centroid = glm::vec3(0.0f);
+        glm::vec3 normal   = glm::vec3(0.0f);
+        float     area     = 0.0f;
+        float     key      = 0.0f;
+    };
+    std::vector<Cluster> clusters;
+    clusters.reserve(starts.size() - 1);
+
+    for (size_t c = 0; c + 1 < starts.size(); ++c) {
+        Cluster cluster{ starts[c], starts[c + 1] };
+        for (size_t t = cluster.begin; t < cluster.end; ++t) {
+            const glm::vec3& p0 = positions[indices[t * 3 + 0]];
+            const glm::vec3& p1 = positions[indices[t * 3 + 1]];
+            const glm::vec3& p2 = positions[indices[t * 3 + 2]];
+
+            const glm::vec3 n    = glm::cross(p1 - p0, p2 - p0);     // Length = 2 * area
+            const float     area = glm::length(n) * 0.5f;
+            cluster.centroid += (p0 + p1 + p2) * (area / 3.0f);
+            cluster.normal   += n;
+            cluster.area     += area;
+        }
+
+        meshCentroid += cluster.centroid;
+        meshArea     += cluster.area;
+        if (cluster.area > 0.0f) cluster.centroid /= cluster.area;
+        clusters.push_back(cluster);
+    }
+    if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+    // Clusters facing away from the centre are the likely occluders, draw them first
+    for (Cluster& cluster : clusters) {
+        const float length = glm::length(cluster.normal);
+        cluster.key = length > 0.0f ? glm::dot(cluster.centroid - meshCentroid, cluster.normal / length) : 0.0f;
+    }
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.key > b.key; });
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (const Cluster& cluster : clusters) {
+        result.insert(result.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+    }
+    indices = std::move(result);
+}
+
+
+// --VERTEX FETCH
+std::vector<unsigned int> MeshOptimizer::optimizeVertexFetch(std::vector<unsigned int>& indices, size_t vertexCount) {
+    std::vector<unsigned int> remap(vertexCount, NO_VERTEX);
+    unsigned int next = 0;
+
+    for (unsigned int& index : indices) {
+        if (remap[index] == NO_VERTEX) remap[index] = next++;
+        index = remap[index];
+    }
+
+    for (unsigned int& target : remap) {
+        if (target == NO_VERTEX) target = next++;
+    }
+    return remap;
+}
+
+
+// --SIMPLIFICATION
+std::vector<unsigned int> MeshOptimizer::simplify(const std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions,
+                                                  size_t targetIndexCount, float targetError, float* resultError) {
+    const size_t vertexCount = positions.size();
+    std::vector<unsigned int> result(indices);
+    if (resultError) *resultError = 0.0f;
+    if (result.size() % 3 != 0 || result.size() <= targetIndexCount) return result;
+
+    // Vertices that can't move: on an open border, or sharing a position with another vertex (a UV or
+    // normal seam, collapsing one side would tear it open)
+    std::vector<bool> isLocked(vertexCount, false);
+    {
+        struct PositionHash {
+            size_t operator()(const glm::vec3& p) const {
+                const uint32_t* bits = reinterpret_cast<const uint32_t*>(&p.x);
+                return (size_t(bits[0]) * 73856093u) ^ (size_t(bits[1]) * 19349663u) ^ (size_t(bits[2]) * 83492791u);
+            }
+        };
+        struct PositionEqual {
+            bool operator()(const glm::vec3& a, const glm::vec3& b) const { return a.x == b.x && a.y == b.y && a.z == b.z; }
+        };
+
+        std::unordered_map<glm::vec3, unsigned int, PositionHash, PositionEqual> firstAt;
+        firstAt.reserve(vertexCount);
+        for (unsigned int v = 0; v < vertexCount; ++v) {
+            auto [it, isNew] = firstAt.try_emplace(positions[v], v);
+            if (!isNew) {
+                isLocked[v]          = true;
+                isLocked[it->second] = true;
+            }
+        }
+
+        std::unordered_map<uint64_t, unsigned int> edgeUses;
+        edgeUses.reserve(result.size());
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (int k = 0; k < 3; ++k) {
+                ++edgeUses[edgeKey(result[i + k], result[i + (k + 1) % 3])];
+            }
+        }
+        for (const auto& [key, uses] : edgeUses) {
+            if (uses != 1) continue;
+            isLocked[static_cast<unsigned int>(key >> 32)]         = true;
+            isLocked[static_cast<unsigned int>(key & 0xFFFFFFFFu)] = true;
+        }
+    }
+
+    // Area weighted, so big flat regions count for more than slivers in a vertex's mean error
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < result.size(); i += 3) {
+        const glm::vec3& p0 = positions[result[i + 0]];
+        const glm::vec3& p1 = positions[result[i + 1]];
+        const glm::vec3& p2 = positions[result[i + 2]];
+
+        const glm::vec3 n      = glm::cross(p1 - p0, p2 - p0);
+        const float     length = glm::length(n);
+        if (length <= 0.0f) continue;
+
+        const glm::vec3 normal = n / length;
+        const Quadric   q      = Quadric::fromPlane(normal, -glm::dot(normal, p0), length * 0.5f);
+        for (int k = 0; k < 3; ++k) {
+            quadrics[result[i + k]] += q;
+        }
+    }
+
+    const double maxCost  = static_cast<double>(targetError) * static_cast<double>(targetError);
+    float        maxError = 0.0f;
+
+    std::vector<Collapse>     collapses;
+    std::vector<unsigned int> remap(vertexCount);
+    std::vector<bool>         isTouched(vertexCount);
+
+    // Each pass collapses a set of independent edges cheapest first, then rebuilds the triangle list
+    while (result.size() > targetIndexCount) {
+        const Adjacency adjacency(result, vertexCount);
+
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (int k = 0; k < 3; ++k) {
+                const unsigned int a = result[i + k];
+                const unsigned int b = result[i + (k + 1) % 3];
+                if (!isLocked[a]) {
+                    Quadric q = quadrics[a];
+                    q += quadrics[b];
+                    collapses.push_back({ a, b, q.evaluate(positions[b]) });
+                }
+                if (!isLocked[b]) {
+                    Quadric q = quadrics[b];
+                    q += quadrics[a];
+                    collapses.push_back({ b, a, q.evaluate(positions[a]) });
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+        std::iota(remap.begin(), remap.end(), 0u);
+        std::fill(isTouched.begin(), isTouched.end(), false);
+
+        const size_t targetTriangles = targetIndexCount / 3;
+        size_t       triangleCount   = result.size() / 3;
+        size_t       collapsed       = 0;
+
+        for (const Collapse& collapse : collapses) {
+            if (collapse.cost > maxCost || triangleCount <= targetTriangles) break;
+            if (isTouched[collapse.from] || isTouched[collapse.to]) continue;
+
+            // Reject collapses that would flip a triangle around the moving vertex or fold it past ~75 degrees
+            const glm::vec3& target = positions[collapse.to];
+            bool   isFlipping = false;
+            size_t removed    = 0;
+            for (unsigned int a = adjacency.offsets[collapse.from]; a < adjacency.offsets[collapse.from + 1] && !isFlipping; ++a) {
+                const unsigned int* tri = &result[adjacency.triangles[a] * 3];
+                if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to) {
+                    ++removed;
+                    continue;
+                }
+
+                glm::vec3 p[3] = { positions[tri[0]], positions[tri[1]], positions[tri[2]] };
+                const glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                p[tri[0] == collapse.from ? 0 : tri[1] == collapse.from ? 1 : 2] = target;
+                const glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+                isFlipping = glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after);
+            }
+            if (isFlipping) continue;
+
+            remap[collapse.from]  = collapse.to;
+            quadrics[collapse.to] += quadrics[collapse.from];
+
+            // Everything around the moved vertex is frozen for the rest of the pass, so the flip test stays valid
+            for (unsigned int a = adjacency.offsets[collapse.from]; a < adjacency.offsets[collapse.from + 1]; ++a) {
+                const unsigned int* tri = &result[adjacency.triangles[a] * 3];
+                isTouched[tri[0]] = isTouched[tri[1]] = isTouched[tri[2]] = true;
+            }
+
+            triangleCount -= removed;
+            maxError = std::max(maxError, static_cast<float>(std::sqrt(std::max(collapse.cost, 0.0))));
+            ++collapsed;
+        }
+
+        if (collapsed == 0) break;
+
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            const unsigned int a = remap[result[i + 0]];
+            const unsigned int b = remap[result[i + 1]];
+            const unsigned int c = remap[result[i + 2]];
+            if (a == b || b == c || a == c) continue;
+
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+        result.resize(write);
+    }
+
+    if (resultError) *resultError = maxError;
+    return result;
+}
+
+
+// --MESHLETS
+namespace {
+    void computeMeshletBounds(const std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions,
+                              const std::vector<unsigned int>& vertices, Meshlet& meshlet) {
+        glm::vec3 boundsMin(FLT_MAX);
+        glm::vec3 boundsMax(-FLT_MAX);
+        for (unsigned int v : vertices) {
+            boundsMin = glm::min(boundsMin, positions[v]);
+            boundsMax = glm::max(boundsMax, positions[v]);
+        }
+
+        meshlet.center = (boundsMin + boundsMax) * 0.5f;
+        meshlet.radius = 0.0f;
+        for (unsigned int v : vertices) {
+            meshlet.radius = std::max(meshlet.radius, glm::distance(meshlet.center, positions[v]));
+        }
+
+        // Axis is the area weighted mean normal, the cutoff comes from the normal furthest from it
+        std::vector<glm::vec3> normals;
+        normals.reserve(meshlet.indexCount / 3);
+        glm::vec3 axis(0.0f);
+        for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i += 3) {
+            const glm::vec3& p0 = positions[indices[i + 0]];
+            const glm::vec3  n  = glm::cross(positions[indices[i + 1]] - p0, positions[indices[i + 2]] - p0);
+            const float      length = glm::length(n);
+            if (length <= 0.0f) continue;
+
+            axis += n;
+            normals.push_back(n / length);
+        }
+
+        const float axisLength = glm::length(axis);
+        if (axisLength <= 0.0f) {
+            meshlet.coneCutoff = 1.0f;
+            return;
+        }
+        meshlet.coneAxis = axis / axisLength;
+
+        float minDot = 1.0f;
+        for (const glm::vec3& n : normals) {
+            minDot = std::min(minDot, glm::dot(n, meshlet.coneAxis));
+        }
+
+        // Past ~85 degrees the cone hardly ever culls, leave it off
+        meshlet.coneCutoff = minDot <= 0.1f ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+    }
+}
+
+void MeshOptimizer::buildMeshlets(const std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions,
+                                  size_t firstIndex, size_t indexCount, uint32_t range, std::vector<Meshlet>& meshlets) {
+    std::vector<unsigned int> vertices;
+    vertices.reserve(Meshlet::MAX_VERTICES);
+
+    Meshlet current;
+    current.firstIndex = static_cast<uint32_t>(firstIndex);
+    current.range      = range;
+
+    auto flush = [&]() {
+        if (current.indexCount == 0) return;
+        computeMeshletBounds(indices, positions, vertices, current);
+        meshlets.push_back(current);
+
+        current            = Meshlet();
+        current.firstIndex = meshlets.back().firstIndex + meshlets.back().indexCount;
+        current.range      = range;
+        vertices.clear();
+    };
+
+    for (size_t i = firstIndex; i + 3 <= firstIndex + indexCount; i += 3) {
+        unsigned int newVertices = 0;
+        for (int k = 0; k < 3; ++k) {
+            const unsigned int v = indices[i + k];
+            const bool isRepeat = (k > 0 && indices[i] == v) || (k > 1 && indices[i + 1] == v);
+            if (!isRepeat && std::find(vertices.begin(), vertices.end(), v) == vertices.end()) ++newVertices;
+        }
+
+        if (vertices.size() + newVertices > Meshlet::MAX_VERTICES || current.indexCount / 3 + 1 > Meshlet::MAX_TRIANGLES) {
+            flush();
+        }
+
+        for (int k = 0; k < 3; ++k) {
+            const unsigned int v = indices[i + k];
+            if (std::find(vertices.begin(), vertices.end(), v) == vertices.end()) vertices.push_back(v);
+        }
+        current.indexCount += 3;
+    }
+
+    flush();
+}
@@ -0,0 +1,121 @@
+#include "headers/meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PC_MESHLET_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+
+MeshletView MeshletView::create(const Frustum& frustum, const glm::vec3& viewPos, const glm::mat4& worldMatrix) {
+    MeshletView view;
+
+    // dot(plane, M * p) == dot(transpose(M) * plane, p)
+    const glm::mat4 transposed = glm::transpose(worldMatrix);
+    for (int i = 0; i < 6; ++i) {
+        view.planes[i] = transposed * frustum.getPlane(i);
+    }
+
+    const glm::mat3 linear(worldMatrix);
+    view.cameraPos      = glm::vec3(glm::inverse(worldMatrix) * glm::vec4(viewPos, 1.0f));
+    view.radiusScale    = std::max({ glm::length(linear[0]), glm::length(linear[1]), glm::length(linear[2]) });
+    view.isConeCullable = glm::determinant(linear) > 0.0f;
+    return view;
+}
+
+
+MeshletSet::MeshletSet(std::vector<Meshlet> i_meshlets)
+    : m_meshlets(std::move(i_meshlets))
+{
+    const size_t count = m_meshlets.size();
+    for (std::vector<float>* column : { &m_centerX, &m_centerY, &m_centerZ, &m_radius, &m_axisX, &m_axisY, &m_axisZ, &m_cutoff }) {
+        column->resize(count);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        const Meshlet& meshlet = m_meshlets[i];
+        m_centerX[i] = meshlet.center.x;
+        m_centerY[i] = meshlet.center.y;
+        m_centerZ[i] = meshlet.center.z;
+        m_radius[i]  = meshlet.radius;
+        m_axisX[i]   = meshlet.coneAxis.x;
+        m_axisY[i]   = meshlet.coneAxis.y;
+        m_axisZ[i]   = meshlet.coneAxis.z;
+        m_cutoff[i]  = meshlet.coneCutoff;
+    }
+}
+
+// A meshlet is out when its sphere is fully behind a plane, or when the camera is in the back
+// cone: dot(center - camera, axis) >= cutoff * |center - camera| + radius
+size_t MeshletSet::cull(const MeshletView& view, std::vector<uint8_t>& visible) const {
+    const size_t count = m_meshlets.size();
+    visible.resize(count);
+
+    size_t visibleCount = 0;
+    size_t i = 0;
+
+#ifdef PC_MESHLET_USE_SSE2
+    const __m128 vRadiusScale = _mm_set1_ps(view.radiusScale);
+    const __m128 vCamX        = _mm_set1_ps(view.cameraPos.x);
+    const __m128 vCamY        = _mm_set1_ps(view.cameraPos.y);
+    const __m128 vCamZ        = _mm_set1_ps(view.cameraPos.z);
+    const __m128 vConeMask    = _mm_castsi128_ps(_mm_set1_epi32(view.isConeCullable ? -1 : 0));
+
+    for (; i + 4 <= count; i += 4) {
+        const __m128 cx = _mm_loadu_ps(&m_centerX[i]);
+        const __m128 cy = _mm_loadu_ps(&m_centerY[i]);
+        const __m128 cz = _mm_loadu_ps(&m_centerZ[i]);
+        const __m128 r  = _mm_loadu_ps(&m_radius[i]);
+
+        // Frustum, 4 spheres against one plane at a time
+        const __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(r, vRadiusScale));
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (const glm::vec4& plane : view.planes) {
+            const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.x)), _mm_mul_ps(cy, _mm_set1_ps(plane.y))),
+                                        _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(d, negRadius));
+        }
+
+        // Backface cone
+        const __m128 dx  = _mm_sub_ps(cx, vCamX);
+        const __m128 dy  = _mm_sub_ps(cy, vCamY);
+        const __m128 dz  = _mm_sub_ps(cz, vCamZ);
+        const __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+        const __m128 dp  = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, _mm_loadu_ps(&m_axisX[i])), _mm_mul_ps(dy, _mm_loadu_ps(&m_axisY[i]))),
+                                      _mm_mul_ps(dz, _mm_loadu_ps(&m_axisZ[i])));
+        const __m128 backFacing = _mm_and_ps(vConeMask, _mm_cmpge_ps(dp, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&m_cutoff[i]), len), r)));
+
+        const int mask = _mm_movemask_ps(_mm_andnot_ps(backFacing, inside));
+        for (int lane = 0; lane < 4; ++lane) {
+            visible[i + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+        }
+        visibleCount += static_cast<size_t>(((mask >> 0) & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1));
+    }
+#endif
+
+    // Scalar tail (or every meshlet without SSE)
+    for (; i < count; ++i) {
+        const glm::vec3 center(m_centerX[i], m_centerY[i], m_centerZ[i]);
+
+        bool isVisible = true;
+        for (const glm::vec4& plane : view.planes) {
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -m_radius[i] * view.radiusScale) {
+                isVisible = false;
+                break;
+            }
+        }
+
+        if (isVisible && view.isConeCullable) {
+            const glm::vec3 toCenter = center - view.cameraPos;
+            const glm::vec3 axis(m_axisX[i], m_axisY[i], m_axisZ[i]);
+            isVisible = glm::dot(toCenter, axis) < m_cutoff[i] * glm::length(toCenter) + m_radius[i];
+        }
+
+        visible[i]    = isVisible ? 1 : 0;
+        visibleCount += isVisible ? 1 : 0;
+    }
+
+    return visibleCount;
+}
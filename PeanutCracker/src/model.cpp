@@ -2,41 +2,177 @@
 
 #include "headers/mesh.h"
 #include "headers/shader.h"
-#include "headers/assetManager.h"
+#include "headers/threadPool.h"
+#include "headers/meshOptimizer.h"
+#include "headers/gltf.h"
 
 #include <glad/glad.h> 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 
+#include <assimp/DefaultIOSystem.h>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cfloat>
+#include <climits>
+#include <cstring>
 #include <string>
 #include <iostream>
 #include <filesystem>
+#include <numeric>
+#include <set>
 #include <vector>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PC_MODEL_USE_SSE2 1
+#include <emmintrin.h>
+#endif
 
 
-Model::Model(
-	AssetManager* assetManager,
-	std::string const& path,
-	bool gamma)
+
+Model::Model(std::string const& path, bool gamma)
 	: gammaCorrection(gamma)
 	, path(path)
 {
-	std::cout << "[MODEL] Loading model: " << path << '\n';
-	loadModel(assetManager, path);
+	// Stand-in bounds so picking and culling see the placeholder box
+	aabb.min = glm::vec3(-0.5f);
+	aabb.max = glm::vec3( 0.5f);
 }
 
-void Model::draw(const Shader& shader) {
+void Model::draw(const Shader& shader, int lod, const MeshletView* view) {
+	if (!m_isReady) return;
+
 	for (unsigned int i = 0; i < meshes.size(); i++)
-		meshes[i].draw(shader);
+		meshes[i].draw(shader, lod, view);
+}
+
+void Model::drawDepth(int lod) const {
+	if (!m_isReady) return;
+
+	for (const Mesh& mesh : meshes)
+		mesh.drawDepth(lod);
+}
+
+uint64_t LodSettings::getKey() const {
+	uint32_t reductionBits = 0, errorBits = 0;
+	std::memcpy(&reductionBits, &reduction, sizeof(float));
+	std::memcpy(&errorBits, &maxError, sizeof(float));
+
+	uint64_t key = static_cast<uint64_t>(maxLevels);
+	for (uint64_t part : { uint64_t(reductionBits), uint64_t(errorBits), uint64_t(minIndexCount) }) {
+		key = key * 0x100000001B3ull ^ part;
+	}
+	return key;
+}
+
+ModelData Model::importModel(std::string const& path, const LodSettings& lodSettings) {
+	ModelData data;
+	data.directory = std::filesystem::path(path).parent_path().string();
+	const std::string fileName = std::filesystem::path(path).filename().string();
+
+	// glTF reads its buffers directly, Assimp covers everything else and the glTF files the native path can't
+	std::string ext = std::filesystem::path(path).extension().string();
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+	bool isImported = false;
+	if (ext == ".gltf" || ext == ".glb") {
+		isImported = importGltf(path, data);
+		if (!isImported) {
+			std::cout << "[GLTF] Falling back to Assimp for " << fileName << '\n';
+			data.meshes.clear();
+			data.materials.clear();
+			data.dependencies.clear();
+		}
+	}
+	if (!isImported && !importAssimp(path, data)) return data;
+
+	// Optimization runs per mesh on the pool, the bounds are merged after
+	std::vector<VertexCacheStats> before(data.meshes.size());
+	std::vector<VertexCacheStats> after(data.meshes.size());
+	ThreadPool::getGlobal().parallelFor(data.meshes.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			optimizeMesh(data.meshes[i], before[i], after[i]);
+			buildLods(data.meshes[i], lodSettings);
+			packIndices(data.meshes[i]);
+			buildMeshlets(data.meshes[i]);
+		}
+	});
+
+	for (const MeshData& mesh : data.meshes) {
+		for (const glm::mat4& instance : mesh.instances) {
+			for (int corner = 0; corner < 8; corner++) {
+				const glm::vec3 local((corner & 1) ? mesh.bounds.max.x : mesh.bounds.min.x,
+									  (corner & 2) ? mesh.bounds.max.y : mesh.bounds.min.y,
+									  (corner & 4) ? mesh.bounds.max.z : mesh.bounds.min.z);
+				const glm::vec3 world = glm::vec3(instance * glm::vec4(local, 1.0f));
+				data.aabb.min = glm::min(data.aabb.min, world);
+				data.aabb.max = glm::max(data.aabb.max, world);
+			}
+		}
+	}
+
+	VertexCacheStats totalBefore, totalAfter;
+	std::vector<size_t> lodTriangles;
+	for (size_t i = 0; i < data.meshes.size(); i++) {
+		totalBefore += before[i];
+		totalAfter  += after[i];
+
+		const std::vector<MeshLod>& lods = data.meshes[i].lods;
+		if (lods.size() > lodTriangles.size()) lodTriangles.resize(lods.size(), 0);
+		for (size_t level = 0; level < lodTriangles.size(); level++) {
+			lodTriangles[level] += lods[std::min(level, lods.size() - 1)].indexCount / 3;
+		}
+	}
+	std::cout << "[MESH OPT] " << fileName
+			  << ": ACMR " << totalBefore.getACMR() << " -> " << totalAfter.getACMR()
+			  << ", ATVR " << totalBefore.getATVR() << " -> " << totalAfter.getATVR() << '\n';
+
+	std::cout << "[MESH LOD] " << fileName << ":";
+	for (size_t level = 0; level < lodTriangles.size(); level++) {
+		std::cout << (level == 0 ? " " : " / ") << lodTriangles[level];
+	}
+	std::cout << " triangles\n";
+
+	data.isValid = true;
+	return data;
 }
 
-int Model::loadModel(AssetManager* assetManager, std::string const& path) {
+namespace {
+	// Notes every other file Assimp opens (an OBJ's .mtl, a glTF's .bin) so the mesh cache can stamp them too
+	class RecordingIOSystem : public Assimp::DefaultIOSystem {
+	public:
+		RecordingIOSystem(const std::filesystem::path& i_source, std::vector<std::filesystem::path>& i_opened)
+			: m_source(i_source)
+			, m_opened(i_opened)
+		{}
+
+		Assimp::IOStream* Open(const char* pFile, const char* pMode = "rb") override {
+			Assimp::IOStream* stream = DefaultIOSystem::Open(pFile, pMode);
+			if (!stream) return stream;
+
+			const std::filesystem::path file = std::filesystem::u8path(pFile).lexically_normal();
+			std::error_code ec;
+			if (!std::filesystem::equivalent(file, m_source, ec) && std::find(m_opened.begin(), m_opened.end(), file) == m_opened.end()) {
+				m_opened.push_back(file);
+			}
+			return stream;
+		}
+
+	private:
+		std::filesystem::path               m_source;
+		std::vector<std::filesystem::path>& m_opened;
+	};
+}
+
+bool Model::importAssimp(std::string const& path, ModelData& data) {
 	Assimp::Importer importer;
+	importer.SetIOHandler(new RecordingIOSystem(path, data.dependencies));     // Owned by the importer
 
 	unsigned int importFlags = (
 		aiProcess_Triangulate |
@@ -48,91 +184,763 @@ int Model::loadModel(AssetManager* assetManager, std::string const& path) {
 
 	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
 		std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << '\n';
-		return -1;
+		return false;
+	}
+
+	for (unsigned int i = 0; i < scene->mNumMaterials; i++) {
+		data.materials.push_back(describeMaterial(scene->mMaterials[i], data.directory));
 	}
 
-	this->directory = std::filesystem::path(path).parent_path().string();
+	// One MeshData per aiMesh however many nodes use it, shared ones become instances
+	std::vector<std::vector<glm::mat4>> meshTransforms(scene->mNumMeshes);
+	processNode(scene->mRootNode, glm::mat4(1.0f), meshTransforms);
 
-	processNode(assetManager, scene->mRootNode, scene, glm::mat4(1.0f));
+	std::vector<unsigned int> sourceMeshes;
+	for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+		if (!meshTransforms[i].empty()) sourceMeshes.push_back(i);
+	}
 
-	return 0;
+	// Conversion runs per mesh on the pool
+	data.meshes.resize(sourceMeshes.size());
+	ThreadPool::getGlobal().parallelFor(data.meshes.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			const std::vector<glm::mat4>& transforms = meshTransforms[sourceMeshes[i]];
+			const bool isShared = transforms.size() > 1;
+
+			data.meshes[i] = processMesh(scene->mMeshes[sourceMeshes[i]], isShared ? glm::mat4(1.0f) : transforms.front());
+			data.meshes[i].instances = isShared ? transforms : std::vector<glm::mat4>{ glm::mat4(1.0f) };
+		}
+	});
+	return true;
 }
 
-void Model::processNode(AssetManager* assetManager, aiNode* node, const aiScene* scene, const glm::mat4& parentTransform) {
+void Model::decodeImages(ModelData& data) {
+	// Decode every referenced texture once, the map entries exist up front so the workers only write pixels.
+	// Albedo maps are sRGB, which their mips are filtered for
+	std::vector<std::pair<const std::string, LDRImage>*> images;
+	std::set<std::string> srgbPaths;
+	for (const MaterialDesc& material : data.materials) {
+		if (!material.albedoPath.empty()) srgbPaths.insert(material.albedoPath.string());
+
+		for (const std::filesystem::path* texPath : { &material.albedoPath, &material.normalPath, &material.metallicPath, &material.roughnessPath, &material.ormPath }) {
+			if (texPath->empty()) continue;
+
+			auto [it, isNew] = data.images.try_emplace(texPath->string());
+			if (isNew) images.push_back(&*it);
+		}
+	}
+
+	ThreadPool::getGlobal().parallelFor(images.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			LDRImage& image = images[i]->second;
+			if (image.load(images[i]->first)) image.generateMips(srgbPaths.count(images[i]->first) > 0);
+		}
+	});
+}
+
+void Model::processNode(aiNode* node, const glm::mat4& parentTransform, std::vector<std::vector<glm::mat4>>& meshTransforms) {
 	// Combine parent transform with this node's transform
 	glm::mat4 nodeTransform = parentTransform * aiMatrix4x4ToGlm(node->mTransformation);
 
-	// Process each mesh in this node
+	// Record where each mesh in this node sits
 	for (unsigned int i = 0; i < node->mNumMeshes; i++) {
-		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-		meshes.push_back(processMesh(assetManager, mesh, scene, nodeTransform));
+		meshTransforms[node->mMeshes[i]].push_back(nodeTransform);
 	}
 
 	// Recursively process child nodes
 	for (unsigned int i = 0; i < node->mNumChildren; i++) {
-		processNode(assetManager, node->mChildren[i], scene, nodeTransform);
+		processNode(node->mChildren[i], nodeTransform, meshTransforms);
 	}
 }
 
-Mesh Model::processMesh(AssetManager* assetManager, aiMesh* mesh, const aiScene* scene, const glm::mat4& transform) {
-	std::vector<Vertex> vertices;
-	std::vector<unsigned int> indices;
+namespace {
+#ifdef PC_MODEL_USE_SSE2
+	// A glm matrix's first three rows as SSE columns, so a vertex is three multiply-adds
+	struct SimdTransform {
+		__m128 cols[4];
+
+		explicit SimdTransform(const glm::mat4& m) {
+			for (int c = 0; c < 4; c++) cols[c] = _mm_setr_ps(m[c].x, m[c].y, m[c].z, 0.0f);
+		}
+		explicit SimdTransform(const glm::mat3& m) {
+			for (int c = 0; c < 3; c++) cols[c] = _mm_setr_ps(m[c].x, m[c].y, m[c].z, 0.0f);
+			cols[3] = _mm_setzero_ps();
+		}
+
+		// Anything with x, y, z: aiVector3D or glm::vec3
+		template <typename V>
+		__m128 apply(const V& v) const {
+			__m128 r = _mm_add_ps(_mm_mul_ps(cols[0], _mm_set1_ps(v.x)), cols[3]);
+			r = _mm_add_ps(r, _mm_mul_ps(cols[1], _mm_set1_ps(v.y)));
+			return _mm_add_ps(r, _mm_mul_ps(cols[2], _mm_set1_ps(v.z)));
+		}
+	};
+
+	__m128 normalize3(__m128 v) {
+		const __m128 sq  = _mm_mul_ps(v, v);
+		const __m128 len = _mm_add_ps(_mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(0, 0, 0, 1))), _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(0, 0, 0, 2)));
+		return _mm_div_ps(v, _mm_sqrt_ps(_mm_shuffle_ps(len, len, _MM_SHUFFLE(0, 0, 0, 0))));
+	}
+
+	glm::vec3 toVec3(__m128 v) {
+		alignas(16) float f[4];
+		_mm_store_ps(f, v);
+		return glm::vec3(f[0], f[1], f[2]);
+	}
+#else
+	template <typename V>
+	glm::vec3 toVec3(const V& v) {
+		return glm::vec3(v.x, v.y, v.z);
+	}
+#endif
+}
+
+// Runs on a pool worker per mesh, so it only writes to its own MeshData
+MeshData Model::processMesh(aiMesh* mesh, const glm::mat4& transform) {
+	MeshData data;
+	const unsigned int vertexCount = mesh->mNumVertices;
+	data.vertices.resize(vertexCount);
+	data.positions.resize(vertexCount);
+
+	// Transpose of the inverse keeps normals perpendicular under non-uniform scale
+	const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(transform)));
+	const bool hasNormals   = mesh->HasNormals();
+	const bool hasTexCoords = mesh->mTextureCoords[0] != nullptr;
+	const bool hasTangents  = hasTexCoords && mesh->HasTangentsAndBitangents();
+
+#ifdef PC_MODEL_USE_SSE2
+	const SimdTransform pointTransform(transform);
+	const SimdTransform normalTransform(normalMatrix);
+	__m128 boundsMin = _mm_set1_ps(FLT_MAX);
+	__m128 boundsMax = _mm_set1_ps(-FLT_MAX);
+#endif
 
 	// Process Vertices
-	for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-		Vertex vertex;
-
-		// Transform position by node's transform matrix
-		glm::vec4 pos = transform * glm::vec4(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z, 1.0f);
-		vertex.position = glm::vec3(pos);
-
-		// Keep track of max and min AABB
-		aabb.min.x = std::min(aabb.min.x, vertex.position.x);
-		aabb.min.y = std::min(aabb.min.y, vertex.position.y);
-		aabb.min.z = std::min(aabb.min.z, vertex.position.z);
-		aabb.max.x = std::max(aabb.max.x, vertex.position.x);
-		aabb.max.y = std::max(aabb.max.y, vertex.position.y);
-		aabb.max.z = std::max(aabb.max.z, vertex.position.z);
-
-		// Transform normals (use transpose of inverse for correct normal transformation)
-		if (mesh->HasNormals()) {
-			glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(transform)));
-			glm::vec3 normal = normalMatrix * glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
-			vertex.normal = glm::normalize(normal);
-		}
-
-		// Texture Coordinates, Tangents, Bitangents
-		if (mesh->mTextureCoords[0]) {
-			vertex.texCoords = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
-
-			if (mesh->HasTangentsAndBitangents()) {
-				glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(transform)));
-				vertex.tangent   = glm::normalize(normalMatrix * glm::vec3(mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z));
-				vertex.bitangent = glm::normalize(normalMatrix * glm::vec3(mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z));
+	for (unsigned int i = 0; i < vertexCount; i++) {
+		glm::vec3 position;
+		glm::vec3 normal(0.0f);
+		glm::vec2 texCoords(0.0f);
+		glm::vec3 tangent(0.0f);
+		glm::vec3 bitangent(0.0f);
+
+#ifdef PC_MODEL_USE_SSE2
+		const __m128 pos = pointTransform.apply(mesh->mVertices[i]);
+		boundsMin = _mm_min_ps(boundsMin, pos);
+		boundsMax = _mm_max_ps(boundsMax, pos);
+		position  = toVec3(pos);
+
+		if (hasNormals) normal = toVec3(normalize3(normalTransform.apply(mesh->mNormals[i])));
+		if (hasTangents) {
+			tangent   = toVec3(normalize3(normalTransform.apply(mesh->mTangents[i])));
+			bitangent = toVec3(normalize3(normalTransform.apply(mesh->mBitangents[i])));
+		}
+#else
+		position = glm::vec3(transform * glm::vec4(toVec3(mesh->mVertices[i]), 1.0f));
+		data.bounds.min = glm::min(data.bounds.min, position);
+		data.bounds.max = glm::max(data.bounds.max, position);
+
+		if (hasNormals) normal = glm::normalize(normalMatrix * toVec3(mesh->mNormals[i]));
+		if (hasTangents) {
+			tangent   = glm::normalize(normalMatrix * toVec3(mesh->mTangents[i]));
+			bitangent = glm::normalize(normalMatrix * toVec3(mesh->mBitangents[i]));
+		}
+#endif
+		if (hasTexCoords) texCoords = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
+
+		// Only the bitangent's handedness survives packing
+		data.positions[i] = position;
+		data.vertices[i]  = Vertex::pack(position, normal, texCoords, tangent, bitangent);
+	}
+
+#ifdef PC_MODEL_USE_SSE2
+	if (vertexCount > 0) {
+		data.bounds.min = toVec3(boundsMin);
+		data.bounds.max = toVec3(boundsMax);
+	}
+#endif
+
+	// Count first so the index array is sized once, lines and points left by Triangulate included
+	size_t indexCount = 0;
+	for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+		indexCount += mesh->mFaces[i].mNumIndices;
+	}
+	data.indices.resize(indexCount);
+
+	unsigned int* out = data.indices.data();
+	for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+		const aiFace& face = mesh->mFaces[i];
+		out = std::copy(face.mIndices, face.mIndices + face.mNumIndices, out);
+	}
+
+	data.vertexCount   = vertexCount;
+	data.indexCount    = indexCount;
+	data.materialIndex = mesh->mMaterialIndex;
+
+	return data;
+}
+
+// --GLTF
+namespace {
+	constexpr int GLTF_TRIANGLES      = 4;
+	constexpr int GLTF_TRIANGLE_STRIP = 5;
+	constexpr int GLTF_TRIANGLE_FAN   = 6;
+
+	// Strips and fans become a plain triangle list, odd strip triangles swap two corners to keep the winding
+	void triangulate(std::vector<unsigned int>& indices, int mode) {
+		std::vector<unsigned int> triangles;
+		if (indices.size() >= 3) triangles.reserve((indices.size() - 2) * 3);
+
+		for (size_t i = 2; i < indices.size(); i++) {
+			if (mode == GLTF_TRIANGLE_FAN) {
+				triangles.insert(triangles.end(), { indices[0], indices[i - 1], indices[i] });
+			}
+			else if (i % 2 == 0) {
+				triangles.insert(triangles.end(), { indices[i - 2], indices[i - 1], indices[i] });
 			}
 			else {
-				vertex.tangent   = glm::vec3(0.0f);
-				vertex.bitangent = glm::vec3(0.0f);
+				triangles.insert(triangles.end(), { indices[i - 1], indices[i - 2], indices[i] });
+			}
+		}
+		indices.swap(triangles);
+	}
+
+	glm::vec3 readVec3(const GltfDocument::Accessor& accessor, size_t i) {
+		float v[3];
+		accessor.read(i, v);
+		return glm::vec3(v[0], v[1], v[2]);
+	}
+
+	AABB computeBounds(const std::vector<glm::vec3>& positions) {
+		AABB bounds;
+#ifdef PC_MODEL_USE_SSE2
+		if (positions.empty()) return bounds;
+
+		__m128 boundsMin = _mm_set1_ps(FLT_MAX);
+		__m128 boundsMax = _mm_set1_ps(-FLT_MAX);
+		for (const glm::vec3& p : positions) {
+			const __m128 v = _mm_setr_ps(p.x, p.y, p.z, 0.0f);
+			boundsMin = _mm_min_ps(boundsMin, v);
+			boundsMax = _mm_max_ps(boundsMax, v);
+		}
+		bounds.min = toVec3(boundsMin);
+		bounds.max = toVec3(boundsMax);
+#else
+		for (const glm::vec3& p : positions) {
+			bounds.min = glm::min(bounds.min, p);
+			bounds.max = glm::max(bounds.max, p);
+		}
+#endif
+		return bounds;
+	}
+
+	// Area weighted face normals, for primitives that come without any
+	void generateNormals(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices, std::vector<glm::vec3>& normals) {
+		normals.assign(positions.size(), glm::vec3(0.0f));
+		for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+			const glm::vec3& p0 = positions[indices[i]];
+			const glm::vec3 faceNormal = glm::cross(positions[indices[i + 1]] - p0, positions[indices[i + 2]] - p0);
+			for (size_t k = 0; k < 3; k++) normals[indices[i + k]] += faceNormal;
+		}
+
+		for (glm::vec3& n : normals) {
+			const float length = glm::length(n);
+			n = length > 0.0f ? n / length : glm::vec3(0.0f, 1.0f, 0.0f);
+		}
+	}
+
+	// UV derivatives per triangle summed per vertex, the same construction as aiProcess_CalcTangentSpace
+	void generateTangents(const std::vector<glm::vec3>& positions, const std::vector<glm::vec2>& texCoords, const std::vector<glm::vec3>& normals,
+						  const std::vector<unsigned int>& indices, std::vector<glm::vec3>& tangents, std::vector<glm::vec3>& bitangents) {
+		tangents.assign(positions.size(), glm::vec3(0.0f));
+		bitangents.assign(positions.size(), glm::vec3(0.0f));
+		for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+			const unsigned int a = indices[i], b = indices[i + 1], c = indices[i + 2];
+			const glm::vec3 e1 = positions[b] - positions[a];
+			const glm::vec3 e2 = positions[c] - positions[a];
+			const glm::vec2 d1 = texCoords[b] - texCoords[a];
+			const glm::vec2 d2 = texCoords[c] - texCoords[a];
+
+			const float det = d1.x * d2.y - d2.x * d1.y;
+			if (std::abs(det) < 1e-12f) continue;
+
+			const glm::vec3 t = (e1 * d2.y - e2 * d1.y) / det;
+			const glm::vec3 bt = (e2 * d1.x - e1 * d2.x) / det;
+			for (unsigned int v : { a, b, c }) {
+				tangents[v]   += t;
+				bitangents[v] += bt;
 			}
 		}
+
+		for (size_t v = 0; v < positions.size(); v++) {
+			const glm::vec3& n = normals[v];
+			glm::vec3 t = tangents[v] - n * glm::dot(n, tangents[v]);
+			const float length = glm::length(t);
+
+			// Degenerate UVs still need a frame perpendicular to the normal
+			t = length > 0.0f ? t / length : glm::normalize(glm::cross(n, std::abs(n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f)));
+			tangents[v] = t;
+			if (glm::dot(bitangents[v], bitangents[v]) == 0.0f) bitangents[v] = glm::cross(n, t);
+		}
+	}
+}
+
+bool Model::importGltf(const std::filesystem::path& path, ModelData& data) {
+	GltfDocument doc;
+	if (!doc.open(path)) return false;
+	const JsonValue& json = doc.getJson();
+	data.dependencies = doc.getBufferPaths();
+
+	const JsonValue& materials = json["materials"];
+	for (size_t i = 0; i < materials.size(); i++) {
+		data.materials.push_back(describeGltfMaterial(doc, materials[i]));
+	}
+
+	// Same instancing rule as the Assimp path, per glTF mesh
+	const JsonValue& meshes = json["meshes"];
+	const JsonValue& nodes  = json["nodes"];
+	std::vector<std::vector<glm::mat4>> meshTransforms(meshes.size());
+
+	const JsonValue& scene = json["scenes"][json["scene"].getInt(0)];
+	if (scene.isObject()) {
+		const JsonValue& roots = scene["nodes"];
+		for (size_t i = 0; i < roots.size(); i++) {
+			processGltfNode(json, roots[i].getInt(-1), glm::mat4(1.0f), meshTransforms, 0);
+		}
+	}
+	else {
+		// No scene, every node that isn't somebody's child is a root
+		std::vector<bool> isChild(nodes.size(), false);
+		for (size_t i = 0; i < nodes.size(); i++) {
+			const JsonValue& children = nodes[i]["children"];
+			for (size_t c = 0; c < children.size(); c++) {
+				const int child = children[c].getInt(-1);
+				if (child >= 0 && static_cast<size_t>(child) < nodes.size()) isChild[child] = true;
+			}
+		}
+		for (size_t i = 0; i < nodes.size(); i++) {
+			if (!isChild[i]) processGltfNode(json, static_cast<int>(i), glm::mat4(1.0f), meshTransforms, 0);
+		}
+	}
+
+	// One MeshData per triangle primitive, points and lines aren't drawn
+	struct Primitive {
+		const JsonValue* json;
+		size_t           mesh;
+		unsigned int     material;
+	};
+	std::vector<Primitive> primitives;
+	bool usesDefaultMaterial = false;
+	for (size_t m = 0; m < meshes.size(); m++) {
+		if (meshTransforms[m].empty()) continue;
+
+		const JsonValue& list = meshes[m]["primitives"];
+		for (size_t p = 0; p < list.size(); p++) {
+			const int mode = list[p]["mode"].getInt(GLTF_TRIANGLES);
+			if (mode < GLTF_TRIANGLES || mode > GLTF_TRIANGLE_FAN) continue;
+
+			int material = list[p]["material"].getInt(-1);
+			if (material < 0 || static_cast<size_t>(material) >= materials.size()) {
+				material = static_cast<int>(materials.size());
+				usesDefaultMaterial = true;
+			}
+			primitives.push_back({ &list[p], m, static_cast<unsigned int>(material) });
+		}
+	}
+
+	// The spec's default material, after the file's own
+	if (usesDefaultMaterial) {
+		MaterialDesc desc;
+		desc.name      = "Default";
+		desc.baseColor = glm::vec4(1.0f);
+		desc.metallic  = 1.0f;
+		desc.roughness = 1.0f;
+		data.materials.push_back(desc);
+	}
+
+	data.meshes.resize(primitives.size());
+	std::atomic<bool> isValid{ true };
+	ThreadPool::getGlobal().parallelFor(data.meshes.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			const std::vector<glm::mat4>& transforms = meshTransforms[primitives[i].mesh];
+			const bool isShared = transforms.size() > 1;
+
+			if (!processPrimitive(doc, *primitives[i].json, isShared ? glm::mat4(1.0f) : transforms.front(), data.meshes[i])) {
+				isValid = false;
+				continue;
+			}
+			data.meshes[i].instances     = isShared ? transforms : std::vector<glm::mat4>{ glm::mat4(1.0f) };
+			data.meshes[i].materialIndex = primitives[i].material;
+		}
+	});
+
+	if (!isValid) {
+		std::cerr << "[GLTF] Unsupported or malformed primitive in " << path.filename() << '\n';
+		return false;
+	}
+
+	data.meshes.erase(std::remove_if(data.meshes.begin(), data.meshes.end(), [](const MeshData& mesh) { return mesh.indexCount == 0; }), data.meshes.end());
+	return true;
+}
+
+void Model::processGltfNode(const JsonValue& json, int nodeIndex, const glm::mat4& parentTransform, std::vector<std::vector<glm::mat4>>& meshTransforms, size_t depth) {
+	const JsonValue& nodes = json["nodes"];
+	const JsonValue& node  = nodes[nodeIndex];
+
+	// Deeper than the node count means a malformed file made the hierarchy a cycle
+	if (!node.isObject() || depth > nodes.size()) return;
+
+	glm::mat4 localTransform(1.0f);
+	const JsonValue& matrix = node["matrix"];
+	if (matrix.size() == 16) {
+		// Column major, like glm
+		for (int i = 0; i < 16; i++) localTransform[i / 4][i % 4] = matrix[i].getFloat();
+	}
+	else {
+		const JsonValue& t = node["translation"];
+		const JsonValue& r = node["rotation"];
+		const JsonValue& s = node["scale"];
+		const glm::quat rotation(r[3].getFloat(1.0f), r[0].getFloat(), r[1].getFloat(), r[2].getFloat());
+
+		localTransform = glm::translate(glm::mat4(1.0f), glm::vec3(t[0].getFloat(), t[1].getFloat(), t[2].getFloat()))
+					   * glm::mat4_cast(rotation)
+					   * glm::scale(glm::mat4(1.0f), glm::vec3(s[0].getFloat(1.0f), s[1].getFloat(1.0f), s[2].getFloat(1.0f)));
+	}
+	const glm::mat4 nodeTransform = parentTransform * localTransform;
+
+	const int mesh = node["mesh"].getInt(-1);
+	if (mesh >= 0 && static_cast<size_t>(mesh) < meshTransforms.size()) {
+		meshTransforms[mesh].push_back(nodeTransform);
+	}
+
+	const JsonValue& children = node["children"];
+	for (size_t i = 0; i < children.size(); i++) {
+		processGltfNode(json, children[i].getInt(-1), nodeTransform, meshTransforms, depth + 1);
+	}
+}
+
+// Reads the accessors in place, runs on a pool worker per primitive
+bool Model::processPrimitive(const GltfDocument& doc, const JsonValue& primitive, const glm::mat4& transform, MeshData& data) {
+	const JsonValue& attributes = primitive["attributes"];
+
+	GltfDocument::Accessor position, normal, texCoord, tangent;
+	if (!doc.getAccessor(attributes["POSITION"].getInt(-1), position) || position.componentCount != 3) return false;
+	const size_t vertexCount = position.count;
+
+	const bool hasNormals   = doc.getAccessor(attributes["NORMAL"].getInt(-1), normal) && normal.componentCount == 3 && normal.count == vertexCount;
+	const bool hasTexCoords = doc.getAccessor(attributes["TEXCOORD_0"].getInt(-1), texCoord) && texCoord.componentCount == 2 && texCoord.count == vertexCount;
+	const bool hasTangents  = hasTexCoords && doc.getAccessor(attributes["TANGENT"].getInt(-1), tangent) && tangent.componentCount == 4 && tangent.count == vertexCount;
+
+	// Indices first, generated normals and tangents need the triangles
+	std::vector<unsigned int>& indices = data.indices;
+	if (primitive.has("indices")) {
+		GltfDocument::Accessor indexAccessor;
+		if (!doc.getAccessor(primitive["indices"].getInt(-1), indexAccessor) || indexAccessor.componentCount != 1) return false;
+		if (indexAccessor.componentType != GltfDocument::UNSIGNED_BYTE &&
+			indexAccessor.componentType != GltfDocument::UNSIGNED_SHORT &&
+			indexAccessor.componentType != GltfDocument::UNSIGNED_INT) return false;
+
+		indices.resize(indexAccessor.count);
+		if (indexAccessor.componentType == GltfDocument::UNSIGNED_INT && indexAccessor.isTight()) {
+			// Already the 32 bit list the optimizer works on
+			if (!indices.empty()) std::memcpy(indices.data(), indexAccessor.data, indices.size() * sizeof(unsigned int));
+		}
 		else {
-			vertex.texCoords = glm::vec2(0.0f, 0.0f);
-			vertex.tangent   = glm::vec3(0.0f);
-			vertex.bitangent = glm::vec3(0.0f);
+			for (size_t i = 0; i < indices.size(); i++) indices[i] = indexAccessor.readIndex(i);
 		}
+	}
+	else {
+		indices.resize(vertexCount);
+		std::iota(indices.begin(), indices.end(), 0u);
+	}
+
+	const int mode = primitive["mode"].getInt(GLTF_TRIANGLES);
+	if (mode != GLTF_TRIANGLES) triangulate(indices, mode);
+	indices.resize(indices.size() - indices.size() % 3);
+	if (std::any_of(indices.begin(), indices.end(), [&](unsigned int index) { return index >= vertexCount; })) return false;
 
-		vertices.push_back(vertex);
+	// Transpose of the inverse keeps normals perpendicular under non-uniform scale.
+	// A mirroring transform flips cross(normal, tangent), so the stored handedness flips with it
+	const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(transform)));
+	const float     handedness   = glm::determinant(glm::mat3(transform)) < 0.0f ? -1.0f : 1.0f;
+
+#ifdef PC_MODEL_USE_SSE2
+	const SimdTransform pointTransform(transform);
+	const SimdTransform normalTransform(normalMatrix);
+#endif
+
+	std::vector<glm::vec3>& positions = data.positions;
+	positions.resize(vertexCount);
+	if (transform == glm::mat4(1.0f) && position.componentType == GltfDocument::FLOAT && position.isTight()) {
+		// Instanced meshes keep their own space, a tight float stream already is the depth-only stream
+		if (vertexCount > 0) std::memcpy(positions.data(), position.data, vertexCount * sizeof(glm::vec3));
+	}
+	else {
+		for (size_t i = 0; i < vertexCount; i++) {
+#ifdef PC_MODEL_USE_SSE2
+			positions[i] = toVec3(pointTransform.apply(readVec3(position, i)));
+#else
+			positions[i] = glm::vec3(transform * glm::vec4(readVec3(position, i), 1.0f));
+#endif
+		}
 	}
+	data.bounds = computeBounds(positions);
 
-	for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
-		aiFace face = mesh->mFaces[i];
-		for (unsigned int j = 0; j < face.mNumIndices; j++)
-			indices.push_back(face.mIndices[j]);
+	std::vector<glm::vec3> normals(vertexCount);
+	if (hasNormals) {
+		for (size_t i = 0; i < vertexCount; i++) {
+#ifdef PC_MODEL_USE_SSE2
+			normals[i] = toVec3(normalize3(normalTransform.apply(readVec3(normal, i))));
+#else
+			normals[i] = glm::normalize(normalMatrix * readVec3(normal, i));
+#endif
+		}
+	}
+	else {
+		generateNormals(positions, indices, normals);
+	}
+
+	// glTF's V runs down the image, flipped the same way Assimp's glTF importer does
+	std::vector<glm::vec2> texCoords(vertexCount, glm::vec2(0.0f));
+	if (hasTexCoords) {
+		for (size_t i = 0; i < vertexCount; i++) {
+			float uv[2];
+			texCoord.read(i, uv);
+			texCoords[i] = glm::vec2(uv[0], 1.0f - uv[1]);
+		}
+	}
+
+	std::vector<glm::vec3> tangents(vertexCount, glm::vec3(0.0f));
+	std::vector<glm::vec3> bitangents(vertexCount, glm::vec3(0.0f));
+	if (hasTangents) {
+		for (size_t i = 0; i < vertexCount; i++) {
+			float t[4];
+			tangent.read(i, t);
+#ifdef PC_MODEL_USE_SSE2
+			tangents[i] = toVec3(normalize3(normalTransform.apply(glm::vec3(t[0], t[1], t[2]))));
+#else
+			tangents[i] = glm::normalize(normalMatrix * glm::vec3(t[0], t[1], t[2]));
+#endif
+			bitangents[i] = glm::cross(normals[i], tangents[i]) * (t[3] < 0.0f ? -handedness : handedness);
+		}
+	}
+	else if (hasTexCoords) {
+		generateTangents(positions, texCoords, normals, indices, tangents, bitangents);
+	}
+
+	data.vertices.resize(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++) {
+		data.vertices[i] = Vertex::pack(positions[i], normals[i], texCoords[i], tangents[i], bitangents[i]);
+	}
+
+	data.vertexCount = vertexCount;
+	data.indexCount  = indices.size();
+	return true;
+}
+
+MaterialDesc Model::describeGltfMaterial(const GltfDocument& doc, const JsonValue& material) {
+	MaterialDesc desc;
+	desc.name = material["name"].getString();
+
+	const JsonValue& pbr    = material["pbrMetallicRoughness"];
+	const JsonValue& factor = pbr["baseColorFactor"];
+	desc.baseColor = glm::vec4(factor[0].getFloat(1.0f), factor[1].getFloat(1.0f), factor[2].getFloat(1.0f), factor[3].getFloat(1.0f));
+	desc.metallic  = pbr["metallicFactor"].getFloat(1.0f);
+	desc.roughness = pbr["roughnessFactor"].getFloat(1.0f);
+
+	desc.albedoPath = doc.getTexturePath(pbr["baseColorTexture"]["index"].getInt(-1));
+	desc.normalPath = doc.getTexturePath(material["normalTexture"]["index"].getInt(-1));
+
+	// Roughness in G and metalness in B, the slot Assimp's glTF importer fills too
+	desc.ormPath = doc.getTexturePath(pbr["metallicRoughnessTexture"]["index"].getInt(-1));
+
+	return desc;
+}
+
+void Model::optimizeMesh(MeshData& mesh, VertexCacheStats& before, VertexCacheStats& after) {
+	before = MeshOptimizer::analyzeVertexCache(mesh.indices, mesh.vertexCount);
+
+	// Points and lines left over by aiProcess_Triangulate aren't triangle lists
+	if (mesh.indices.size() % 3 != 0) {
+		after = before;
+		return;
+	}
+
+	std::vector<size_t> clusterStarts;
+	mesh.indices = MeshOptimizer::optimizeVertexCache(mesh.indices, mesh.vertexCount, &clusterStarts);
+	MeshOptimizer::optimizeOverdraw(mesh.indices, mesh.positions, clusterStarts);
+
+	const std::vector<unsigned int> remap = MeshOptimizer::optimizeVertexFetch(mesh.indices, mesh.vertexCount);
+	MeshOptimizer::remapVertices(mesh.vertices, remap);
+	MeshOptimizer::remapVertices(mesh.positions, remap);
+
+	after = MeshOptimizer::analyzeVertexCache(mesh.indices, mesh.vertexCount);
+}
+
+void Model::buildLods(MeshData& mesh, const LodSettings& settings) {
+	// Stops a level that barely shrank, locked seams and borders can stall the simplifier
+	constexpr float MIN_LEVEL_SHRINK = 0.85f;
+
+	mesh.lods = { MeshLod{ 0, static_cast<uint32_t>(mesh.indices.size()), 0, 0, 0.0f } };
+	if (mesh.indices.size() % 3 != 0) return;
+
+	// The error budget scales with the mesh so one setting suits a cup and a building alike
+	const float radius     = 0.5f * glm::length(mesh.bounds.max - mesh.bounds.min);
+	const float errorLimit = settings.maxError * radius;
+	const float reduction  = std::clamp(settings.reduction, 0.05f, 0.95f);
+
+	// Each level starts from the one before, its error adds up as an upper bound
+	std::vector<unsigned int> level(mesh.indices);
+	float error = 0.0f;
+	while (static_cast<int>(mesh.lods.size()) < settings.maxLevels && level.size() >= settings.minIndexCount && error < errorLimit) {
+		const size_t targetIndexCount = static_cast<size_t>(static_cast<float>(level.size() / 3) * reduction) * 3;
+
+		float stepError = 0.0f;
+		std::vector<unsigned int> simplified = MeshOptimizer::simplify(level, mesh.positions, targetIndexCount, errorLimit - error, &stepError);
+		if (static_cast<float>(simplified.size()) > static_cast<float>(level.size()) * MIN_LEVEL_SHRINK) break;
+
+		simplified = MeshOptimizer::optimizeVertexCache(simplified, mesh.vertexCount);
+		error += stepError;
+
+		mesh.lods.push_back({ static_cast<uint32_t>(mesh.indices.size()), static_cast<uint32_t>(simplified.size()), 0, 0, error });
+		mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.end());
+		level = std::move(simplified);
+	}
+
+	mesh.indexCount = mesh.indices.size();
+}
+
+namespace {
+	// Split one level into runs of triangles whose vertices span less than 65536. After optimizeVertexFetch()
+	// a run touches a narrow band of vertices, so a big mesh needs about vertexCount / 65536 of them.
+	// Returns false if a single triangle spans too far
+	bool splitShortRanges(const std::vector<unsigned int>& indices, const MeshLod& lod, std::vector<DrawRange>& ranges) {
+		constexpr unsigned int SHORT_RANGE = 65536;
+
+		const uint32_t end   = lod.firstIndex + lod.indexCount;
+		uint32_t       begin = lod.firstIndex;
+		unsigned int   low   = UINT_MAX;
+		unsigned int   high  = 0;
+		for (uint32_t i = lod.firstIndex; i < end; i += 3) {
+			const unsigned int triLow  = std::min({ indices[i], indices[i + 1], indices[i + 2] });
+			const unsigned int triHigh = std::max({ indices[i], indices[i + 1], indices[i + 2] });
+			if (triHigh - triLow >= SHORT_RANGE) return false;
+
+			if (std::max(high, triHigh) - std::min(low, triLow) >= SHORT_RANGE) {
+				ranges.push_back({ begin, i - begin, static_cast<int32_t>(low) });
+				begin = i;
+				low   = triLow;
+				high  = triHigh;
+			}
+			else {
+				low  = std::min(low, triLow);
+				high = std::max(high, triHigh);
+			}
+		}
+		ranges.push_back({ begin, end - begin, static_cast<int32_t>(low == UINT_MAX ? 0 : low) });
+		return true;
+	}
+}
+
+void Model::packIndices(MeshData& mesh) {
+	constexpr unsigned int SHORT_RANGE = 65536;
+
+	const uint32_t indexCount = static_cast<uint32_t>(mesh.indices.size());
+	if (mesh.lods.empty()) mesh.lods = { MeshLod{ 0, indexCount, 0, 0, 0.0f } };
+
+	// 32 bit fallback: one range per level
+	mesh.indexType = GL_UNSIGNED_INT;
+	mesh.shortIndices.clear();
+	mesh.ranges.clear();
+	for (MeshLod& lod : mesh.lods) {
+		lod.firstRange = static_cast<uint32_t>(mesh.ranges.size());
+		lod.rangeCount = 1;
+		mesh.ranges.push_back({ lod.firstIndex, lod.indexCount, 0 });
 	}
 
-	auto material = assetManager->loadMaterial(scene->mMaterials[mesh->mMaterialIndex], directory, mesh->mMaterialIndex);
+	if (indexCount == 0 || indexCount % 3 != 0) return;
+
+	std::vector<DrawRange> ranges;
+	std::vector<MeshLod>   lods = mesh.lods;
+	for (MeshLod& lod : lods) {
+		lod.firstRange = static_cast<uint32_t>(ranges.size());
+		if (!splitShortRanges(mesh.indices, lod, ranges)) return;
+		lod.rangeCount = static_cast<uint32_t>(ranges.size()) - lod.firstRange;
+	}
+
+	// Scattered indices would cost more in draw calls than the halved buffer saves
+	const size_t expectedRanges = (mesh.vertexCount + SHORT_RANGE - 1) / SHORT_RANGE;
+	if (ranges.size() > 2 * expectedRanges * lods.size()) return;
+
+	mesh.shortIndices.resize(indexCount);
+	for (const DrawRange& range : ranges) {
+		for (uint32_t i = range.firstIndex; i < range.firstIndex + range.indexCount; i++) {
+			mesh.shortIndices[i] = static_cast<uint16_t>(mesh.indices[i] - static_cast<unsigned int>(range.baseVertex));
+		}
+	}
+
+	mesh.indexType = GL_UNSIGNED_SHORT;
+	mesh.ranges    = std::move(ranges);
+	mesh.lods      = std::move(lods);
+}
+
+void Model::buildMeshlets(MeshData& mesh) {
+	// Below this the culling costs more than the triangles it saves
+	constexpr uint32_t MIN_MESHLET_TRIANGLES = 1024;
+
+	mesh.meshlets.clear();
+	if (mesh.lods.empty() || mesh.indices.size() % 3 != 0) return;
+
+	// Meshlets are culled in the mesh's own space, which only works with one placement
+	const MeshLod& lod = mesh.lods.front();
+	if (lod.indexCount / 3 < MIN_MESHLET_TRIANGLES || mesh.instances.size() > 1) return;
+
+	for (uint32_t r = lod.firstRange; r < lod.firstRange + lod.rangeCount; r++) {
+		const DrawRange& range = mesh.ranges[r];
+		MeshOptimizer::buildMeshlets(mesh.indices, mesh.positions, range.firstIndex, range.indexCount, r, mesh.meshlets);
+	}
+}
+
+// Records texture paths and fallback factors, AssetManager::loadMaterial() resolves them once the textures are uploaded
+MaterialDesc Model::describeMaterial(aiMaterial* mat, const std::filesystem::path& dir) {
+	MaterialDesc desc;
+
+	aiString aiName;
+	mat->Get(AI_MATKEY_NAME, aiName);
+	desc.name = aiName.C_Str();
+
+	// Helper func
+	auto getTexPath = [&](aiTextureType type) -> std::filesystem::path {
+		if (mat->GetTextureCount(type) > 0) {
+			aiString path;
+			mat->GetTexture(type, 0, &path);
+			return dir / path.C_Str();
+		}
+
+		return {};
+	};
+
+	//--Albedo
+	desc.albedoPath = getTexPath(aiTextureType_DIFFUSE);
+	if (desc.albedoPath.empty()) {
+		desc.albedoPath = getTexPath(aiTextureType_BASE_COLOR);
+	}
+
+	aiColor4D defaultAlbedo = { 1.0f, 0.0f, 1.0f, 1.0f };
+	mat->Get(AI_MATKEY_COLOR_DIFFUSE, defaultAlbedo);
+	desc.baseColor = glm::vec4(defaultAlbedo.r, defaultAlbedo.g, defaultAlbedo.b, defaultAlbedo.a);
+
+	//--Normals
+	desc.normalPath = getTexPath(aiTextureType_NORMALS);
+
+	//--ORM check
+	desc.ormPath       = getTexPath(aiTextureType_UNKNOWN);
+	desc.metallicPath  = getTexPath(aiTextureType_METALNESS);
+	desc.roughnessPath = getTexPath(aiTextureType_DIFFUSE_ROUGHNESS);
+
+	mat->Get(AI_MATKEY_METALLIC_FACTOR, desc.metallic);
+	mat->Get(AI_MATKEY_ROUGHNESS_FACTOR, desc.roughness);
 
-	return Mesh(vertices, indices, material);
+	return desc;
 }
 
 // Helper function to convert Assimp matrix to GLM matrix
@@ -0,0 +1,236 @@
+#include "headers/modelLoader.h"
+#include "headers/assetManager.h"
+#include "headers/threadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+
+
+ModelLoader::ModelLoader(const std::string& i_path, std::shared_ptr<Model> i_model, const MeshCache& i_cache, const LodSettings& i_lodSettings)
+    : m_path(i_path)
+    , m_model(std::move(i_model))
+{
+    std::cout << "[MODEL] Loading model: " << m_path << '\n';
+
+    m_pending = ThreadPool::getGlobal().submit([path = m_path, cache = i_cache, lodSettings = i_lodSettings]() {
+        return decode(path, cache, lodSettings);
+    });
+}
+
+
+// --WORKER
+// A cooked entry skips the import entirely, a fresh import is cooked for next time
+ModelData ModelLoader::decode(const std::string& path, const MeshCache& cache, const LodSettings& lodSettings) {
+    ModelData data;
+    if (!cache.load(path, lodSettings, data)) {
+        data = Model::importModel(path, lodSettings);
+        if (!data.isValid) return data;
+
+        cache.store(path, lodSettings, data);
+    }
+
+    Model::decodeImages(data);
+    return data;
+}
+
+
+// --MAIN THREAD STEPS
+bool ModelLoader::update(AssetManager& assetManager, UploadContext& uploadContext, double budgetMs) {
+    using Clock = std::chrono::steady_clock;
+
+    if (m_state == State::DONE || m_state == State::FAILED) return true;
+
+    if (m_state == State::IMPORTING) {
+        if (m_pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+
+        ModelData data = m_pending.get();
+        if (!data.isValid) {
+            std::cerr << "[MODEL] Failed to load " << m_path << '\n';
+
+            // An empty model, like the synchronous path used to leave behind
+            m_model->markReady();
+            m_state = State::FAILED;
+            return true;
+        }
+
+        m_batch = std::make_shared<UploadBatch>();
+        m_batch->data = std::move(data);
+        submitUploads(assetManager, uploadContext);
+        m_state = State::UPLOADING;
+    }
+
+    if (m_state == State::UPLOADING) {
+        if (m_lastTicket && !m_lastTicket->isComplete()) return false;
+
+        for (PendingTexture& pending : m_batch->textures) {
+            if (pending.texture) assetManager.adoptTexture(pending.path, std::move(pending.texture));
+        }
+        m_batch->textures.clear();
+        m_batch->data.images.clear();
+        m_lastTicket.reset();
+        releaseCpuData();
+
+        m_model->directory = m_batch->data.directory;
+        m_materials.resize(m_batch->data.materials.size());
+        m_model->meshes.reserve(m_batch->data.meshes.size());
+        m_state = m_materials.empty() ? State::BUILDING_MESHES : State::BUILDING_MATERIALS;
+    }
+
+    const Clock::time_point start = Clock::now();
+    do {
+        runStep(assetManager);
+    } while (m_state != State::DONE && std::chrono::duration<double, std::milli>(Clock::now() - start).count() < budgetMs);
+
+    return m_state == State::DONE;
+}
+
+// One job per texture tail and per mesh, so the upload thread never holds a frame's worth of work in one call
+void ModelLoader::submitUploads(AssetManager& assetManager, UploadContext& uploadContext) {
+    UploadBatch& batch = *m_batch;
+
+    // Albedo maps are sRGB, a path already in the texture cache isn't uploaded again
+    std::map<std::string, bool> texturePaths;
+    for (const MaterialDesc& material : batch.data.materials) {
+        if (!material.albedoPath.empty()) texturePaths[material.albedoPath.string()] = true;
+        for (const std::filesystem::path* texPath : { &material.normalPath, &material.metallicPath, &material.roughnessPath, &material.ormPath }) {
+            if (!texPath->empty()) texturePaths.try_emplace(texPath->string(), false);
+        }
+    }
+
+    for (const auto& [path, isSRGB] : texturePaths) {
+        auto image = batch.data.images.find(path);
+        if (image == batch.data.images.end() || !image->second.isValid()) continue;
+        if (assetManager.findTexture(path)) continue;
+
+        batch.textures.push_back({ path, isSRGB, nullptr });
+    }
+
+    batch.vbos.resize(batch.data.meshes.size());
+    batch.positionVbos.resize(batch.data.meshes.size());
+    batch.ebos.resize(batch.data.meshes.size());
+
+    // Only the mip tails go up with the batch, the streamer brings in the bigger levels after
+    for (PendingTexture& pending : batch.textures) {
+        auto image = std::make_shared<LDRImage>(std::move(batch.data.images.at(pending.path)));
+        pending.texture = assetManager.getTextureStreamer().add(std::move(image), pending.isSRGB, m_lastTicket);
+    }
+
+    for (size_t i = 0; i < batch.data.meshes.size(); ++i) {
+        m_lastTicket = uploadContext.submit([batchPtr = m_batch, i]() {
+            const MeshData& mesh = batchPtr->data.meshes[i];
+            batchPtr->vbos[i].setData(mesh.getVertexData(), mesh.vertexCount);
+            batchPtr->positionVbos[i].setData(mesh.getPositionData(), mesh.vertexCount);
+            batchPtr->ebos[i].setDataUnbound(mesh.getIndexData(), mesh.indexCount, mesh.indexType);
+            batchPtr->vbos[i].unbind();
+        });
+    }
+}
+
+// The GPU owns the buffers now, only what the model's retention asks for survives, and of the
+// indices only LOD 0. Mapped (cooked) data is copied out here since the mapping goes away with the batch
+void ModelLoader::releaseCpuData() {
+    m_retention = m_model->retention;
+
+    for (MeshData& mesh : m_batch->data.meshes) {
+        mesh.vertices     = std::vector<Vertex>();
+        mesh.shortIndices = std::vector<uint16_t>();
+
+        const MeshLod baseLod = mesh.lods.empty() ? MeshLod{ 0, static_cast<uint32_t>(mesh.indexCount), 0, static_cast<uint32_t>(mesh.ranges.size()), 0.0f }
+                                                  : mesh.lods.front();
+
+        if (m_retention == MeshRetention::NONE) {
+            mesh.positions = std::vector<glm::vec3>();
+            mesh.indices   = std::vector<unsigned int>();
+        }
+        else if (mesh.mappedPositions) {
+            mesh.positions.assign(mesh.mappedPositions, mesh.mappedPositions + mesh.vertexCount);
+
+            // Retained indices are always 32 bit and relative to vertex 0
+            mesh.indices.resize(baseLod.indexCount);
+            for (uint32_t r = baseLod.firstRange; r < baseLod.firstRange + baseLod.rangeCount; ++r) {
+                const DrawRange& range = mesh.ranges[r];
+                for (uint32_t i = range.firstIndex; i < range.firstIndex + range.indexCount; ++i) {
+                    const unsigned int index = mesh.indexType == GL_UNSIGNED_SHORT ? static_cast<const uint16_t*>(mesh.mappedIndices)[i]
+                                                                                   : static_cast<const unsigned int*>(mesh.mappedIndices)[i];
+                    mesh.indices[i] = index + static_cast<unsigned int>(range.baseVertex);
+                }
+            }
+        }
+        else {
+            mesh.indices.resize(baseLod.indexCount);
+            mesh.indices.shrink_to_fit();
+        }
+
+        mesh.mappedVertices  = nullptr;
+        mesh.mappedPositions = nullptr;
+        mesh.mappedIndices   = nullptr;
+    }
+
+    m_batch->data.mapping.reset();
+}
+
+void ModelLoader::runStep(AssetManager& assetManager) {
+    UploadBatch& batch = *m_batch;
+
+    switch (m_state) {
+    case State::BUILDING_MATERIALS:
+        m_materials[m_nextMaterial] = assetManager.loadMaterial(batch.data.materials[m_nextMaterial], batch.data.directory,
+                                                                static_cast<int>(m_nextMaterial));
+
+        if (++m_nextMaterial == m_materials.size()) {
+            m_state = State::BUILDING_MESHES;
+        }
+        break;
+
+    case State::BUILDING_MESHES:
+        if (m_nextMesh < batch.data.meshes.size()) {
+            MeshData& mesh = batch.data.meshes[m_nextMesh];
+            m_model->meshes.emplace_back(std::move(mesh.positions), std::move(mesh.indices), std::move(mesh.ranges), std::move(mesh.lods),
+                                         std::move(mesh.meshlets), mesh.instances, m_materials[mesh.materialIndex], std::move(batch.vbos[m_nextMesh]),
+                                         std::move(batch.positionVbos[m_nextMesh]), std::move(batch.ebos[m_nextMesh]));
+            ++m_nextMesh;
+        }
+
+        if (m_nextMesh == batch.data.meshes.size()) {
+            finish();
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+void ModelLoader::finish() {
+    m_model->aabb = m_batch->data.aabb;
+
+    // A level a mesh doesn't have draws its coarsest, so the model's error is the worst mesh's.
+    // Instanced meshes are simplified in their own space, their error grows with the instance scale
+    int lodCount = 0;
+    for (const Mesh& mesh : m_model->meshes) {
+        lodCount = std::max(lodCount, mesh.getLodCount());
+    }
+    m_model->lodErrors.assign(lodCount, 0.0f);
+    for (const Mesh& mesh : m_model->meshes) {
+        for (int lod = 0; lod < lodCount; ++lod) {
+            m_model->lodErrors[lod] = std::max(m_model->lodErrors[lod], mesh.getLod(lod).error * mesh.getMaxInstanceScale());
+        }
+    }
+
+    m_model->markReady();
+
+    m_batch.reset();
+    m_state = State::DONE;
+
+    size_t instanceCount = 0;
+    for (const Mesh& mesh : m_model->meshes) {
+        instanceCount += static_cast<size_t>(mesh.getInstanceCount());
+    }
+    std::cout << "[MODEL] Loaded " << m_path << " (" << m_model->meshes.size() << " meshes, " << instanceCount << " instances)\n";
+
+    if (m_model->retention != m_retention) {
+        std::cerr << "[MODEL] Retention of " << m_path << " changed after its CPU data was released, reload it to keep positions\n";
+    }
+}
@@ -43,16 +43,16 @@ void Object::setQuatRotation(const glm::quat& quatRot) {
 
 
 /* === INTERFACE =========================================================== */
-void Object::draw(const Shader& shader, const glm::mat4& worldMatrix) const {
+void Object::draw(const Shader& shader, const glm::mat4& worldMatrix, int lod, const MeshletView* view) const {
     shader.use();
     shader.setMat4("model", worldMatrix);
     glm::mat4 normalMatrix = glm::transpose(glm::inverse(worldMatrix));
     shader.setMat4("normalMatrix", normalMatrix);
-    modelPtr->draw(shader);
+    modelPtr->draw(shader, lod, view);
 }
 
-void Object::drawShadow(const glm::mat4& modelMatrix, const Shader& depthShader) const {
+void Object::drawShadow(const glm::mat4& modelMatrix, const Shader& depthShader, int lod) const {
     depthShader.use();
     depthShader.setMat4("model", modelMatrix);
-    modelPtr->draw(depthShader);
+    modelPtr->drawDepth(lod);
 }
\ No newline at end of file
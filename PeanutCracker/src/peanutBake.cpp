@@ -0,0 +1,136 @@
+// PeanutBake: headless IBL baker.
+// Writes the same cache entries the editor looks up, so skyboxes can be baked ahead of time
+// (or on a machine without a GPU) and load instantly in the editor.
+// With --verify nothing is written, the CPU bake is checked against the cached entries instead
+// (the editor's GPU bakes) and the exit code says whether every map is within tolerance.
+//
+//   PeanutBake <input.hdr> [--out <cacheDir>] [--size <envSize>] [--brdf] [--verify]
+
+#include "headers/iblBaker.h"
+#include "headers/threadPool.h"
+
+#include "../stb_image/stb_image.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+namespace {
+    void printUsage() {
+        std::cout << "Usage: PeanutBake <input.hdr> [--out <cacheDir>] [--size <envSize>] [--brdf] [--verify]\n"
+                  << "  --out     cache directory, defaults to cache/ibl (the editor's cache)\n"
+                  << "  --size    environment face size, a power of two like the editor's 256, 512 or 1024, defaults to "
+                  << IBLSettings::ENV_SIZE << "\n"
+                  << "  --brdf    also bake the BRDF LUT\n"
+                  << "  --verify  compare against the cached bakes instead of writing them, exits with 1 on a mismatch\n";
+    }
+
+    double getMillisecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Writes the bake, or with --verify checks it against the entry already cached under key
+    bool storeOrVerify(const IBLCache& cache, uint64_t key, const std::vector<IBLImage>& images, bool isVerify) {
+        if (!isVerify) {
+            if (!cache.store(key, images)) return false;
+            std::cout << "[BAKE] Wrote " << cache.getEntryPath(key) << '\n';
+            return true;
+        }
+
+        std::vector<IBLImage> reference;
+        if (!cache.load(key, reference)) {
+            std::cerr << "ERROR: Nothing cached at " << cache.getEntryPath(key) << " to verify against\n";
+            return false;
+        }
+        return IBLBaker::verify(reference, images);
+    }
+}
+
+
+int main(int argc, char** argv) {
+    std::filesystem::path inputPath;
+    std::filesystem::path outDir = std::filesystem::path("cache") / "ibl";
+    int  envSize  = IBLSettings::ENV_SIZE;
+    bool bakeBRDF = false;
+    bool isVerify = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+
+        if (arg == "--out" && i + 1 < argc) {
+            outDir = argv[++i];
+        }
+        else if (arg == "--size" && i + 1 < argc) {
+            envSize = std::atoi(argv[++i]);
+            if (envSize < 16 || envSize > 8192 || (envSize & (envSize - 1)) != 0) {
+                std::cerr << "ERROR: --size must be a power of two from 16 to 8192\n";
+                return 1;
+            }
+        }
+        else if (arg == "--brdf") {
+            bakeBRDF = true;
+        }
+        else if (arg == "--verify") {
+            isVerify = true;
+        }
+        else if (arg == "-h" || arg == "--help") {
+            printUsage();
+            return 0;
+        }
+        else if (inputPath.empty() && arg[0] != '-') {
+            inputPath = arg;
+        }
+        else {
+            std::cerr << "ERROR: Unknown argument: " << arg << '\n';
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (inputPath.empty() && !bakeBRDF) {
+        printUsage();
+        return 1;
+    }
+
+    // Same orientation as the editor's texture loading
+    stbi_set_flip_vertically_on_load(true);
+
+    const IBLCache cache(outDir);
+    std::cout << "[BAKE] " << ThreadPool::getGlobal().getThreadCount() + 1 << " threads\n";
+
+    bool isOk = true;
+
+    if (!inputPath.empty()) {
+        const uint64_t key = IBLSettings::getEnvironmentKey(inputPath, envSize, IBLSettings::PREFILTER_SIZE);
+        if (key == 0) {
+            std::cerr << "ERROR: Couldn't read " << inputPath << '\n';
+            return 1;
+        }
+
+        HDRImage image;
+        if (!image.load(inputPath)) return 1;
+
+        const auto start = std::chrono::steady_clock::now();
+        const std::vector<IBLImage> images = IBLBaker::bakeEnvironment(image, envSize, IBLSettings::PREFILTER_SIZE);
+        std::cout << "[BAKE] " << envSize << " environment baked in " << getMillisecondsSince(start) << " ms\n";
+
+        isOk = storeOrVerify(cache, key, images, isVerify) && isOk;
+    }
+
+    if (bakeBRDF) {
+        const uint64_t key = IBLSettings::getBRDFLUTKey();
+
+        const auto start = std::chrono::steady_clock::now();
+        const std::vector<IBLImage> images = IBLBaker::bakeBRDFLUT();
+        std::cout << "[BAKE] BRDF LUT baked in " << getMillisecondsSince(start) << " ms\n";
+
+        isOk = storeOrVerify(cache, key, images, isVerify) && isOk;
+    }
+
+    if (isVerify) std::cout << "[IBL VERIFY] " << (isOk ? "PASS" : "FAIL") << '\n';
+    return isOk ? 0 : 1;
+}
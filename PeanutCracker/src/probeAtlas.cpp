@@ -0,0 +1,95 @@
+#include "headers/probeAtlas.h"
+
+#include <algorithm>
+#include <iostream>
+
+
+ProbeAtlas::ProbeAtlas() {
+    glGenTextures(1, &m_textureID);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureID);
+
+    // RGB16F isn't a required render format in 3.3
+    for (int mip = 0; mip < MIPS; ++mip) {
+        const int size = getMipSize(mip);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, mip, GL_RGBA16F, size, size, MAX_PROBES + 1, 0, GL_RGBA, GL_FLOAT, nullptr);
+    }
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, MIPS - 1);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    glGenFramebuffers(1, &m_fbo);
+
+    // Low layers first, allocate() pops from the back
+    m_freeLayers.reserve(MAX_PROBES);
+    for (int layer = MAX_PROBES - 1; layer >= 0; --layer) {
+        m_freeLayers.push_back(layer);
+    }
+}
+
+ProbeAtlas::~ProbeAtlas() {
+    if (m_fbo != 0)       glDeleteFramebuffers(1, &m_fbo);
+    if (m_textureID != 0) glDeleteTextures(1, &m_textureID);
+}
+
+
+// --SLOTS
+int ProbeAtlas::allocate() {
+    if (m_freeLayers.empty()) return -1;
+
+    const int layer = m_freeLayers.back();
+    m_freeLayers.pop_back();
+    return layer;
+}
+
+void ProbeAtlas::release(int layer) {
+    if (layer < 0) return;
+    m_freeLayers.push_back(layer);
+}
+
+int ProbeAtlas::swapStaging(int layer) {
+    std::swap(layer, m_stagingLayer);
+    return layer;
+}
+
+
+// --BAKE
+void ProbeAtlas::prefilterRows(const Texture& envMap, int envSize, const Shader& prefilterShader, int layer, int mip, int firstRow, int rowCount) const {
+    const int   size      = getMipSize(mip);
+    const float roughness = static_cast<float>(mip) / static_cast<float>(MIPS - 1);
+
+    prefilterShader.use();
+    prefilterShader.setInt("environmentMap", 0);
+    prefilterShader.setFloat("roughness", roughness);
+    prefilterShader.setFloat("envResolution", static_cast<float>(envSize));
+
+    envMap.bind(0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_textureID, mip, layer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "[PROBE] Atlas framebuffer incomplete\n";
+    }
+
+    glViewport(0, 0, size, size);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(0, firstRow, size, rowCount);
+    glDisable(GL_DEPTH_TEST);
+
+    m_emptyVAO.bind();
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    m_emptyVAO.unbind();
+
+    glEnable(GL_DEPTH_TEST);
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ProbeAtlas::bind(unsigned int slot) const {
+    glActiveTexture(GL_TEXTURE0 + slot);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureID);
+}
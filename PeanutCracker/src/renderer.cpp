@@ -3,6 +3,12 @@
 #include "glm/glm.hpp"
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+
 void Renderer::initScene(Scene& scene) {
     setupUnitLine();
     setupUnitQuad();
@@ -22,13 +28,21 @@ void Renderer::update(Scene& scene, Camera& cam, int vWidth, int vHeight) {
         m_viewportFBO.rescale(vWidth, vHeight);
     }
 
+    scene.beginUBOFrame();
+
     cam.updateVectors();
     scene.updateShadowMapLSMats();
     scene.getWorldNode()->update(glm::mat4(1.0f), true);
+
+    // Pixels per world unit at distance 1
+    const float projScale = static_cast<float>(vHeight) / (2.0f * std::tan(glm::radians(cam.getFov()) * 0.5f));
+    selectLods(scene.getWorldNode(), cam.getPos(), projScale);
+
     scene.updateCameraUBO(cam.getProjMat((float)vWidth / (float)vHeight), cam.getViewMat(), cam.getPos());
     scene.updateLightingUBO();
     scene.updateRefProbeUBO();
     scene.updateShadowUBO();
+    scene.updateEnvironmentUBO();
 }
 
 void Renderer::renderScene(const Scene& scene, const Camera& cam, int vWidth, int vHeight) const {
@@ -45,25 +59,29 @@ void Renderer::renderScene(const Scene& scene, const Camera& cam, int vWidth, in
     scene.setNodeIBLMapUniforms();
     scene.setNodeRefMapUniforms();
 
+    // --Probe captures, restores the camera after rendering from the probes
+    bakeRefProbePass(scene);
+    bakeIrradianceVolumePass(scene);
+    scene.updateCameraUBO(cam.getProjMat((float)vWidth / (float)vHeight), cam.getViewMat(), cam.getPos());
+
     // --Objects & skybox
     m_viewportFBO.bind(vWidth, vHeight);
     renderLightPass(scene, cam, vWidth, vHeight);
 
-    bakeRefProbePass(scene);
-
-    scene.updateCameraUBO(cam.getProjMat((float)vWidth / (float)vHeight), cam.getViewMat(), cam.getPos());
-
     renderSelectionHightlight(scene);
     
     // --Debug
     renderLightAreas(scene, cam, vWidth, vHeight);
     renderRefProbeProxy(scene, cam, vWidth, vHeight);
+    renderLoadingPlaceholders(scene, cam, vWidth, vHeight);
 
     m_viewportFBO.resolve();
 
     renderPostProcess(scene, vWidth, vHeight);
 
     m_viewportFBO.unbind();
+
+    scene.endUBOFrame();
 }
 
 void Renderer::renderShadowPass(const Scene& scene, const Camera& cam) const {
@@ -132,28 +150,67 @@ void Renderer::renderLightPass(const Scene& scene, const Camera& cam, int vWidth
     }
 
     if (_renderMode == Render_Mode::WIREFRAME) { glPolygonMode(GL_FRONT_AND_BACK, GL_LINE); }
-    renderObjectsFC(scene, scene.getWorldNode(), cam);
+    renderObjectsFC(scene, scene.getWorldNode(), cam.getFrustum(), cam.getPos());
     if (_renderMode == Render_Mode::WIREFRAME) { glPolygonMode(GL_FRONT_AND_BACK, GL_FILL); }
 }
 
-// Render objects with frustum culling
-void Renderer::renderObjectsFC(const Scene& scene, const SceneNode* node, const Camera& cam) const {
+void Renderer::selectLods(SceneNode* node, const glm::vec3& camPos, float projScale) const {
+    if (node->object && node->sphereColliderComponent) {
+        const Model*                   model  = node->object->modelPtr;
+        const SphereColliderComponent& sphere = *node->sphereColliderComponent;
+
+        if (model->getLodCount() <= 1 || sphere.localRadius <= 0.0f) {
+            node->lodLevel = 0;
+        }
+        else {
+            // The model space error scaled by the sphere's projected size, inside the sphere gets the full mesh
+            const float distance        = glm::distance(camPos, sphere.worldCenter);
+            const float projectedRadius = distance > sphere.worldRadius ? sphere.worldRadius * projScale / distance : FLT_MAX;
+            auto getPixelError = [&](int lod) {
+                return model->getLodError(lod) / sphere.localRadius * projectedRadius;
+            };
+
+            int lod = 0;
+            for (int level = model->getLodCount() - 1; level > 0; --level) {
+                if (getPixelError(level) <= m_lodPixelError) {
+                    lod = level;
+                    break;
+                }
+            }
+
+            // Finer right away, coarser only with some margin
+            while (lod > node->lodLevel && getPixelError(lod) > m_lodPixelError * LOD_HYSTERESIS) {
+                --lod;
+            }
+            node->lodLevel = lod;
+        }
+    }
+
+    for (auto& child : node->children) {
+        selectLods(child.get(), camPos, projScale);
+    }
+}
+
+// Render objects with frustum culling, big meshes also cull their meshlets
+void Renderer::renderObjectsFC(const Scene& scene, const SceneNode* node, const Frustum& frustum, const glm::vec3& viewPos) const {
 
     bool isVisible = true;
     if (node->sphereColliderComponent && node != scene.getWorldNode()) {
         BoundingSphere boundingSphere = { node->sphereColliderComponent->worldCenter, node->sphereColliderComponent->worldRadius };
-        if (!cam.getFrustum().isInFrustum(boundingSphere)) {
+        if (!frustum.isInFrustum(boundingSphere)) {
             isVisible = false;
         }
     }
 
     if (isVisible) {
         if (node->object) {
-            node->object->draw(scene.getModelShader(), node->worldMatrix);
+            setRefProbeUniforms(scene, node);
+            const MeshletView view = MeshletView::create(frustum, viewPos, node->worldMatrix);
+            node->object->draw(scene.getModelShader(), node->worldMatrix, node->lodLevel, &view);
         }
 
         for (auto& child : node->children) {
-            renderObjectsFC(scene, child.get(), cam);
+            renderObjectsFC(scene, child.get(), frustum, viewPos);
         }
     }
 }
@@ -161,7 +218,8 @@ void Renderer::renderObjectsFC(const Scene& scene, const SceneNode* node, const
 // Render objects without frustum culling
 void Renderer::renderObjects(const Scene& scene, const SceneNode* node) const {
     if (node != scene.getWorldNode() && node->object) {
-        node->object->draw(scene.getModelShader(), node->worldMatrix);
+        setRefProbeUniforms(scene, node);
+        node->object->draw(scene.getModelShader(), node->worldMatrix, node->lodLevel);
     }
 
     for (auto& child : node->children) {
@@ -169,10 +227,25 @@ void Renderer::renderObjects(const Scene& scene, const SceneNode* node) const {
     }
 }
 
-// Writes to the shadow map
+// Per-draw probe selection, the fragment shader only samples these two
+void Renderer::setRefProbeUniforms(const Scene& scene, const SceneNode* node) const {
+    glm::vec3 center = glm::vec3(node->worldMatrix[3]);
+    float     radius = 0.0f;
+    if (node->sphereColliderComponent) {
+        center = node->sphereColliderComponent->worldCenter;
+        radius = node->sphereColliderComponent->worldRadius;
+    }
+
+    const RefProbeSelection selection = scene.selectRefProbes(center, radius);
+    scene.getModelShader().use();
+    scene.getModelShader().setIVec2("refProbeIndices", selection.indices);
+    scene.getModelShader().setVec2("refProbeWeights", selection.weights);
+}
+
+// Writes to the shadow map, a few levels coarser than the camera sees since shadows are soft anyway
 void Renderer::renderShadowMap(const SceneNode* node, const Shader& depthShader) const {
     if (node->object) {
-        node->object->drawShadow(node->worldMatrix, depthShader);
+        node->object->drawShadow(node->worldMatrix, depthShader, node->lodLevel + m_shadowLodBias);
     }
 
     for (auto& child : node->children) {
@@ -199,7 +272,7 @@ void Renderer::renderSelectionHightlight(const Scene& scene) const {
     glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
     glDepthMask(GL_FALSE);
 
-    // draw object to the stencil buffer
+    // draw object to the stencil buffer, no offset so the normal stream isn't needed
     scene.getOutlineShader().use();
     scene.getOutlineShader().setFloat("outlineThickness", 0.0f);
 
@@ -208,7 +281,7 @@ void Renderer::renderSelectionHightlight(const Scene& scene) const {
 
         scene.getOutlineShader().setMat4("normalMatrix", selectedNode->object->normalMatrixCache);
         scene.getOutlineShader().setMat4("model", selectedNode->worldMatrix);
-        selectedNode->object->modelPtr->draw(scene.getOutlineShader());
+        selectedNode->object->modelPtr->drawDepth(selectedNode->lodLevel);
     }
 
     // DRAWING OUTLINE
@@ -229,7 +302,7 @@ void Renderer::renderSelectionHightlight(const Scene& scene) const {
 
         scene.getOutlineShader().setMat4("normalMatrix", selectedNode->object->normalMatrixCache);
         scene.getOutlineShader().setMat4("model", selectedNode->worldMatrix);
-        selectedNode->object->modelPtr->draw(scene.getOutlineShader());
+        selectedNode->object->modelPtr->draw(scene.getOutlineShader(), selectedNode->lodLevel);
     }
 
     glStencilMask(0xFF);
@@ -239,65 +312,176 @@ void Renderer::renderSelectionHightlight(const Scene& scene) const {
 }
 
 void Renderer::bakeRefProbePass(const Scene& scene) const {
+    using Clock = std::chrono::steady_clock;
+    ProbeBake& bake = m_probeBake;
+
+    // The probe may have been deleted since the last step
+    if (bake.probe) {
+        const auto& probes = scene.getRefProbes();
+        const bool exists = std::any_of(probes.begin(), probes.end(), [&](const std::unique_ptr<RefProbe>& p) { return p.get() == bake.probe; });
+        if (!exists) bake.probe = nullptr;
+    }
 
-    for (auto& probe : scene.getRefProbes()) {
-        if (!probe->toBeBaked) continue;
-
-        std::cout << "baking probe" << std::endl;
-        std::cout << "setting view mats" << std::endl;
-        // Setup view mats
-        std::array<glm::mat4, 6> viewMats = {
-            glm::lookAt(probe->transform.position, probe->transform.position + glm::vec3(1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-            glm::lookAt(probe->transform.position, probe->transform.position + glm::vec3(-1.0f, 0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-            glm::lookAt(probe->transform.position, probe->transform.position + glm::vec3(0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)),
-            glm::lookAt(probe->transform.position, probe->transform.position + glm::vec3(0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)),
-            glm::lookAt(probe->transform.position, probe->transform.position + glm::vec3(0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-            glm::lookAt(probe->transform.position, probe->transform.position + glm::vec3(0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
-        };
-        std::cout << "initialized viewMats" << std::endl;
-
-        // Render scene to cubemap
-        GLuint fbo, rbo;
-        glGenFramebuffers(1, &fbo);
-        glGenRenderbuffers(1, &rbo);
-        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-        glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512);
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rbo);
-        glViewport(0, 0, 512, 512);
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-            std::cerr << "ERROR: [RENDERER] probe baking error!" << '\n';
+    auto restart = [&bake]() {
+        bake.probe->toBeBaked = false;
+        bake.version = bake.probe->version;
+        bake.stage   = ProbeBake::Stage::CAPTURING;
+        bake.face    = 0;
+        bake.mip     = 0;
+        bake.row     = 0;
+    };
+
+    if (!bake.probe) {
+        for (auto& probe : scene.getRefProbes()) {
+            if (probe->toBeBaked) {
+                bake.probe = probe.get();
+                break;
+            }
         }
-        std::cout << "fbo and rbo ready" << std::endl;
+        if (!bake.probe) return;
+
+        if (!bake.envMap || bake.envSize != m_probeCaptureSize) {
+            bake.envSize = m_probeCaptureSize;
+            bake.envMap  = std::make_unique<Texture>(bake.envSize, TexType::TEX_CUBE, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+        }
+        restart();
+    }
+    // Bake requested again or the probe moved mid-bake, every face has to see the same scene
+    else if (bake.probe->toBeBaked || bake.probe->version != bake.version) {
+        restart();
+    }
+
+    const Clock::time_point start = Clock::now();
+    do {
+        runProbeBakeStep(scene);
+    } while (bake.probe && std::chrono::duration<double, std::milli>(Clock::now() - start).count() < PROBE_BAKE_BUDGET_MS);
+}
 
-        for (unsigned int i = 0; i < 6; ++i) {
-            scene.updateCameraUBO(glm::perspective(glm::radians(90.0f), 1.0f, 0.01f, probe->farPlane), viewMats[i], probe->transform.position);
-            std::cout << "Rendering face " << i << " with " << scene.getWorldNode()->children.size() << " root children" << std::endl;
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, probe->localEnvMap.getEnvironmentMap().getID(), 0);
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+void Renderer::runProbeBakeStep(const Scene& scene) const {
+    ProbeBake& bake = m_probeBake;
 
-            // Write to cubemap texture
-            if (scene.getSkybox()) {
-                renderSkybox(scene);
+    switch (bake.stage) {
+    case ProbeBake::Stage::CAPTURING:
+        m_probeCaptureTarget.setup(bake.envSize);
+        captureCubeFace(scene, bake.probe->transform.position, bake.probe->farPlane, *bake.envMap, m_probeCaptureTarget, bake.envSize, bake.face);
+        if (++bake.face == 6) {
+            bake.face  = 0;
+            bake.stage = ProbeBake::Stage::MIPMAPPING;
+        }
+        break;
+
+    case ProbeBake::Stage::MIPMAPPING:
+        bake.envMap->generateMipmaps();
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        bake.stage = ProbeBake::Stage::PREFILTERING;
+        break;
+
+    case ProbeBake::Stage::PREFILTERING: {
+        ProbeAtlas& atlas    = scene.getProbeAtlas();
+        const int   mipSize  = ProbeAtlas::getMipSize(bake.mip);
+        const int   rowCount = std::min(PROBE_PREFILTER_ROWS, mipSize - bake.row);
+
+        atlas.prefilterRows(*bake.envMap, bake.envSize, scene.getProbePrefilterShader(), atlas.getStagingLayer(), bake.mip, bake.row, rowCount);
+
+        bake.row += rowCount;
+        if (bake.row == mipSize) {
+            bake.row = 0;
+            if (++bake.mip == ProbeAtlas::MIPS) {
+                // The old layer becomes the staging layer of the next bake
+                bake.probe->atlasLayer = atlas.swapStaging(bake.probe->atlasLayer);
+                bake.probe->isBaked    = true;
+                bake.probe->version++;      // Re-packs the layer index into the probe UBO
+                bake.probe = nullptr;
             }
+        }
+        break;
+    }
+    }
+}
 
-            renderObjects(scene, scene.getWorldNode());
+void Renderer::bakeIrradianceVolumePass(const Scene& scene) const {
+    using Clock = std::chrono::steady_clock;
+    IrradianceVolume& volume = scene.getIrradianceVolume();
+    VolumeBake&       bake   = m_volumeBake;
+
+    // Edited mid-bake, the grid has to come from one consistent layout
+    if (volume.toBeBaked || (bake.isActive && volume.version != bake.version)) {
+        volume.toBeBaked = false;
+        volume.beginBake();
+        bake.isActive = true;
+        bake.version  = volume.version;
+        bake.probe    = 0;
+    }
+    if (!bake.isActive) return;
+
+    if (!bake.envMap) {
+        bake.envMap = std::make_unique<Texture>(VOLUME_CAPTURE_SIZE, TexType::TEX_CUBE, GL_LINEAR, GL_LINEAR);
+        bake.texels.resize(static_cast<size_t>(6) * VOLUME_CAPTURE_SIZE * VOLUME_CAPTURE_SIZE * 3);
+    }
+
+    const Clock::time_point start = Clock::now();
+    do {
+        bakeVolumeProbe(scene, volume, bake.probe);
+
+        if (++bake.probe == volume.getProbeCount()) {
+            volume.finishBake();
+            bake.isActive = false;
         }
-        std::cout << "writing to faces done" << std::endl;
+    } while (bake.isActive && std::chrono::duration<double, std::milli>(Clock::now() - start).count() < VOLUME_BAKE_BUDGET_MS);
+}
 
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glDeleteFramebuffers(1, &fbo);
-        glDeleteRenderbuffers(1, &rbo);
+// The readback waits on the captures, the budget check above sees that time too
+void Renderer::bakeVolumeProbe(const Scene& scene, IrradianceVolume& volume, int probe) const {
+    VolumeBake&     bake     = m_volumeBake;
+    const glm::vec3 position = volume.getProbePosition(probe);
+    const size_t    faceSize = static_cast<size_t>(VOLUME_CAPTURE_SIZE) * VOLUME_CAPTURE_SIZE * 3;
 
-        // Generate prefilter map
-        probe->localEnvMap.getEnvironmentMap().generateMipmaps();
-        probe->localEnvMap.getPrefilterMap().generateMipmaps();
-        probe->localEnvMap.generatePrefilterMap(scene.getPrefilterShader());
-        std::cout << "generating prefilterMap done" << std::endl;
+    m_volumeCaptureTarget.setup(VOLUME_CAPTURE_SIZE);
+    for (int face = 0; face < 6; ++face) {
+        captureCubeFace(scene, position, volume.farPlane, *bake.envMap, m_volumeCaptureTarget, VOLUME_CAPTURE_SIZE, face);
+    }
 
-        probe->toBeBaked = false;
+    for (int face = 0; face < 6; ++face) {
+        bake.envMap->readLevel(0, face, GL_RGB32F, bake.texels.data() + face * faceSize);
+    }
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
 
+    volume.setProbe(probe, SphericalHarmonics::toIrradiance(SphericalHarmonics::projectCubemap(bake.texels.data(), VOLUME_CAPTURE_SIZE)));
+}
+
+// Renders one face of a point's surroundings with that face's frustum
+void Renderer::captureCubeFace(const Scene& scene, const glm::vec3& position, float farPlane, const Texture& target,
+                               const CaptureTarget& captureTarget, int size, int face) const {
+    static const std::array<glm::vec3, 6> faceDirs = {
+        glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(-1.0f,  0.0f,  0.0f),
+        glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3( 0.0f, -1.0f,  0.0f),
+        glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3( 0.0f,  0.0f, -1.0f)
+    };
+    static const std::array<glm::vec3, 6> faceUps = {
+        glm::vec3(0.0f, -1.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f),
+        glm::vec3(0.0f,  0.0f,  1.0f), glm::vec3(0.0f,  0.0f, -1.0f),
+        glm::vec3(0.0f, -1.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)
+    };
+
+    const glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.01f, farPlane);
+    const glm::mat4 view       = glm::lookAt(position, position + faceDirs[face], faceUps[face]);
+
+    Frustum frustum;
+    frustum.constructFrustum(1.0f, projection, view);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, captureTarget.fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, target.getID(), 0);
+    glViewport(0, 0, size, size);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    scene.updateCameraUBO(projection, view, position);
+
+    if (scene.getSkybox()) {
+        renderSkybox(scene);
     }
+    renderObjectsFC(scene, scene.getWorldNode(), frustum, position);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 // Returns picking ID
@@ -339,7 +523,7 @@ void Renderer::renderPickingNode(const Scene& scene, const SceneNode* node, uint
     if (node->object) {
         scene.getPickingShader().setUint("objectID", id);
         scene.getPickingShader().setMat4("modelMat", node->worldMatrix);
-        node->object->modelPtr->draw(scene.getPickingShader());
+        node->object->modelPtr->drawDepth(node->lodLevel);
         ++id;
     }
 
@@ -510,6 +694,36 @@ void Renderer::renderRefProbeProxy(const Scene& scene, const Camera& cam, int vW
     }
 }
 
+// Wire boxes for objects whose model is still importing
+void Renderer::renderLoadingPlaceholders(const Scene& scene, const Camera& cam, int vWidth, int vHeight) const {
+    const Shader& primitiveShader = scene.getPrimitiveShader();
+    static const glm::vec3 greyCol = glm::vec3(0.6f, 0.6f, 0.6f);
+
+    primitiveShader.use();
+    primitiveShader.setVec3("color", greyCol);
+    primitiveShader.setMat4("view", cam.getViewMat());
+    primitiveShader.setMat4("projection", cam.getProjMat((float)vWidth / (float)vHeight));
+    primitiveShader.setInt("mode", static_cast<int>(Primitive_Mode::LINE));
+
+    m_cubeVAO.bind();
+    renderPlaceholderNode(scene.getWorldNode(), primitiveShader);
+    m_cubeVAO.unbind();
+}
+
+void Renderer::renderPlaceholderNode(const SceneNode* node, const Shader& primitiveShader) const {
+    if (node->object && node->object->modelPtr && !node->object->modelPtr->isReady()) {
+        const AABB& aabb = node->object->modelPtr->aabb;
+        glm::mat4 boxMat = glm::translate(node->worldMatrix, (aabb.min + aabb.max) * 0.5f);
+        boxMat = glm::scale(boxMat, aabb.max - aabb.min);
+        primitiveShader.setMat4("model", boxMat);
+        glDrawArrays(GL_LINES, 0, 24);
+    }
+
+    for (auto& child : node->children) {
+        renderPlaceholderNode(child.get(), primitiveShader);
+    }
+}
+
 void Renderer::setupUnitCone() {
     // TODO: USE ARRAYS?
     std::vector<float> coneVertices;
@@ -11,6 +11,7 @@
 #include "headers/ray.h"
 #include "headers/camera.h"
 #include "headers/sceneNode.h"
+#include "headers/threadPool.h"
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -21,6 +22,7 @@
 #include <vector>
 #include <filesystem>
 #include <algorithm>
+#include <chrono>
 #include <iostream>
 
 
@@ -37,8 +39,8 @@ Scene::Scene(AssetManager* i_assetManager) : m_assetManager(i_assetManager) {
 
 	m_skyboxShader      = m_assetManager->loadShaderObject("skybox.vert", "skybox.frag");
 	m_conversionShader  = m_assetManager->loadShaderObject("equirectToUnitCube.vert", "equirectToUnitCube.frag");
-	m_convolutionShader = m_assetManager->loadShaderObject("cubemapConvolution.vert", "cubemapConvolution.frag");
 	m_prefilterShader   = m_assetManager->loadShaderObject("prefilter.vert", "prefilter.frag");
+	m_probePrefilterShader = m_assetManager->loadShaderObject("probePrefilter.vert", "probePrefilter.frag");
 	m_brdfShader        = m_assetManager->loadShaderObject("brdfLut.vert", "brdfLut.frag");
 
 	setupUBOBindings();
@@ -47,7 +49,6 @@ Scene::Scene(AssetManager* i_assetManager) : m_assetManager(i_assetManager) {
 	bindToUBOs(*m_dirDepthShader);
 	bindToUBOs(*m_omniDepthShader);
 	bindToUBOs(*m_skyboxShader);
-	bindToUBOs(*m_convolutionShader);
 
 	bindToUBOs(*m_outlineShader);
 	bindToUBOs(*m_primitiveShader);
@@ -56,6 +57,12 @@ Scene::Scene(AssetManager* i_assetManager) : m_assetManager(i_assetManager) {
 
 	generateBRDFLUT();
 }
+Scene::~Scene() {
+	glDeleteBuffers(1, &m_lightingUBO);
+	glDeleteBuffers(1, &m_refProbeUBO);
+	glDeleteBuffers(1, &m_shadowUBO);
+	glDeleteBuffers(1, &m_environmentUBO);
+}
 //Scene::Scene(const Scene&) = delete;
 //Scene::Scene& operator = (const Scene&) = delete;
 
@@ -187,18 +194,48 @@ void Scene::queueModelLoad(const std::filesystem::path& path) {
 	loadQueue.push_back(path);
 }
 void Scene::processLoadQueue() {
-	if (loadQueue.empty()) return;
-
+	// Nodes appear at once, their models import on the thread pool
 	for (const auto& path : loadQueue) {
 		createAndAddObject(path.string());
 	}
 	loadQueue.clear();
+
+	// Half the budget for upload jobs and texture streaming, which outlive the loaders
+	m_assetManager->update(MODEL_UPLOAD_BUDGET_MS * 0.5);
+	if (!m_assetManager->hasPendingModelLoads()) return;
+
+	std::vector<Model*> readyModels = m_assetManager->processModelLoads(MODEL_UPLOAD_BUDGET_MS * 0.5);
+	if (!readyModels.empty()) {
+		refreshModelBounds(m_worldNode.get(), readyModels);
+	}
+}
+void Scene::processSkyboxLoad() {
+	if (!m_skyboxLoader) return;
+	if (!m_skyboxLoader->update(*m_conversionShader, *m_prefilterShader, SKYBOX_LOAD_BUDGET_MS)) return;
+
+	if (!m_skyboxLoader->hasFailed()) {
+		m_skybox     = m_skyboxLoader->takeCubemap();
+		m_skyboxPath = m_skyboxLoader->getPath();
+		setEnvironmentSH(m_skybox->getIrradianceSH());
+	}
+	m_skyboxLoader.reset();
+}
+// The placeholder bounds get replaced on every node that uses a model that just finished loading
+void Scene::refreshModelBounds(SceneNode* node, const std::vector<Model*>& readyModels) {
+	if (node->object && std::find(readyModels.begin(), readyModels.end(), node->object->modelPtr) != readyModels.end()) {
+		node->setSphereComponentRadius();
+		node->isDirty = true;
+	}
+
+	for (auto& child : node->children) {
+		refreshModelBounds(child.get(), readyModels);
+	}
 }
 
 
 /* ===== ADDING ENTITIES ================================================================= */
 void Scene::createAndAddObject(const std::string& modelPath) {
-	std::shared_ptr<Model> modelPtr = m_assetManager->loadModel(modelPath);		// reads from the cache first
+	std::shared_ptr<Model> modelPtr = m_assetManager->loadModel(modelPath);		// reads from the cache first, may still be loading
 
 	// Instantiate new node
 	std::string name = std::filesystem::path(modelPath).filename().string();
@@ -223,62 +260,118 @@ void Scene::createAndAddSpotLight(std::unique_ptr<SpotLight> light) {
 	numSpotLights++;
 }
 void Scene::createAndAddReflectionProbe(std::unique_ptr<RefProbe> probe) {
+	probe->atlasLayer = m_probeAtlas.allocate();
+	if (probe->atlasLayer < 0) {
+		std::cerr << "[PROBE] Probe atlas is full, probe not added\n";
+		return;
+	}
 	m_refProbes.push_back(std::move(probe));
 	numRefProbes++;
 }
+// Starts a background load, processSkyboxLoad() swaps the new skybox in once it's baked
 void Scene::createAndAddSkyboxHDR(const std::filesystem::path& path) {
-	auto m_skyboxPtr = std::make_unique<Cubemap>(
-		path,
-		*m_convolutionShader,
-		*m_conversionShader,
-		*m_prefilterShader
-	);
-
-	m_skybox = std::move(m_skyboxPtr);
+	m_skyboxLoader = std::make_unique<SkyboxLoader>(path, m_iblCache, m_skyboxEnvSize);
 }
 
 
 /* ===== DELETING ENTITIES ================================================================= */
+// Erasing shifts every following light down a slot, so those slots get re-packed
 void Scene::deleteDirLight(int index) {
 	m_directionalLights.erase(m_directionalLights.begin() + index);
+	std::fill(m_dirLightVersions.begin() + index, m_dirLightVersions.end(), 0u);
+	std::fill(m_dirShadowVersions.begin() + index, m_dirShadowVersions.end(), 0u);
 }
 void Scene::deletePointLight(int index) {
 	m_pointLights.erase(m_pointLights.begin() + index);
+	std::fill(m_pointLightVersions.begin() + index, m_pointLightVersions.end(), 0u);
+	std::fill(m_pointShadowVersions.begin() + index, m_pointShadowVersions.end(), 0u);
 }
 void Scene::deleteSpotLight(int index) {
 	m_spotLights.erase(m_spotLights.begin() + index);
+	std::fill(m_spotLightVersions.begin() + index, m_spotLightVersions.end(), 0u);
+	std::fill(m_spotShadowVersions.begin() + index, m_spotShadowVersions.end(), 0u);
+}
+void Scene::deleteRefProbe(int index) {
+	m_probeAtlas.release(m_refProbes[index]->atlasLayer);
+	m_refProbes.erase(m_refProbes.begin() + index);
+	std::fill(m_refProbeVersions.begin() + index, m_refProbeVersions.end(), 0u);
 }
 void Scene::deleteSkybox() {
 	m_skybox.reset();
+	m_skyboxLoader.reset();
+	m_skyboxPath.clear();
+	setEnvironmentSH(SH9());
+}
+
+
+/* ===== IBL ============================================================================= */
+bool Scene::verifyCPUBake() const {
+	using Clock = std::chrono::steady_clock;
+
+	//--BRDF LUT
+	Clock::time_point start = Clock::now();
+	const std::vector<IBLImage> cpuLUT = IBLBaker::bakeBRDFLUT();
+	std::cout << "[IBL VERIFY] CPU BRDF LUT took "
+			  << std::chrono::duration<double, std::milli>(Clock::now() - start).count() << " ms\n";
+
+	IBLImage gpuLUT;
+	gpuLUT.faceCount = 1;
+	gpuLUT.channels  = 2;
+	gpuLUT.baseSize  = BRDF_LUT_SIZE;
+	gpuLUT.levels.resize(1);
+	gpuLUT.levels[0].resize(gpuLUT.getFaceHalfCount(0));
+	m_brdfLUT.readLevel(0, 0, GL_RG16F, gpuLUT.levels[0].data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+	bool isPassing = IBLBaker::verify({ gpuLUT }, cpuLUT);
+
+	//--Skybox
+	if (!m_skybox || m_skyboxPath.empty()) {
+		std::cout << "[IBL VERIFY] No HDR skybox loaded, skipping the environment maps\n";
+	}
+	else {
+		HDRImage image;
+		if (!image.load(m_skyboxPath)) return false;
+
+		start = Clock::now();
+		const std::vector<IBLImage> cpuImages = IBLBaker::bakeEnvironment(image, m_skybox->getEnvSize(), m_skybox->getPrefilterSize());
+		std::cout << "[IBL VERIFY] CPU environment bake took "
+				  << std::chrono::duration<double, std::milli>(Clock::now() - start).count() << " ms on "
+				  << ThreadPool::getGlobal().getThreadCount() + 1 << " threads\n";
+
+		isPassing = IBLBaker::verify(m_skybox->readbackImages(), cpuImages) && isPassing;
+	}
+
+	std::cout << "[IBL VERIFY] " << (isPassing ? "PASS" : "FAIL") << '\n';
+	return isPassing;
 }
 
 
 /* ===== UBOs ============================================================================*/
 // --ALLOCATION
-// gets called once in to set the binding points
+// gets called once to allocate the streaming ring and the static light/probe/shadow blocks
 void Scene::setupUBOBindings() {
+	m_uboRing.init(UBO_RING_FRAME_SIZE);
+
+	auto createStaticUBO = [](GLuint& buffer, GLuint bindingPoint, const void* data, GLsizeiptr size) {
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+		glBufferData(GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, buffer);
+	};
 
-	glGenBuffers(1, &m_cameraMatricesUBO);
-	glBindBuffer(GL_UNIFORM_BUFFER, m_cameraMatricesUBO);
-	glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraMatricesUBOData), NULL, GL_DYNAMIC_DRAW);
-	glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BINDING_POINT, m_cameraMatricesUBO);
-
-	glGenBuffers(1, &m_lightingUBO);
-	glBindBuffer(GL_UNIFORM_BUFFER, m_lightingUBO);
-	glBufferData(GL_UNIFORM_BUFFER, sizeof(LightingUBOData), NULL, GL_DYNAMIC_DRAW);
-	glBindBufferBase(GL_UNIFORM_BUFFER, LIGHTS_BINDING_POINT, m_lightingUBO);
-
-	glGenBuffers(1, &m_refProbeUBO);
-	glBindBuffer(GL_UNIFORM_BUFFER, m_refProbeUBO);
-	glBufferData(GL_UNIFORM_BUFFER, sizeof(ReflectionProbeUBOData), NULL, GL_DYNAMIC_DRAW);
-	glBindBufferBase(GL_UNIFORM_BUFFER, REF_PROBE_BINDING_POINT, m_refProbeUBO); 
+	createStaticUBO(m_lightingUBO, LIGHTS_BINDING_POINT,    &m_lightingData, sizeof(LightingUBOData));
+	createStaticUBO(m_refProbeUBO, REF_PROBE_BINDING_POINT, &m_refProbeData, sizeof(ReflectionProbeUBOData));
+	createStaticUBO(m_shadowUBO,   SHADOW_BINDING_POINT,    &m_shadowData,   sizeof(ShadowMatricesUBOData));
+	createStaticUBO(m_environmentUBO, ENVIRONMENT_BINDING_POINT, &m_environmentData, sizeof(EnvironmentUBOData));
+}
 
-	glGenBuffers(1, &m_shadowUBO);
-	glBindBuffer(GL_UNIFORM_BUFFER, m_shadowUBO);
-	glBufferData(GL_UNIFORM_BUFFER, sizeof(ShadowMatricesUBOData), NULL, GL_DYNAMIC_DRAW);
-	glBindBufferBase(GL_UNIFORM_BUFFER, SHADOW_BINDING_POINT, m_shadowUBO);
+void Scene::beginUBOFrame() const {
+	m_uboRing.beginFrame();
+}
 
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+void Scene::endUBOFrame() const {
+	m_uboRing.endFrame();
 }
 
 // --SHADER BINDING
@@ -304,52 +397,64 @@ void Scene::bindToUBOs(const Shader& shader) const {
 	if (shadowIndex != GL_INVALID_INDEX) {
 		glUniformBlockBinding(shader.ID, shadowIndex, SHADOW_BINDING_POINT);
 	}
+
+	unsigned int environmentIndex = glGetUniformBlockIndex(shader.ID, "EnvironmentUBOData");
+	if (environmentIndex != GL_INVALID_INDEX) {
+		glUniformBlockBinding(shader.ID, environmentIndex, ENVIRONMENT_BINDING_POINT);
+	}
 }
 
 
 void Scene::updateCameraUBO(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& cameraPos) const {
 	CameraMatricesUBOData data = { projection, view, glm::vec4(cameraPos, 1.0f) };
 
-	glBindBuffer(GL_UNIFORM_BUFFER, m_cameraMatricesUBO);
-	glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraMatricesUBOData), &data, GL_DYNAMIC_DRAW);
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	// Every call gets its own slice, draws already issued keep reading the previous one
+	m_uboRing.uploadAndBind(CAMERA_BINDING_POINT, &data, sizeof(CameraMatricesUBOData));
 }
 
+// Only lights whose version moved since the last pack are written into the image
 void Scene::updateLightingUBO() const {
-	LightingUBOData data = {};
-
-	data.numDirLights = static_cast<int>(m_directionalLights.size());
-	data.numPointLights = static_cast<int>(m_pointLights.size());
-	data.numSpotLights = static_cast<int>(m_spotLights.size());
+	const int numDir   = static_cast<int>(std::min<size_t>(m_directionalLights.size(), MAX_LIGHTS));
+	const int numPoint = static_cast<int>(std::min<size_t>(m_pointLights.size(), MAX_LIGHTS));
+	const int numSpot  = static_cast<int>(std::min<size_t>(m_spotLights.size(), MAX_LIGHTS));
 
-	for (size_t i = 0; i < m_directionalLights.size() && i < MAX_LIGHTS; ++i) {
+	for (int i = 0; i < numDir; ++i) {
 		auto& src = m_directionalLights[i];
-		auto& dst = data.directionalLight[i];
+		if (src->version == m_dirLightVersions[i]) continue;
 
+		auto& dst = m_lightingData.directionalLight[i];
 		dst.direction = glm::vec4(src->direction, 0.0f);
 		dst.color = glm::vec4(src->light.color, 1.0f);
 		dst.power = src->light.power;
 		dst.range = src->range;
 		dst.normalBias = src->light.normalBias;
 		dst.depthBias = src->light.depthBias;
+
+		m_lightingDirty.add(m_lightingData, dst);
+		m_dirLightVersions[i] = src->version;
 	}
 
-	for (size_t i = 0; i < m_pointLights.size() && i < MAX_LIGHTS; ++i) {
+	for (int i = 0; i < numPoint; ++i) {
 		auto& src = m_pointLights[i];
-		auto& dst = data.pointLight[i];
+		if (src->version == m_pointLightVersions[i]) continue;
 
+		auto& dst = m_lightingData.pointLight[i];
 		dst.position = glm::vec4(src->position, 1.0f);
 		dst.color = glm::vec4(src->light.color, 1.0f);
 		dst.power = src->light.power;
 		dst.radius = src->radius;
 		dst.normalBias = src->light.normalBias;
 		dst.depthBias = src->light.depthBias;
+
+		m_lightingDirty.add(m_lightingData, dst);
+		m_pointLightVersions[i] = src->version;
 	}
 
-	for (size_t i = 0; i < m_spotLights.size() && i < MAX_LIGHTS; ++i) {
+	for (int i = 0; i < numSpot; ++i) {
 		auto& src = m_spotLights[i];
-		auto& dst = data.spotLight[i];
+		if (src->version == m_spotLightVersions[i]) continue;
 
+		auto& dst = m_lightingData.spotLight[i];
 		dst.position = glm::vec4(src->position, 1.0f);
 		dst.direction = glm::vec4(src->direction, 0.0f);
 		dst.color = glm::vec4(src->light.color, 1.0f);
@@ -359,43 +464,142 @@ void Scene::updateLightingUBO() const {
 		dst.outCosCutoff = src->outCosCutoff;
 		dst.normalBias = src->light.normalBias;
 		dst.depthBias = src->light.depthBias;
+
+		m_lightingDirty.add(m_lightingData, dst);
+		m_spotLightVersions[i] = src->version;
+	}
+
+	if (m_lightingData.numDirLights != numDir) {
+		m_lightingData.numDirLights = numDir;
+		m_lightingDirty.add(m_lightingData, m_lightingData.numDirLights);
+	}
+	if (m_lightingData.numPointLights != numPoint) {
+		m_lightingData.numPointLights = numPoint;
+		m_lightingDirty.add(m_lightingData, m_lightingData.numPointLights);
+	}
+	if (m_lightingData.numSpotLights != numSpot) {
+		m_lightingData.numSpotLights = numSpot;
+		m_lightingDirty.add(m_lightingData, m_lightingData.numSpotLights);
 	}
 
-	glBindBuffer(GL_UNIFORM_BUFFER, m_lightingUBO);
-	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(LightingUBOData), &data);
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	flushUBOData(m_lightingUBO, &m_lightingData, m_lightingDirty);
 }
 
+// The inverse world matrix only gets recomputed when the probe itself was edited
 void Scene::updateRefProbeUBO() const {
-	ReflectionProbeUBOData data = {};
+	const int numProbes = static_cast<int>(std::min<size_t>(m_refProbes.size(), MAX_REF_PROBES));
+
+	for (int i = 0; i < numProbes; ++i) {
+		auto& src = m_refProbes[i];
+		if (src->version == m_refProbeVersions[i]) continue;
+
+		glm::mat4 worldMat = src->transform.getModelMatrix();
+		m_refProbeData.position[i]     = glm::vec4(src->transform.position, src->isBaked ? static_cast<float>(src->atlasLayer) : -1.0f);
+		m_refProbeData.worldMats[i]    = worldMat;
+		m_refProbeData.invWorldMats[i] = glm::inverse(worldMat);
+		m_refProbeData.proxyDims[i]    = glm::vec4(src->proxyDims, 1.0f);
+
+		m_refProbeDirty.add(m_refProbeData, m_refProbeData.position[i]);
+		m_refProbeDirty.add(m_refProbeData, m_refProbeData.worldMats[i]);
+		m_refProbeDirty.add(m_refProbeData, m_refProbeData.invWorldMats[i]);
+		m_refProbeDirty.add(m_refProbeData, m_refProbeData.proxyDims[i]);
+		m_refProbeVersions[i] = src->version;
+	}
 
-	data.numRefProbes = numRefProbes;
-	for (size_t i = 0; i < m_refProbes.size() && i < MAX_LIGHTS; ++i) {
-		data.position[i]     = glm::vec4(m_refProbes[i]->transform.position, 1.0f);
-		data.worldMats[i]    = m_refProbes[i]->transform.getModelMatrix();
-		data.invWorldMats[i] = glm::inverse(m_refProbes[i]->transform.getModelMatrix());
-		data.proxyDims[i]	 = glm::vec4(m_refProbes[i]->proxyDims, 1.0f);
+	if (m_refProbeData.numRefProbes != numProbes) {
+		m_refProbeData.numRefProbes = numProbes;
+		m_refProbeDirty.add(m_refProbeData, m_refProbeData.numRefProbes);
 	}
 
-	glBindBuffer(GL_UNIFORM_BUFFER, m_refProbeUBO);
-	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(ReflectionProbeUBOData), &data);
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	flushUBOData(m_refProbeUBO, &m_refProbeData, m_refProbeDirty);
 }
 
+// Influence is 1 deep inside a proxy volume and fades to 0 over its outer REF_PROBE_BLEND_FRACTION,
+// with the volume grown by the radius so objects straddling the boundary still pick the probe up
+RefProbeSelection Scene::selectRefProbes(const glm::vec3& center, float radius) const {
+	RefProbeSelection selection;
+	float bestInfluence[2] = { 0.0f, 0.0f };
+
+	for (int i = 0; i < m_refProbeData.numRefProbes; ++i) {
+		if (m_refProbeData.position[i].w < 0.0f) continue;		// Not baked yet
+
+		const glm::mat4& invWorld = m_refProbeData.invWorldMats[i];
+		const glm::vec3  localPos = glm::vec3(invWorld * glm::vec4(center, 1.0f));
+		const float      localRadius = radius * std::max({ glm::length(glm::vec3(invWorld[0])),
+		                                                   glm::length(glm::vec3(invWorld[1])),
+		                                                   glm::length(glm::vec3(invWorld[2])) });
+
+		const glm::vec3 halfDims = glm::vec3(m_refProbeData.proxyDims[i]) * 0.5f + localRadius;
+		const glm::vec3 depth    = 1.0f - glm::abs(localPos) / halfDims;
+		const float     influence = glm::clamp(std::min({ depth.x, depth.y, depth.z }) / REF_PROBE_BLEND_FRACTION, 0.0f, 1.0f);
+		if (influence <= 0.0f) continue;
+
+		if (influence > bestInfluence[0]) {
+			bestInfluence[1]     = bestInfluence[0];
+			selection.indices[1] = selection.indices[0];
+			bestInfluence[0]     = influence;
+			selection.indices[0] = i;
+		}
+		else if (influence > bestInfluence[1]) {
+			bestInfluence[1]     = influence;
+			selection.indices[1] = i;
+		}
+	}
+
+	selection.weights = glm::vec2(bestInfluence[0], bestInfluence[1]);
+	const float total = selection.weights.x + selection.weights.y;
+	if (total > 1.0f) selection.weights /= total;
+
+	return selection;
+}
+
+// The matrices are patched in by updateShadowMapLSMats()
 void Scene::updateShadowUBO() const {
-	ShadowMatricesUBOData data = {};
+	flushUBOData(m_shadowUBO, &m_shadowData, m_shadowDirty);
+}
 
-	for (size_t i = 0; i < m_directionalLights.size() && i < MAX_LIGHTS; ++i) {
-		data.directionalLightSpaceMatrices[i] = m_directionalLights[i]->shadowCasterComponent.getLightSpaceMatrix();
-	}
+void Scene::updateEnvironmentUBO() const {
+	const IrradianceVolume& volume = m_irradianceVolume;
+	const bool isVolumeEnabled = volume.isEnabled && volume.isBaked();
+
+	if (volume.getBakeCount() != m_volumeBakeCount || isVolumeEnabled != m_volumeEnabled) {
+		m_environmentData.volumeMin        = glm::vec4(volume.getBakedMin(), isVolumeEnabled ? 1.0f : 0.0f);
+		m_environmentData.volumeMax        = glm::vec4(volume.getBakedMax(), 0.0f);
+		m_environmentData.volumeResolution = glm::vec4(glm::vec3(volume.getBakedResolution()), 0.0f);
 
-	for (size_t i = 0; i < m_spotLights.size(); ++i) {
-		data.spotLightSpaceMatrices[i] = m_spotLights[i]->shadowCasterComponent.getLightSpaceMatrix();
+		m_environmentDirty.add(m_environmentData, m_environmentData.volumeMin);
+		m_environmentDirty.add(m_environmentData, m_environmentData.volumeMax);
+		m_environmentDirty.add(m_environmentData, m_environmentData.volumeResolution);
+		m_volumeBakeCount = volume.getBakeCount();
+		m_volumeEnabled   = isVolumeEnabled;
 	}
 
-	glBindBuffer(GL_UNIFORM_BUFFER, m_shadowUBO);
-	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(ShadowMatricesUBOData), &data);
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	flushUBOData(m_environmentUBO, &m_environmentData, m_environmentDirty);
+}
+
+// Stages the dirty span in the ring and copies it into the static block on the GPU,
+// so the CPU never waits on draws still reading the previous contents
+void Scene::flushUBOData(GLuint buffer, const void* data, DirtyRange& range) const {
+	if (range.empty()) return;
+
+	const unsigned char* src = static_cast<const unsigned char*>(data) + range.begin;
+	UniformRingBuffer::Allocation alloc = m_uboRing.upload(src, range.end - range.begin);
+
+	glBindBuffer(GL_COPY_READ_BUFFER, alloc.buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, alloc.offset, range.begin, alloc.size);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	range.clear();
+}
+
+// Called when the skybox changes, the upload happens in updateEnvironmentUBO()
+void Scene::setEnvironmentSH(const SH9& irradiance) {
+	for (int k = 0; k < 9; ++k) {
+		m_environmentData.irradianceSH[k] = glm::vec4(irradiance.coeffs[k], 0.0f);
+	}
+	m_environmentDirty.add(m_environmentData, m_environmentData.irradianceSH);
 }
 
 
@@ -421,24 +625,26 @@ void Scene::setNodeIBLMapUniforms() const {
 	
 	m_modelShader->use();
 	
-	m_modelShader->setInt("irradianceMap", IRRADIANCE_MAP_SLOT);
 	m_modelShader->setInt("prefilterMap", PREFILTER_MAP_SLOT);
 	m_modelShader->setInt("brdfLUT", BRDF_LUT_SLOT);
+	m_modelShader->setInt("irradianceVolumeR", IRRADIANCE_VOLUME_SLOT);
+	m_modelShader->setInt("irradianceVolumeG", IRRADIANCE_VOLUME_SLOT + 1);
+	m_modelShader->setInt("irradianceVolumeB", IRRADIANCE_VOLUME_SLOT + 2);
 }
 
 void Scene::setNodeRefMapUniforms() const {
 
 	m_modelShader->use();
 
-	for (size_t i = 0; i < MAX_LIGHTS; ++i) {
-		std::string uniformName = "refEnvMap[" + std::to_string(i) + "]";
-		m_modelShader->setInt(uniformName, REF_ENV_MAP_SLOT + i);
-	}
+	m_modelShader->setInt("refProbeAtlas", REF_PROBE_ATLAS_SLOT);
 }
 
 void Scene::updateShadowMapLSMats() const {
 
-	for (auto& dirLight : m_directionalLights) {
+	for (size_t i = 0; i < m_directionalLights.size() && i < MAX_LIGHTS; ++i) {
+		auto& dirLight = m_directionalLights[i];
+		if (dirLight->version == m_dirShadowVersions[i]) continue;
+
 		if (glm::length(dirLight->direction) < 0.001f) {
 			std::cerr << "ERROR: Direction is zero or near-zero!" << '\n';
 		}
@@ -452,18 +658,30 @@ void Scene::updateShadowMapLSMats() const {
 		if (glm::any(glm::isnan(test[0]))) {
 			std::cerr << "Matrix became NaN inside calcLightSpaceMat!" << '\n';
 		}
+
+		m_shadowData.directionalLightSpaceMatrices[i] = test;
+		m_shadowDirty.add(m_shadowData, m_shadowData.directionalLightSpaceMatrices[i]);
+		m_dirShadowVersions[i] = dirLight->version;
 	}
 
-	for (auto& pointLight : m_pointLights) {
+	for (size_t i = 0; i < m_pointLights.size() && i < MAX_LIGHTS; ++i) {
+		auto& pointLight = m_pointLights[i];
+		if (pointLight->version == m_pointShadowVersions[i]) continue;
+
 		pointLight->shadowCasterComponent.calcLightSpaceMats(pointLight->position);
 
 		std::array<glm::mat4, 6> test = pointLight->shadowCasterComponent.getLightSpaceMats();
 		if (glm::any(glm::isnan(test[0][0]))) {
 			std::cerr << "POINTLIGHT: Matrix became NaN inside calcLightSpaceMats!" << '\n';
 		}
+
+		m_pointShadowVersions[i] = pointLight->version;
 	}
 	
-	for (auto& spotLight : m_spotLights) {
+	for (size_t i = 0; i < m_spotLights.size() && i < MAX_LIGHTS; ++i) {
+		auto& spotLight = m_spotLights[i];
+		if (spotLight->version == m_spotShadowVersions[i]) continue;
+
 		if (glm::length(spotLight->direction) < 0.001f) {
 			std::cerr << "ERROR: Direction is zero or near-zero!" << '\n';
 		}
@@ -477,6 +695,10 @@ void Scene::updateShadowMapLSMats() const {
 		if (glm::any(glm::isnan(test[0]))) {
 			std::cerr << "SPOTLIGHT: Matrix became NaN inside calcLightSpaceMat!" << '\n';
 		}
+
+		m_shadowData.spotLightSpaceMatrices[i] = test;
+		m_shadowDirty.add(m_shadowData, m_shadowData.spotLightSpaceMatrices[i]);
+		m_spotShadowVersions[i] = spotLight->version;
 	}
 }
 
@@ -502,21 +724,30 @@ void Scene::bindDepthMaps() const {
 void Scene::bindIBLMaps() const {
 
 	if (m_skybox) {
-		m_skybox->getIrradianceMap().bind(IRRADIANCE_MAP_SLOT);
 		m_skybox->getPrefilterMap().bind(PREFILTER_MAP_SLOT);
 		m_brdfLUT.bind(BRDF_LUT_SLOT);
 	}
+	m_irradianceVolume.bind(IRRADIANCE_VOLUME_SLOT);
 }
 void Scene::bindRefProbeMaps() const {
-	for (size_t i = 0; i < m_refProbes.size() && i < MAX_LIGHTS; ++i) {
-		m_refProbes[i]->localEnvMap.getPrefilterMap().bind(REF_ENV_MAP_SLOT + i);
-	}
+	m_probeAtlas.bind(REF_PROBE_ATLAS_SLOT);
 }
 
 
 // NOTE: MOVE TO RENDERER CLASS
 /* ===== UTILITIES ============================================================ */
 void Scene::generateBRDFLUT() {
+	const uint64_t cacheKey = IBLSettings::getBRDFLUTKey();
+
+	std::vector<IBLImage> cached;
+	if (m_iblCache.load(cacheKey, cached) && cached.size() == 1 &&
+		cached[0].faceCount == 1 && cached[0].channels == 2 &&
+		cached[0].baseSize == BRDF_LUT_SIZE && cached[0].levels.size() == 1) {
+		m_brdfLUT.uploadLevel(0, 0, BRDF_LUT_SIZE, BRDF_LUT_SIZE, GL_RG16F, cached[0].levels[0].data());
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return;
+	}
+
 	std::cout << "[SCENE] Generating BRDF LUT\n";
 
 	//--VAO & VBO
@@ -546,7 +777,7 @@ void Scene::generateBRDFLUT() {
 
 	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
 	glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, BRDF_LUT_SIZE, BRDF_LUT_SIZE);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_brdfLUT.getID(), 0);
 
 	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
@@ -554,7 +785,7 @@ void Scene::generateBRDFLUT() {
 	}
 
 	//--Writing to the LUT
-	glViewport(0, 0, 512, 512);
+	glViewport(0, 0, BRDF_LUT_SIZE, BRDF_LUT_SIZE);
 	m_brdfShader->use();
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	quadVAO.bind();
@@ -562,4 +793,18 @@ void Scene::generateBRDFLUT() {
 	quadVAO.unbind();
 
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-}
\ No newline at end of file
+	glDeleteRenderbuffers(1, &rbo);
+	glDeleteFramebuffers(1, &fbo);
+
+	//--Persisting the LUT
+	std::vector<IBLImage> images(1);
+	images[0].faceCount = 1;
+	images[0].channels  = 2;
+	images[0].baseSize  = BRDF_LUT_SIZE;
+	images[0].levels.resize(1);
+	images[0].levels[0].resize(images[0].getFaceHalfCount(0));
+
+	m_brdfLUT.readLevel(0, 0, GL_RG16F, images[0].levels[0].data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+	m_iblCache.store(cacheKey, images);
+}
@@ -93,6 +93,12 @@ void Shader::setFloat(const std::string& name, float value) const {
 void Shader::setMat4(const std::string& name, const glm::mat4& transformation) const {
     glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(transformation));
 }
+void Shader::setIVec2(const std::string& name, const glm::ivec2& vector) const {
+    glUniform2iv(getUniformLocation(name), 1, glm::value_ptr(vector));
+}
+void Shader::setVec2(const std::string& name, const glm::vec2& vector) const {
+    glUniform2fv(getUniformLocation(name), 1, glm::value_ptr(vector));
+}
 void Shader::setVec3(const std::string& name, const glm::vec3& vector) const {
     glUniform3fv(getUniformLocation(name), 1, glm::value_ptr(vector));
 }
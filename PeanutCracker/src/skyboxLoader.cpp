@@ -0,0 +1,265 @@
+#include "headers/skyboxLoader.h"
+#include "headers/hdrImage.h"
+#include "headers/iblBaker.h"
+#include "headers/threadPool.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+
+namespace {
+    constexpr size_t UPLOAD_BYTES_PER_STEP = 4 * 1024 * 1024;
+    constexpr size_t ROW_GRAIN             = 16;
+}
+
+
+SkyboxLoader::SkyboxLoader(const std::filesystem::path& i_path, const IBLCache& i_cache, int i_envSize)
+    : m_path(i_path)
+    , m_cache(i_cache)
+    , m_envSize(i_envSize)
+{
+    std::cout << "[SKYBOX] Loading " << m_path << " in the background\n";
+
+    m_pending = ThreadPool::getGlobal().submit([path = m_path, cache = m_cache, envSize = m_envSize]() {
+        return decode(path, cache, envSize);
+    });
+
+    glGenQueries(1, &m_timerQuery);
+}
+
+SkyboxLoader::~SkyboxLoader() {
+    if (m_timerQuery != 0) glDeleteQueries(1, &m_timerQuery);
+}
+
+
+// --WORKER
+SkyboxLoader::DecodedSkybox SkyboxLoader::decode(const std::filesystem::path& path, const IBLCache& cache, int envSize) {
+    DecodedSkybox result;
+
+    result.cacheKey = IBLSettings::getEnvironmentKey(path, envSize, Cubemap::PREFILTER_SIZE);
+    if (result.cacheKey != 0 && cache.load(result.cacheKey, result.cachedImages)) {
+        if (Cubemap::isValidCacheEntry(result.cachedImages, envSize)) {
+            result.irradianceSH = IBLBaker::toSH9(result.cachedImages[2]);
+            result.isValid      = true;
+            return result;
+        }
+
+        std::cerr << "[SKYBOX] Cache entry layout mismatch, rebaking\n";
+        result.cachedImages.clear();
+    }
+
+    HDRImage image;
+    if (!image.load(path)) return result;
+
+    result.irradianceSH = SphericalHarmonics::toIrradiance(SphericalHarmonics::projectEquirect(image));
+
+    // Half floats halve what the main thread has to push through glTexSubImage2D
+    const size_t rowFloats = static_cast<size_t>(image.width) * 3;
+    result.halfPixels.resize(image.pixels.size());
+    ThreadPool::getGlobal().parallelFor(static_cast<size_t>(image.height), ROW_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin * rowFloats; i < end * rowFloats; ++i) {
+            result.halfPixels[i] = glm::packHalf1x16(image.pixels[i]);
+        }
+    });
+
+    result.width   = image.width;
+    result.height  = image.height;
+    result.isValid = true;
+    return result;
+}
+
+
+// --MAIN THREAD STEPS
+bool SkyboxLoader::update(const Shader& conversionShader, const Shader& prefilterShader, double budgetMs) {
+    using Clock = std::chrono::steady_clock;
+
+    if (m_state == State::DONE || m_state == State::FAILED) return true;
+
+    if (m_state == State::DECODING) {
+        if (m_pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+
+        m_decoded = m_pending.get();
+        if (!m_decoded.isValid) {
+            std::cerr << "[SKYBOX] Failed to load " << m_path << '\n';
+            m_state = State::FAILED;
+            return true;
+        }
+
+        // Allocating the cube textures is this frame's share of the work
+        m_cubemap = std::make_unique<Cubemap>(m_envSize);
+        m_cubemap->allocate();
+        m_cubemap->setIrradianceSH(m_decoded.irradianceSH);
+        m_state = m_decoded.cachedImages.empty() ? State::UPLOADING_HDR : State::UPLOADING_CACHE;
+        return false;
+    }
+
+    readTimerQuery();
+
+    const bool isTiming = !m_isQueryPending;
+    if (isTiming) {
+        glBeginQuery(GL_TIME_ELAPSED, m_timerQuery);
+        m_queryUnits = 0.0;
+    }
+
+    const Clock::time_point start = Clock::now();
+    double gpuEstimateMs = 0.0;
+    bool   isFirstStep   = true;
+
+    while (m_state != State::DONE && m_state != State::FAILED) {
+        // The readback stalls on queued GPU work, give it a frame of its own
+        if (m_state == State::STORING && !isFirstStep) break;
+
+        const double cost  = getStepCost();
+        const double cpuMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if (!isFirstStep && cpuMs + gpuEstimateMs + cost * m_gpuMsPerUnit > budgetMs) break;
+
+        runStep(conversionShader, prefilterShader);
+        gpuEstimateMs += cost * m_gpuMsPerUnit;
+        m_queryUnits  += cost;
+        isFirstStep    = false;
+    }
+
+    if (isTiming) {
+        glEndQuery(GL_TIME_ELAPSED);
+        m_isQueryPending = true;
+    }
+
+    return m_state == State::DONE || m_state == State::FAILED;
+}
+
+void SkyboxLoader::runStep(const Shader& conversionShader, const Shader& prefilterShader) {
+    ++m_stepsDone;
+
+    switch (m_state) {
+    case State::UPLOADING_CACHE:
+        m_cubemap->uploadCachedLevel(m_decoded.cachedImages, m_image, m_level);
+
+        if (++m_level == m_decoded.cachedImages[m_image].levels.size()) {
+            m_level = 0;
+            if (++m_image == 2) {
+                m_decoded.cachedImages.clear();
+                m_state = State::DONE;
+                std::cout << "[SKYBOX] Loaded precomputed maps from cache\n";
+            }
+        }
+        break;
+
+    case State::UPLOADING_HDR: {
+        if (!m_hdrTexture) {
+            m_hdrTexture = std::make_unique<Texture>(m_decoded.width, m_decoded.height, GL_RGB16F, false, GL_REPEAT, GL_REPEAT);
+        }
+
+        const size_t rowBytes    = static_cast<size_t>(m_decoded.width) * 3 * sizeof(uint16_t);
+        const int    rowsPerStep = static_cast<int>(std::max<size_t>(UPLOAD_BYTES_PER_STEP / rowBytes, 1));
+        const int    rows        = std::min(rowsPerStep, m_decoded.height - m_nextRow);
+
+        m_hdrTexture->uploadRegion(0, 0, 0, m_nextRow, m_decoded.width, rows, GL_RGB16F,
+            m_decoded.halfPixels.data() + static_cast<size_t>(m_nextRow) * m_decoded.width * 3);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        m_nextRow += rows;
+        if (m_nextRow == m_decoded.height) {
+            m_decoded.halfPixels = std::vector<uint16_t>();
+            m_state = State::CONVERTING;
+            std::cout << "[SKYBOX] Converting equirectangular to cubemap\n";
+        }
+        break;
+    }
+
+    case State::CONVERTING:
+        m_cubemap->convertEquirectFace(m_hdrTexture->getID(), conversionShader, m_face);
+
+        if (++m_face == 6) {
+            m_face = 0;
+            m_hdrTexture.reset();
+            m_state = State::MIPMAPPING;
+        }
+        break;
+
+    case State::MIPMAPPING:
+        m_cubemap->generateMipChains();
+        m_state = State::PREFILTERING;
+        std::cout << "[SKYBOX] Generating prefilter map\n";
+        break;
+
+    case State::PREFILTERING:
+        m_cubemap->prefilterFace(prefilterShader, m_mip, m_face);
+
+        if (++m_face == 6) {
+            m_face = 0;
+            if (++m_mip == Cubemap::PREFILTER_MIPS) {
+                m_state = m_decoded.cacheKey != 0 ? State::STORING : State::DONE;
+            }
+        }
+        break;
+
+    case State::STORING: {
+        // Disk write happens on the pool, the loader may be gone by then
+        std::vector<IBLImage> images = m_cubemap->readbackImages();
+        ThreadPool::getGlobal().submit([cache = m_cache, key = m_decoded.cacheKey, images = std::move(images)]() {
+            return cache.store(key, images);
+        });
+        m_state = State::DONE;
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+
+// --BUDGETING
+double SkyboxLoader::getStepCost() const {
+    switch (m_state) {
+    case State::CONVERTING:
+        return static_cast<double>(m_envSize) * m_envSize;
+    case State::MIPMAPPING:
+        return static_cast<double>(m_envSize) * m_envSize * 8.0;
+    case State::PREFILTERING: {
+        const double size = std::max(m_cubemap->getPrefilterSize() >> m_mip, 1);
+        return size * size * IBLSettings::SAMPLE_COUNT;
+    }
+    default:
+        return 0.0;     // Uploads and the readback are paid on the CPU clock
+    }
+}
+
+int SkyboxLoader::getTotalSteps() const {
+    if (m_state == State::UPLOADING_CACHE) {
+        return IBLSettings::getMipCount(m_envSize) + Cubemap::PREFILTER_MIPS;
+    }
+
+    const size_t rowBytes    = static_cast<size_t>(m_decoded.width) * 3 * sizeof(uint16_t);
+    const int    rowsPerStep = static_cast<int>(std::max<size_t>(UPLOAD_BYTES_PER_STEP / rowBytes, 1));
+    const int    uploadSteps = (m_decoded.height + rowsPerStep - 1) / rowsPerStep;
+
+    return uploadSteps + 6 + 1 + Cubemap::PREFILTER_MIPS * 6 + (m_decoded.cacheKey != 0 ? 1 : 0);
+}
+
+float SkyboxLoader::getProgress() const {
+    if (m_state == State::DONE) return 1.0f;
+    if (m_state == State::DECODING || m_state == State::FAILED) return 0.0f;
+    return static_cast<float>(m_stepsDone) / static_cast<float>(getTotalSteps());
+}
+
+// Updates the ms per texel sample estimate from the last timed frame
+void SkyboxLoader::readTimerQuery() {
+    if (!m_isQueryPending) return;
+
+    GLint isAvailable = 0;
+    glGetQueryObjectiv(m_timerQuery, GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+    if (!isAvailable) return;
+
+    GLuint64 elapsedNs = 0;
+    glGetQueryObjectui64v(m_timerQuery, GL_QUERY_RESULT, &elapsedNs);
+    m_isQueryPending = false;
+
+    if (m_queryUnits > 0.0) {
+        const double measured = static_cast<double>(elapsedNs) * 1e-6 / m_queryUnits;
+        m_gpuMsPerUnit = 0.5 * (m_gpuMsPerUnit + measured);
+    }
+}
@@ -0,0 +1,256 @@
+#include "headers/sphericalHarmonics.h"
+#include "headers/threadPool.h"
+
+#include <glm/gtc/constants.hpp>
+
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PC_SH_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+
+namespace {
+    // Basis normalization constants
+    constexpr float K0  = 0.282095f;   // 1/2 sqrt(1/PI)
+    constexpr float K1  = 0.488603f;   // sqrt(3/(4PI))
+    constexpr float K2  = 1.092548f;   // 1/2 sqrt(15/PI)
+    constexpr float K20 = 0.315392f;   // 1/4 sqrt(5/PI)
+    constexpr float K22 = 0.546274f;   // 1/4 sqrt(15/PI)
+
+    constexpr size_t ROW_GRAIN = 8;
+
+    using RowSums = double[9][3];
+
+    inline void evalBasis(float x, float y, float z, float out[9]) {
+        out[0] = K0;
+        out[1] = K1 * y;
+        out[2] = K1 * z;
+        out[3] = K1 * x;
+        out[4] = K2 * x * y;
+        out[5] = K2 * y * z;
+        out[6] = K20 * (3.0f * z * z - 1.0f);
+        out[7] = K2 * x * z;
+        out[8] = K22 * (x * x - y * y);
+    }
+
+    // Unweighted sum of radiance * basis over one row, every pixel in a row has the same solid angle
+    void projectRow(const float* row, int width, float y, float cosLat,
+                    const float* cosPhi, const float* sinPhi, float out[9][3]) {
+        for (int k = 0; k < 9; ++k) {
+            out[k][0] = out[k][1] = out[k][2] = 0.0f;
+        }
+
+        int i = 0;
+
+#ifdef PC_SH_USE_SSE2
+        const __m128 vY      = _mm_set1_ps(y);
+        const __m128 vCosLat = _mm_set1_ps(cosLat);
+        const __m128 vK1     = _mm_set1_ps(K1);
+        const __m128 vK2     = _mm_set1_ps(K2);
+        const __m128 vK20    = _mm_set1_ps(K20);
+        const __m128 vK22    = _mm_set1_ps(K22);
+        const __m128 vThree  = _mm_set1_ps(3.0f);
+        const __m128 vOne    = _mm_set1_ps(1.0f);
+
+        __m128 acc[9][3];
+        for (int k = 0; k < 9; ++k) {
+            acc[k][0] = acc[k][1] = acc[k][2] = _mm_setzero_ps();
+        }
+
+        for (; i + 4 <= width; i += 4) {
+            const __m128 x = _mm_mul_ps(_mm_loadu_ps(cosPhi + i), vCosLat);
+            const __m128 z = _mm_mul_ps(_mm_loadu_ps(sinPhi + i), vCosLat);
+
+            const float* p = row + i * 3;
+            const __m128 r = _mm_setr_ps(p[0], p[3], p[6], p[9]);
+            const __m128 g = _mm_setr_ps(p[1], p[4], p[7], p[10]);
+            const __m128 b = _mm_setr_ps(p[2], p[5], p[8], p[11]);
+
+            __m128 basis[9];
+            basis[0] = _mm_set1_ps(K0);
+            basis[1] = _mm_mul_ps(vK1, vY);
+            basis[2] = _mm_mul_ps(vK1, z);
+            basis[3] = _mm_mul_ps(vK1, x);
+            basis[4] = _mm_mul_ps(vK2, _mm_mul_ps(x, vY));
+            basis[5] = _mm_mul_ps(vK2, _mm_mul_ps(vY, z));
+            basis[6] = _mm_mul_ps(vK20, _mm_sub_ps(_mm_mul_ps(vThree, _mm_mul_ps(z, z)), vOne));
+            basis[7] = _mm_mul_ps(vK2, _mm_mul_ps(x, z));
+            basis[8] = _mm_mul_ps(vK22, _mm_sub_ps(_mm_mul_ps(x, x), _mm_mul_ps(vY, vY)));
+
+            for (int k = 0; k < 9; ++k) {
+                acc[k][0] = _mm_add_ps(acc[k][0], _mm_mul_ps(basis[k], r));
+                acc[k][1] = _mm_add_ps(acc[k][1], _mm_mul_ps(basis[k], g));
+                acc[k][2] = _mm_add_ps(acc[k][2], _mm_mul_ps(basis[k], b));
+            }
+        }
+
+        alignas(16) float lanes[4];
+        for (int k = 0; k < 9; ++k) {
+            for (int c = 0; c < 3; ++c) {
+                _mm_store_ps(lanes, acc[k][c]);
+                out[k][c] = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+            }
+        }
+#endif
+
+        // Scalar tail (or the whole row without SSE)
+        float basis[9];
+        for (; i < width; ++i) {
+            const float x = cosPhi[i] * cosLat;
+            const float z = sinPhi[i] * cosLat;
+            evalBasis(x, y, z, basis);
+
+            const float* p = row + i * 3;
+            for (int k = 0; k < 9; ++k) {
+                out[k][0] += basis[k] * p[0];
+                out[k][1] += basis[k] * p[1];
+                out[k][2] += basis[k] * p[2];
+            }
+        }
+    }
+}
+
+
+namespace SphericalHarmonics {
+
+SH9 projectEquirect(const HDRImage& image) {
+    SH9 result;
+    if (!image.isValid()) return result;
+
+    const int   width  = image.width;
+    const int   height = image.height;
+    const float pi     = glm::pi<float>();
+
+    // u -> longitude, atan(z, x) = (u - 0.5) * 2PI
+    std::vector<float> cosPhi(width);
+    std::vector<float> sinPhi(width);
+    for (int i = 0; i < width; ++i) {
+        const float phi = ((i + 0.5f) / width - 0.5f) * 2.0f * pi;
+        cosPhi[i] = std::cos(phi);
+        sinPhi[i] = std::sin(phi);
+    }
+
+    const double pixelArea = (2.0 * pi / width) * (pi / height);
+
+    RowSums    total = {};
+    std::mutex totalMutex;
+
+    ThreadPool::getGlobal().parallelFor(static_cast<size_t>(height), ROW_GRAIN, [&](size_t begin, size_t end) {
+        RowSums local = {};
+        float   row[9][3];
+
+        for (size_t j = begin; j < end; ++j) {
+            // v -> latitude, asin(y) = (v - 0.5) * PI
+            const float lat    = ((j + 0.5f) / height - 0.5f) * pi;
+            const float y      = std::sin(lat);
+            const float cosLat = std::cos(lat);
+
+            projectRow(image.pixels.data() + j * width * 3, width, y, cosLat, cosPhi.data(), sinPhi.data(), row);
+
+            const double weight = pixelArea * cosLat;
+            for (int k = 0; k < 9; ++k) {
+                local[k][0] += weight * row[k][0];
+                local[k][1] += weight * row[k][1];
+                local[k][2] += weight * row[k][2];
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(totalMutex);
+        for (int k = 0; k < 9; ++k) {
+            total[k][0] += local[k][0];
+            total[k][1] += local[k][1];
+            total[k][2] += local[k][2];
+        }
+    });
+
+    for (int k = 0; k < 9; ++k) {
+        result.coeffs[k] = glm::vec3(total[k][0], total[k][1], total[k][2]);
+    }
+    return result;
+}
+
+SH9 projectCubemap(const float* faces, int size) {
+    double total[9][3] = {};
+    float  basis[9];
+
+    for (int face = 0; face < 6; ++face) {
+        for (int y = 0; y < size; ++y) {
+            const float tc = 2.0f * (y + 0.5f) / size - 1.0f;
+
+            for (int x = 0; x < size; ++x) {
+                const float sc = 2.0f * (x + 0.5f) / size - 1.0f;
+
+                glm::vec3 dir;
+                switch (face) {
+                case 0:  dir = glm::vec3( 1.0f, -tc,  -sc);  break;
+                case 1:  dir = glm::vec3(-1.0f, -tc,   sc);  break;
+                case 2:  dir = glm::vec3( sc,    1.0f, tc);  break;
+                case 3:  dir = glm::vec3( sc,   -1.0f, -tc); break;
+                case 4:  dir = glm::vec3( sc,   -tc,   1.0f); break;
+                default: dir = glm::vec3(-sc,   -tc,  -1.0f); break;
+                }
+
+                // Solid angle of the texel, (2/size)^2 projected onto the unit sphere
+                const float lenSq = glm::dot(dir, dir);
+                const float weight = (4.0f / (size * size)) / (lenSq * std::sqrt(lenSq));
+
+                dir /= std::sqrt(lenSq);
+                evalBasis(dir.x, dir.y, dir.z, basis);
+
+                const float* p = faces + ((static_cast<size_t>(face) * size + y) * size + x) * 3;
+                for (int k = 0; k < 9; ++k) {
+                    total[k][0] += weight * basis[k] * p[0];
+                    total[k][1] += weight * basis[k] * p[1];
+                    total[k][2] += weight * basis[k] * p[2];
+                }
+            }
+        }
+    }
+
+    SH9 result;
+    for (int k = 0; k < 9; ++k) {
+        result.coeffs[k] = glm::vec3(total[k][0], total[k][1], total[k][2]);
+    }
+    return result;
+}
+
+SH9 toIrradiance(const SH9& radiance) {
+    // Cosine lobe band factors (PI, 2PI/3, PI/4) divided by PI
+    constexpr float A0 = 1.0f;
+    constexpr float A1 = 2.0f / 3.0f;
+    constexpr float A2 = 0.25f;
+
+    const std::array<float, 9> scale = {
+        A0 * K0,
+        A1 * K1, A1 * K1, A1 * K1,
+        A2 * K2, A2 * K2, A2 * K20, A2 * K2, A2 * K22
+    };
+
+    SH9 result;
+    for (int k = 0; k < 9; ++k) {
+        result.coeffs[k] = radiance.coeffs[k] * scale[k];
+    }
+    return result;
+}
+
+glm::vec3 evalIrradiance(const SH9& irradiance, const glm::vec3& n) {
+    const std::array<glm::vec3, 9>& c = irradiance.coeffs;
+
+    glm::vec3 result = c[0]
+        + c[1] * n.y
+        + c[2] * n.z
+        + c[3] * n.x
+        + c[4] * (n.x * n.y)
+        + c[5] * (n.y * n.z)
+        + c[6] * (3.0f * n.z * n.z - 1.0f)
+        + c[7] * (n.x * n.z)
+        + c[8] * (n.x * n.x - n.y * n.y);
+
+    return glm::max(result, glm::vec3(0.0f));
+}
+
+}
@@ -1,7 +1,5 @@
 #include "headers/texture.h"
 
-#include "../stb_image/stb_image.h"
-
 #include <iostream>
 
 
@@ -11,6 +9,13 @@ Texture::Texture()
 {
 }
 
+Texture::Texture(TexType type)
+    : m_ID(0)
+    , m_type(type)
+{
+    glGenTextures(1, &m_ID);
+}
+
 // Load 2D texture
 Texture::Texture(const std::filesystem::path& i_path, bool sRGB, bool hdr)
     : m_ID(0)
@@ -19,6 +24,57 @@ Texture::Texture(const std::filesystem::path& i_path, bool sRGB, bool hdr)
     m_ID = hdr ? loadHDR(i_path) : load2D(i_path, sRGB);
 }
 
+// Upload a decoded HDR image
+Texture::Texture(const HDRImage& image)
+    : m_ID(0)
+    , m_type(TexType::TEX_2D)
+{
+    if (!image.isValid()) return;
+
+    glGenTextures(1, &m_ID);
+    glBindTexture(GL_TEXTURE_2D, m_ID);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, image.width, image.height, 0, GL_RGB, GL_FLOAT, image.pixels.data());
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+// Upload a decoded 8-bit image
+Texture::Texture(const LDRImage& image, bool sRGB)
+    : m_ID(0)
+    , m_type(TexType::TEX_2D)
+{
+    if (!image.isValid()) return;
+
+    const GLenum internalFormat = getLDRFormat(image.channels, sRGB);
+
+    glGenTextures(1, &m_ID);
+    glBindTexture(GL_TEXTURE_2D, m_ID);
+
+    // A chain built by the decoding worker goes up as is
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (image.mips.empty()) {
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, getBaseFormat(internalFormat), GL_UNSIGNED_BYTE, image.pixels.data());
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+    else {
+        for (int level = 0; level < image.getLevelCount(); ++level) {
+            glTexImage2D(GL_TEXTURE_2D, level, internalFormat, image.getLevelWidth(level), image.getLevelHeight(level), 0,
+                         getBaseFormat(internalFormat), GL_UNSIGNED_BYTE, image.getLevelData(level));
+        }
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
 // Make 1x1 colored texture
 Texture::Texture(const glm::vec4& color, bool sRGB) {
     m_type = TexType::TEX_2D;
@@ -108,6 +164,40 @@ void Texture::generateMipmaps() const {
     glGenerateMipmap(static_cast<GLenum>(m_type));
 }
 
+void Texture::uploadLevel(int level, int face, int w, int h, GLenum internalFormat, const void* data) const {
+    const GLenum target = (m_type == TexType::TEX_CUBE) ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+
+    glBindTexture(static_cast<GLenum>(m_type), m_ID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(target, level, internalFormat, w, h, 0, getBaseFormat(internalFormat), getDataType(internalFormat), data);
+}
+
+void Texture::uploadRegion(int level, int face, int x, int y, int w, int h, GLenum internalFormat, const void* data) const {
+    const GLenum target = (m_type == TexType::TEX_CUBE) ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+
+    glBindTexture(static_cast<GLenum>(m_type), m_ID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(target, level, x, y, w, h, getBaseFormat(internalFormat), getDataType(internalFormat), data);
+}
+
+void Texture::readLevel(int level, int face, GLenum internalFormat, void* data) const {
+    const GLenum target = (m_type == TexType::TEX_CUBE) ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+
+    glBindTexture(static_cast<GLenum>(m_type), m_ID);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(target, level, getBaseFormat(internalFormat), getDataType(internalFormat), data);
+}
+
+void Texture::setMaxLevel(int level) const {
+    glBindTexture(static_cast<GLenum>(m_type), m_ID);
+    glTexParameteri(static_cast<GLenum>(m_type), GL_TEXTURE_MAX_LEVEL, level);
+}
+
+void Texture::setBaseLevel(int level) const {
+    glBindTexture(static_cast<GLenum>(m_type), m_ID);
+    glTexParameteri(static_cast<GLenum>(m_type), GL_TEXTURE_BASE_LEVEL, level);
+}
+
 void Texture::bind(unsigned int slot) const {
     glActiveTexture(GL_TEXTURE0 + slot);
     glBindTexture(static_cast<GLenum>(m_type), m_ID);
@@ -121,74 +211,36 @@ void Texture::unbind() const {
 
 // File loading helpers
 GLuint Texture::load2D(const std::filesystem::path& i_path, bool sRGB) const {
-    std::cout << "[TEX] Loading: " << i_path << '\n';
-
-    int w, h, nComps;
-    unsigned char* data = stbi_load(i_path.string().c_str(), &w, &h, &nComps, 0);
-    if (!data) {
-        std::cerr << "[TEX] Failed to load: " << i_path << '\n';
-        return 0;
-    }
-
-    GLenum internalFormat, dataFormat;
-    if (nComps == 1) {
-        internalFormat = GL_RED;
-        dataFormat = GL_RED;
-    }
-    else if (nComps == 3) {
-        internalFormat = sRGB ? GL_SRGB : GL_RGB;
-        dataFormat = GL_RGB;
-    }
-    else { // 4
-        internalFormat = sRGB ? GL_SRGB_ALPHA : GL_RGBA;
-        dataFormat = GL_RGBA;
-    }
+    LDRImage image;
+    if (!image.load(i_path)) return 0;
 
-    GLuint ID;
-    glGenTextures(1, &ID);
-    glBindTexture(GL_TEXTURE_2D, ID);
-
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, w, h, 0, dataFormat, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    stbi_image_free(data);
+    Texture texture(image, sRGB);
+    GLuint ID = texture.m_ID;
+    texture.m_ID = 0;
     return ID;
 }
 
 GLuint Texture::loadHDR(const std::filesystem::path& i_path) const {
-    std::cout << "[TEX] Loading HDR: " << i_path << '\n';
-
-    int w, h, nComps;
-    float* data = stbi_loadf(i_path.string().c_str(), &w, &h, &nComps, 0);
-    if (!data) {
-        std::cerr << "[TEX] Failed to load HDR: " << i_path << '\n';
-        return 0;
-    }
+    HDRImage image;
+    if (!image.load(i_path)) return 0;
 
-    GLuint ID;
-    glGenTextures(1, &ID);
-    glBindTexture(GL_TEXTURE_2D, ID);
-
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, w, h, 0, GL_RGB, GL_FLOAT, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    stbi_image_free(data);
+    Texture texture(image);
+    GLuint ID = texture.m_ID;
+    texture.m_ID = 0;
     return ID;
 }
 
 
 // Format helpers
+GLenum Texture::getLDRFormat(int channels, bool sRGB) {
+    switch (channels) {
+    case 1:  return GL_R8;
+    case 2:  return GL_RG8;
+    case 3:  return sRGB ? GL_SRGB8 : GL_RGB8;
+    default: return sRGB ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+    }
+}
+
 GLenum Texture::getBaseFormat(GLenum internalFormat) {
     switch (internalFormat) {
     case GL_R8:
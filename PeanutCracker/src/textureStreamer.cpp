@@ -0,0 +1,147 @@
+#include "headers/textureStreamer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+
+TextureStreamer::TextureStreamer(UploadContext& i_uploadContext)
+    : m_uploadContext(i_uploadContext)
+    , m_unpackBuffer(std::make_shared<UnpackBuffer>())
+{
+}
+
+TextureStreamer::UnpackBuffer::~UnpackBuffer() {
+    if (id != 0) glDeleteBuffers(1, &id);
+}
+
+
+// --MAIN THREAD
+std::shared_ptr<Texture> TextureStreamer::add(std::shared_ptr<const LDRImage> image, bool sRGB, std::shared_ptr<UploadTicket>& ticket) {
+    auto texture = std::make_shared<Texture>(TexType::TEX_2D);
+    const GLenum internalFormat = Texture::getLDRFormat(image->channels, sRGB);
+    const int    tailLevel      = getTailLevel(*image);
+
+    ticket = m_uploadContext.submit([texture, image, internalFormat, tailLevel, buffer = m_unpackBuffer]() {
+        // Every level exists from the start, so the texture is complete whatever the base level
+        const int levelCount = image->getLevelCount();
+        for (int level = 0; level < levelCount; ++level) {
+            texture->uploadLevel(level, 0, image->getLevelWidth(level), image->getLevelHeight(level), internalFormat, nullptr);
+        }
+
+        for (int level = levelCount - 1; level >= tailLevel; --level) {
+            uploadLevel(*buffer, *texture, *image, level, internalFormat);
+        }
+
+        texture->setBaseLevel(tailLevel);
+        texture->setMaxLevel(levelCount - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    });
+
+    // The tail counts as the first level in flight, nothing else streams before it lands
+    Entry entry;
+    entry.texture        = texture;
+    entry.image          = std::move(image);
+    entry.internalFormat = internalFormat;
+    entry.residentLevel  = entry.image->getLevelCount();
+    entry.uploadingLevel = tailLevel;
+    entry.ticket         = ticket;
+    m_entries.push_back(std::move(entry));
+
+    return texture;
+}
+
+void TextureStreamer::update() {
+    for (Entry& entry : m_entries) {
+        if (entry.uploadingLevel < 0 || !entry.ticket->isComplete()) continue;
+
+        entry.texture->setBaseLevel(entry.uploadingLevel);
+        entry.residentLevel  = entry.uploadingLevel;
+        entry.uploadingLevel = -1;
+        entry.ticket.reset();
+    }
+
+    // Done, or dropped by everyone else (a racing load won the texture cache)
+    m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(), [](const Entry& entry) {
+        return entry.uploadingLevel < 0 && (entry.residentLevel == 0 || entry.texture.use_count() == 1);
+    }), m_entries.end());
+
+    // Smallest missing level across all textures first, so everything sharpens evenly.
+    // At least one level goes per frame, or a level bigger than the budget would never go
+    size_t budget    = m_byteBudget;
+    bool   hasQueued = false;
+    while (true) {
+        Entry* next     = nullptr;
+        size_t nextSize = SIZE_MAX;
+        for (Entry& entry : m_entries) {
+            if (entry.uploadingLevel >= 0 || entry.residentLevel == 0) continue;
+
+            const size_t size = entry.image->getLevelSize(entry.residentLevel - 1);
+            if (size < nextSize) {
+                next     = &entry;
+                nextSize = size;
+            }
+        }
+        if (!next || (hasQueued && nextSize > budget)) break;
+
+        const int level = next->residentLevel - 1;
+        next->uploadingLevel = level;
+        next->ticket = m_uploadContext.submit([texture = next->texture, image = next->image, level, internalFormat = next->internalFormat, buffer = m_unpackBuffer]() {
+            uploadLevel(*buffer, *texture, *image, level, internalFormat);
+            glBindTexture(GL_TEXTURE_2D, 0);
+        });
+
+        budget   -= std::min(budget, nextSize);
+        hasQueued = true;
+    }
+}
+
+size_t TextureStreamer::getPendingBytes() const {
+    size_t bytes = 0;
+    for (const Entry& entry : m_entries) {
+        for (int level = 0; level < entry.residentLevel; ++level) {
+            bytes += entry.image->getLevelSize(level);
+        }
+    }
+    return bytes;
+}
+
+
+// --HELPERS
+int TextureStreamer::getTailLevel(const LDRImage& image) {
+    int level = 0;
+    while (level < image.getLevelCount() - 1 && std::max(image.getLevelWidth(level), image.getLevelHeight(level)) > TAIL_SIZE) {
+        ++level;
+    }
+    return level;
+}
+
+// Upload context side
+void TextureStreamer::uploadLevel(UnpackBuffer& buffer, const Texture& texture, const LDRImage& image, int level, GLenum internalFormat) {
+    const int    width  = image.getLevelWidth(level);
+    const int    height = image.getLevelHeight(level);
+    const size_t size   = image.getLevelSize(level);
+
+    if (buffer.id == 0) glGenBuffers(1, &buffer.id);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.id);
+
+    // Orphaning gives the previous storage to the driver, which may still be copying out of it
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_DRAW);
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(size), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped) {
+        std::memcpy(mapped, image.getLevelData(level), size);
+        if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE) {
+            texture.uploadRegion(level, 0, 0, 0, width, height, internalFormat, nullptr);    // Offset 0 into the buffer
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            return;
+        }
+    }
+
+    // Couldn't map, or the mapping got corrupted: straight from client memory
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    texture.uploadRegion(level, 0, 0, 0, width, height, internalFormat, image.getLevelData(level));
+}
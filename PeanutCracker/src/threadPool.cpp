@@ -0,0 +1,111 @@
+#include "headers/threadPool.h"
+
+#include <algorithm>
+
+
+ThreadPool::ThreadPool(unsigned int threadCount) {
+    if (threadCount == 0) {
+        unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    m_workers.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; ++i) {
+        m_workers.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isStopping = true;
+    }
+    m_condition.notify_all();
+
+    for (std::thread& worker : m_workers) {
+        if (worker.joinable()) worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::getGlobal() {
+    static ThreadPool pool;
+    return pool;
+}
+
+
+// --JOBS
+void ThreadPool::enqueue(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push(std::move(job));
+    }
+    m_condition.notify_one();
+}
+
+void ThreadPool::workerLoop() {
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_isStopping || !m_jobs.empty(); });
+
+            if (m_isStopping && m_jobs.empty()) return;
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop();
+        }
+        job();
+    }
+}
+
+
+// --PARALLEL FOR
+// Chunks are claimed through an atomic counter by the caller and by helper jobs alike.
+// Helpers that start after every chunk was claimed just return.
+void ThreadPool::parallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& func) {
+    if (count == 0) return;
+
+    grainSize = std::max<size_t>(grainSize, 1);
+    const size_t maxChunks  = static_cast<size_t>(getThreadCount()) * 4 + 1;
+    const size_t chunkSize  = std::max(grainSize, (count + maxChunks - 1) / maxChunks);
+    const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+    if (chunkCount == 1) {
+        func(0, count);
+        return;
+    }
+
+    struct SharedState {
+        std::atomic<size_t>     nextChunk{ 0 };
+        std::atomic<size_t>     doneChunks{ 0 };
+        std::mutex              mutex;
+        std::condition_variable condition;
+    };
+    auto state = std::make_shared<SharedState>();
+
+    auto runChunks = [state, &func, count, chunkSize, chunkCount]() {
+        for (;;) {
+            size_t chunk = state->nextChunk.fetch_add(1);
+            if (chunk >= chunkCount) return;
+
+            size_t begin = chunk * chunkSize;
+            func(begin, std::min(begin + chunkSize, count));
+
+            if (state->doneChunks.fetch_add(1) + 1 == chunkCount) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->condition.notify_all();
+            }
+        }
+    };
+
+    const size_t helperCount = std::min<size_t>(getThreadCount(), chunkCount - 1);
+    for (size_t i = 0; i < helperCount; ++i) {
+        enqueue(runChunks);
+    }
+
+    runChunks();
+
+    // func is only referenced while a chunk is running, every chunk is claimed by now
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->condition.wait(lock, [&]() { return state->doneChunks.load() == chunkCount; });
+}
@@ -0,0 +1,193 @@
+#include "headers/uniformRingBuffer.h"
+
+#include <glad/glad.h>
+
+#include <cstring>
+#include <iostream>
+
+
+UniformRingBuffer::~UniformRingBuffer() {
+    for (GLsync& fence : m_fences) {
+        if (fence) glDeleteSync(fence);
+        fence = nullptr;
+    }
+    for (RetiredBuffer& retired : m_retired) {
+        if (retired.fence) glDeleteSync(retired.fence);
+        glDeleteBuffers(1, &retired.ID);
+    }
+    m_retired.clear();
+
+    if (m_ID != 0) {
+        if (m_mappedPtr) {
+            glBindBuffer(GL_UNIFORM_BUFFER, m_ID);
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &m_ID);
+    }
+}
+
+void UniformRingBuffer::init(GLsizeiptr bytesPerFrame) {
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &m_alignment);
+    if (m_alignment <= 0) m_alignment = 256;
+
+    m_isPersistent = GLAD_GL_VERSION_4_4 != 0;
+
+    std::cout << "[UBO RING] " << (m_isPersistent ? "Persistent mapped" : "Orphaning") << " ring, "
+              << bytesPerFrame << " bytes x " << FRAME_COUNT << " frames (align " << m_alignment << ")\n";
+
+    allocateStorage(bytesPerFrame);
+}
+
+
+// --FRAME PACING
+void UniformRingBuffer::beginFrame() {
+    collectRetired();
+
+    m_frameIndex = (m_frameIndex + 1) % FRAME_COUNT;
+    m_head = 0;
+
+    if (m_isPersistent) {
+        // Triple buffered, this should already be signaled unless the GPU is 2 frames behind
+        waitFence(m_fences[m_frameIndex]);
+    }
+    else if (m_frameIndex == 0) {
+        // Ring wrapped, orphan so the driver hands us fresh storage while older frames are in flight
+        glBindBuffer(GL_UNIFORM_BUFFER, m_ID);
+        glBufferData(GL_UNIFORM_BUFFER, m_frameSize * FRAME_COUNT, nullptr, GL_STREAM_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+}
+
+void UniformRingBuffer::endFrame() {
+    if (!m_isPersistent) return;
+
+    if (m_fences[m_frameIndex]) glDeleteSync(m_fences[m_frameIndex]);
+    m_fences[m_frameIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+
+// --ALLOCATION
+UniformRingBuffer::Allocation UniformRingBuffer::upload(const void* data, GLsizeiptr size) {
+    GLsizeiptr alignedSize = (size + m_alignment - 1) / m_alignment * m_alignment;
+
+    if (m_head + alignedSize > m_frameSize) {
+        grow(m_frameSize + alignedSize);
+    }
+
+    Allocation alloc;
+    alloc.buffer = m_ID;
+    alloc.offset = static_cast<GLintptr>(m_frameIndex) * m_frameSize + m_head;
+    alloc.size   = size;
+
+    if (m_isPersistent) {
+        std::memcpy(m_mappedPtr + alloc.offset, data, size);
+    }
+    else {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_ID);
+        void* dst = glMapBufferRange(GL_UNIFORM_BUFFER, alloc.offset, size,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (dst) {
+            std::memcpy(dst, data, size);
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+        }
+        else {
+            glBufferSubData(GL_UNIFORM_BUFFER, alloc.offset, size, data);
+        }
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    m_head += alignedSize;
+    return alloc;
+}
+
+UniformRingBuffer::Allocation UniformRingBuffer::uploadAndBind(GLuint bindingPoint, const void* data, GLsizeiptr size) {
+    Allocation alloc = upload(data, size);
+    glBindBufferRange(GL_UNIFORM_BUFFER, bindingPoint, alloc.buffer, alloc.offset, alloc.size);
+    return alloc;
+}
+
+
+// --STORAGE
+void UniformRingBuffer::allocateStorage(GLsizeiptr frameSize) {
+    m_frameSize = (frameSize + m_alignment - 1) / m_alignment * m_alignment;
+    const GLsizeiptr totalSize = m_frameSize * FRAME_COUNT;
+
+    glGenBuffers(1, &m_ID);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_ID);
+
+    if (m_isPersistent) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_UNIFORM_BUFFER, totalSize, nullptr, flags);
+        m_mappedPtr = static_cast<unsigned char*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, totalSize, flags));
+
+        if (!m_mappedPtr) {
+            std::cerr << "[UBO RING] Persistent map failed, falling back to orphaning\n";
+            glDeleteBuffers(1, &m_ID);
+            m_isPersistent = false;
+
+            glGenBuffers(1, &m_ID);
+            glBindBuffer(GL_UNIFORM_BUFFER, m_ID);
+            glBufferData(GL_UNIFORM_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+        }
+    }
+    else {
+        glBufferData(GL_UNIFORM_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+// Old storage stays alive (and bound) until every frame that might read it has retired,
+// so ranges bound earlier in this frame remain valid
+void UniformRingBuffer::grow(GLsizeiptr minFrameSize) {
+    GLsizeiptr newSize = m_frameSize * 2;
+    while (newSize < minFrameSize) newSize *= 2;
+
+    std::cerr << "[UBO RING] Frame region overflow, growing " << m_frameSize << " -> " << newSize << " bytes\n";
+
+    RetiredBuffer retired;
+    retired.ID    = m_ID;
+    retired.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_retired.push_back(retired);
+
+    if (m_mappedPtr) {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_ID);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        m_mappedPtr = nullptr;
+    }
+
+    for (GLsync& fence : m_fences) {
+        if (fence) glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    allocateStorage(newSize);
+    m_head = 0;
+}
+
+void UniformRingBuffer::waitFence(GLsync& fence) const {
+    if (!fence) return;
+
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    while (result == GL_TIMEOUT_EXPIRED) {
+        result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);   // 1ms
+    }
+
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void UniformRingBuffer::collectRetired() {
+    for (auto it = m_retired.begin(); it != m_retired.end();) {
+        if (glClientWaitSync(it->fence, 0, 0) != GL_TIMEOUT_EXPIRED) {
+            glDeleteSync(it->fence);
+            glDeleteBuffers(1, &it->ID);
+            it = m_retired.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#include "headers/uploadContext.h"
+
+#include <chrono>
+#include <iostream>
+
+
+// --TICKET
+UploadTicket::~UploadTicket() {
+    GLsync sync = m_sync.load();
+    if (sync) glDeleteSync(sync);
+}
+
+bool UploadTicket::isComplete() {
+    if (m_isSignaled) return true;
+
+    GLsync sync = m_sync.load(std::memory_order_acquire);
+    if (!sync) return false;    // The job hasn't run yet
+
+    const GLenum result = glClientWaitSync(sync, 0, 0);
+    m_isSignaled = (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED);
+    return m_isSignaled;
+}
+
+
+// --CONTEXT
+UploadContext::UploadContext(GLFWwindow* mainWindow) {
+    // The version and profile hints are still set from the main window
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_SAMPLES, 0);
+
+    m_window = glfwCreateWindow(1, 1, "Upload Context", NULL, mainWindow);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+
+    if (!m_window) {
+        std::cerr << "[UPLOAD] Shared context unavailable, uploading on the main thread\n";
+        return;
+    }
+
+    m_thread = std::thread([this]() { threadLoop(); });
+}
+
+UploadContext::~UploadContext() {
+    shutdown();
+}
+
+void UploadContext::shutdown() {
+    if (m_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_isStopping = true;
+        }
+        m_condition.notify_all();
+        m_thread.join();
+    }
+
+    if (m_window) {
+        glfwDestroyWindow(m_window);
+        m_window = nullptr;
+    }
+}
+
+
+// --JOBS
+std::shared_ptr<UploadTicket> UploadContext::submit(std::function<void()> job) {
+    auto ticket = std::make_shared<UploadTicket>();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push({ std::move(job), ticket });
+    }
+    m_condition.notify_one();
+    return ticket;
+}
+
+void UploadContext::update(double budgetMs) {
+    using Clock = std::chrono::steady_clock;
+    if (isThreaded()) return;
+
+    const Clock::time_point start = Clock::now();
+    while (!m_jobs.empty() && std::chrono::duration<double, std::milli>(Clock::now() - start).count() < budgetMs) {
+        Job job = std::move(m_jobs.front());
+        m_jobs.pop();
+        runJob(job);
+    }
+}
+
+void UploadContext::threadLoop() {
+    glfwMakeContextCurrent(m_window);
+
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_isStopping || !m_jobs.empty(); });
+
+            if (m_isStopping) break;
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop();
+        }
+        runJob(job);
+    }
+
+    // Queued jobs are dropped, their resources are released with the last reference to them
+    std::queue<Job>().swap(m_jobs);
+    glfwMakeContextCurrent(NULL);
+}
+
+void UploadContext::runJob(Job& job) {
+    job.func();
+    job.func = nullptr;     // Releases whatever the job captured while the context is still current
+
+    // The flush makes the fence visible to the main context's glClientWaitSync
+    GLsync sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+    job.ticket->m_sync.store(sync, std::memory_order_release);
+}